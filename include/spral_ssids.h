@@ -32,7 +32,14 @@ struct spral_ssids_options {
    int pivot_method;
    double small;
    double u;
-   char unused[80]; // Allow for future expansion
+   int amalg_method;
+   bool refactor;
+   bool store_relidx;
+   int64_t memory_budget;
+   int huge_pages;
+   int cpu_lookahead;
+   bool compress_factors;
+   char unused[55]; // Allow for future expansion
 };
 
 struct spral_ssids_inform {
@@ -53,7 +60,19 @@ struct spral_ssids_inform {
    int cuda_error;
    int cublas_error;
    int maxsupernode;
-   char unused[76]; // Allow for future expansion
+   int cpu_isa;
+   double factor_time;
+   double factor_time_predicted;
+   int not_refactored;
+   int64_t relidx_mem;
+   int64_t contrib_peak_predicted;
+   int64_t contrib_peak;
+   int64_t factor_mem_predicted;
+   int64_t work_mem_predicted;
+   int64_t backup_peak;
+   int num_huge_pages;
+   int num_refine;
+   char unused[72]; // Allow for future expansion
 };
 
 /************************************
@@ -23,7 +23,14 @@ module spral_ssids_ciface
      integer(C_INT) :: pivot_method
      real(C_DOUBLE) :: small
      real(C_DOUBLE) :: u
-     character(C_CHAR) :: unused(80)
+     integer(C_INT) :: amalg_method
+     logical(C_BOOL) :: refactor
+     logical(C_BOOL) :: store_relidx
+     integer(C_INT64_T) :: memory_budget
+     integer(C_INT) :: huge_pages
+     integer(C_INT) :: cpu_lookahead
+     logical(C_BOOL) :: compress_factors
+     character(C_CHAR) :: unused(55)
   end type spral_ssids_options
 
   type, bind(C) :: spral_ssids_inform
@@ -44,7 +51,19 @@ module spral_ssids_ciface
      integer(C_INT) :: cuda_error
      integer(C_INT) :: cublas_error
      integer(C_INT) :: maxsupernode
-     character(C_CHAR) :: unused(76)
+     integer(C_INT) :: cpu_isa
+     real(C_DOUBLE) :: factor_time
+     real(C_DOUBLE) :: factor_time_predicted
+     integer(C_INT) :: not_refactored
+     integer(C_INT64_T) :: relidx_mem
+     integer(C_INT64_T) :: contrib_peak_predicted
+     integer(C_INT64_T) :: contrib_peak
+     integer(C_INT64_T) :: factor_mem_predicted
+     integer(C_INT64_T) :: work_mem_predicted
+     integer(C_INT64_T) :: backup_peak
+     integer(C_INT) :: num_huge_pages
+     integer(C_INT) :: num_refine
+     character(C_CHAR) :: unused(72)
   end type spral_ssids_inform
 
 contains
@@ -73,6 +92,13 @@ contains
     foptions%pivot_method      = coptions%pivot_method
     foptions%small             = coptions%small
     foptions%u                 = coptions%u
+    foptions%amalg_method      = coptions%amalg_method
+    foptions%refactor          = coptions%refactor
+    foptions%store_relidx      = coptions%store_relidx
+    foptions%memory_budget     = coptions%memory_budget
+    foptions%huge_pages        = coptions%huge_pages
+    foptions%cpu_lookahead     = coptions%cpu_lookahead
+    foptions%compress_factors  = coptions%compress_factors
   end subroutine copy_options_in
 
   subroutine copy_inform_out(finform, cinform)
@@ -97,6 +123,18 @@ contains
     cinform%stat                  = finform%stat
     cinform%cuda_error            = finform%cuda_error
     cinform%cublas_error          = finform%cublas_error
+    cinform%cpu_isa               = finform%cpu_isa
+    cinform%factor_time           = finform%factor_time
+    cinform%factor_time_predicted = finform%factor_time_predicted
+    cinform%not_refactored        = finform%not_refactored
+    cinform%relidx_mem            = finform%relidx_mem
+    cinform%contrib_peak_predicted = finform%contrib_peak_predicted
+    cinform%contrib_peak          = finform%contrib_peak
+    cinform%factor_mem_predicted  = finform%factor_mem_predicted
+    cinform%work_mem_predicted    = finform%work_mem_predicted
+    cinform%backup_peak           = finform%backup_peak
+    cinform%num_huge_pages        = finform%num_huge_pages
+    cinform%num_refine            = finform%num_refine
   end subroutine copy_inform_out
 end module spral_ssids_ciface
 
@@ -127,6 +165,13 @@ subroutine spral_ssids_default_options(coptions) bind(C)
   coptions%pivot_method      = default_options%pivot_method
   coptions%small             = default_options%small
   coptions%u                 = default_options%u
+  coptions%amalg_method      = default_options%amalg_method
+  coptions%refactor          = default_options%refactor
+  coptions%store_relidx      = default_options%store_relidx
+  coptions%memory_budget     = default_options%memory_budget
+  coptions%huge_pages        = default_options%huge_pages
+  coptions%cpu_lookahead     = default_options%cpu_lookahead
+  coptions%compress_factors  = default_options%compress_factors
 end subroutine spral_ssids_default_options
 
 subroutine spral_ssids_analyse(ccheck, n, corder, cptr, crow, cval, cakeep, &
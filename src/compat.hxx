@@ -17,4 +17,5 @@
 inline int omp_get_thread_num(void) { return 0; }
 inline int omp_get_num_threads(void) { return 1; }
 inline int omp_get_max_threads(void) { return 1; }
+inline int omp_in_parallel(void) { return 0; }
 #endif /* _OPENMP */
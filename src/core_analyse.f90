@@ -8,12 +8,14 @@
 !
 ! Routines originally based on HSL_MC78 v1.2.0
 module spral_core_analyse
+!$ use omp_lib
   implicit none
 
   private
   public :: basic_analyse ! Perform a full analysis for a given matrix ordering
 
   integer, parameter :: long = selected_int_kind(18)
+  integer, parameter :: wp = kind(0d0)
   integer, parameter :: ptr_kind = long ! integer kind used for user's
     ! column pointers (rptr is always long) - integer or long
 
@@ -22,6 +24,20 @@ module spral_core_analyse
   integer, parameter :: ERROR_ALLOCATION = -1
   integer, parameter :: WARNING_SINGULAR = 1
 
+  ! Parameters of the factorization time model used for cost-based
+  ! amalgamation and time prediction (see node_time()). These are typical
+  ! values for a modern multicore node, not calibrated per machine.
+  real(wp), parameter :: model_node_overhead = 2e-6_wp ! fixed cost of a node
+    ! (task creation, allocation, setup of assembly) in seconds
+  real(wp), parameter :: model_flop_rate = 1e10_wp ! flop rate achieved by
+    ! dense kernels on a wide node (flops/s)
+  real(wp), parameter :: model_half_width = 16.0_wp ! node width at which
+    ! dense kernels reach half of model_flop_rate
+  real(wp), parameter :: model_asm_time = 1e-9_wp ! time to assemble a single
+    ! contribution block entry into the parent (s)
+  real(wp), parameter :: model_mem_time = 5e-10_wp ! time to allocate and
+    ! write a single factor entry (s)
+
 contains
 
 !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
@@ -36,7 +52,8 @@ contains
 ! * Improving the sort algorithm used in find_row_idx
 !
   subroutine basic_analyse(n, ptr, row, perm, nnodes, sptr, &
-       sparent, rptr, rlist, nemin, info, stat, nfact, nflops)
+       sparent, rptr, rlist, nemin, info, stat, nfact, nflops, cost_amalg, &
+       ftime_serial, ftime_crit)
     implicit none
     integer, intent(in) :: n ! Dimension of system
     integer(ptr_kind), dimension(n+1), intent(in) :: ptr ! Column pointers
@@ -55,6 +72,13 @@ contains
     integer, intent(out) :: stat
     integer(long), intent(out) :: nfact
     integer(long), intent(out) :: nflops
+    logical, optional, intent(in) :: cost_amalg ! If present and .true., use
+      ! the cost model of node_time() to decide on amalgamation instead of
+      ! the nemin rule.
+    real(wp), optional, intent(out) :: ftime_serial ! Predicted factorization
+      ! time (s) on a single thread
+    real(wp), optional, intent(out) :: ftime_crit ! Predicted time (s) along
+      ! the critical path of the assembly tree
 
     integer :: i
     integer, dimension(:), allocatable :: invp ! inverse permutation of perm
@@ -118,7 +142,7 @@ contains
     allocate(tperm(n), sptr(n+1), sparent(n), scc(n), stat=st)
     if (st .ne. 0) goto 490
     call find_supernodes(n, realn, parent, cc, tperm, nnodes, sptr, sparent, &
-         scc, nemin, info, st)
+         scc, nemin, info, st, cost_amalg=cost_amalg)
     if (info .lt. 0) return
 
     ! Apply permutation to obtain final elimination order
@@ -133,10 +157,7 @@ contains
 
     ! Calculate info%num_factor and info%num_flops
     call calc_stats(nnodes, sptr, scc, nfact=nfact, nflops=nflops)
-
-    ! Sort entries of row lists
-    call dbl_tr_sort(n, nnodes, rptr, rlist, st)
-    if (st .ne. 0) goto 490
+    call predict_time(nnodes, sptr, sparent, scc, ftime_serial, ftime_crit)
 
     return
 
@@ -531,10 +552,12 @@ contains
 ! A node, u, and its parent, v, are merged if:
 ! (a) No new fill-in is introduced i.e. cc(v) = cc(u)-1
 ! (b) The number of columns in both u and v is less than nemin
+! If cost_amalg is .true., (b) is replaced by:
+! (b') node_time() predicts the merged node is cheaper than u and v separately
 !
 ! Note: assembly tree must be POSTORDERED on output
   subroutine find_supernodes(n, realn, parent, cc, sperm, nnodes, sptr, sparent, &
-       scc, nemin, info, st)
+       scc, nemin, info, st, cost_amalg)
     integer, intent(in) :: n
     integer, intent(in) :: realn
     integer, dimension(n), intent(in) :: parent ! parent(i) is the
@@ -550,8 +573,10 @@ contains
     integer, intent(in) :: nemin
     integer, intent(inout) :: info
     integer, intent(out) :: st ! stat paremter from allocate calls
+    logical, optional, intent(in) :: cost_amalg
 
     integer :: i, j, k
+    logical :: use_cost ! use cost model in place of nemin rule
     integer, dimension(:), allocatable :: height ! used to track height of tree
     logical, dimension(:), allocatable :: mark ! flag array for nodes to finalise
     integer, dimension(:), allocatable :: map ! map vertex idx -> supernode idx
@@ -573,6 +598,9 @@ contains
     integer :: start ! First pivot in block pivot
     integer :: totalwt ! sum of weights
 
+    use_cost = .false.
+    if (present(cost_amalg)) use_cost = cost_amalg
+
     !
     ! Initialise supernode representation
     !
@@ -629,7 +657,7 @@ contains
 
        do j = 1, nchild
           node = child(j)
-          if (do_merge(node, par, nelim, cc, ezero, nemin)) then
+          if (do_merge(node, par, nelim, cc, ezero, nemin, use_cost)) then
              ! Merge contents of node into par. Delete node.
              call merge_nodes(node, par, nelim, nvert, vhead, vnext, height, &
                   ezero, cc)
@@ -803,7 +831,7 @@ contains
 !
 ! Return .true. if we should merge node and par, .false. if we should not
 !
-  logical function do_merge(node, par, nelim, cc, ezero, nemin)
+  logical function do_merge(node, par, nelim, cc, ezero, nemin, use_cost)
     implicit none
     integer, intent(in) :: node ! node to merge and delete
     integer, intent(in) :: par ! parent to merge into
@@ -811,16 +839,77 @@ contains
     integer, dimension(:), intent(in) :: cc
     integer(long), dimension(:), intent(in) :: ezero
     integer, intent(in) :: nemin
+    logical, intent(in) :: use_cost ! if true, use cost model not nemin rule
+
+    integer :: mnode, mpar ! number of rows in node and par
+    integer :: width ! width used for kernel efficiency of unmerged nodes
+    real(wp) :: tmerged, tsplit
 
     if (ezero(par) .eq. huge(ezero)) then
        do_merge = .false.
        return
     end if
 
-    do_merge = ((cc(par) .eq. (cc(node)-1)) .and. (nelim(par) .eq. 1)) .or. &
-         ((nelim(par) .lt. nemin) .and. (nelim(node) .lt. nemin))
+    ! Always merge if no new fill-in is introduced
+    do_merge = ((cc(par) .eq. (cc(node)-1)) .and. (nelim(par) .eq. 1))
+    if (do_merge) return
+
+    if (use_cost) then
+       ! Merge if cheaper to factor the combined node, including the explicit
+       ! zeros it introduces, than the two nodes separately. The separate
+       ! nodes are credited with the kernel efficiency of the wider of the
+       ! two: a narrow node may still be merged with another neighbour, so
+       ! only the increase in width over that is a real gain (otherwise a
+       ! wide node would absorb every single column above it in a chain).
+       mnode = cc(node) + nelim(node) - 1
+       mpar = cc(par) + nelim(par) - 1
+       width = max(nelim(node), nelim(par))
+       tsplit = node_time(mnode, nelim(node), width) + &
+            node_time(mpar, nelim(par), width)
+       tmerged = node_time(mpar+nelim(node), nelim(par)+nelim(node))
+       do_merge = (tmerged .le. tsplit)
+    else
+       do_merge = ((nelim(par) .lt. nemin) .and. (nelim(node) .lt. nemin))
+    end if
   end function do_merge
 
+!
+! Return the predicted time in seconds to factorize a node with m rows and n
+! columns, including assembly of its contribution block into its parent.
+! If present, width replaces n in the kernel efficiency term.
+!
+! The model is
+!    t = c_node + flops / (R * n/(n+n_half)) + c_asm * (m-n)(m-n+1)/2
+!        + c_mem * nfact
+! where the kernel efficiency term n/(n+n_half) captures the poor performance
+! of BLAS on narrow nodes (see model_* parameters for values).
+!
+  real(wp) function node_time(m, n, width)
+    implicit none
+    integer, intent(in) :: m ! number of rows in node
+    integer, intent(in) :: n ! number of columns (eliminations) in node
+    integer, optional, intent(in) :: width
+
+    real(wp) :: rm, rn, a ! real(m), real(n) and real(m-n)
+    real(wp) :: rw ! width for kernel efficiency
+    real(wp) :: flops ! as calculated by calc_stats()
+    real(wp) :: nfact ! number of entries in factor
+
+    rm = real(m, wp)
+    rn = real(n, wp)
+    a = rm - rn
+    ! flops = sum_{j=1}^n (a+j)**2
+    flops = rn*a**2 + a*rn*(rn+1) + rn*(rn+1)*(2*rn+1)/6
+    nfact = rn*(rn+1)/2 + rn*a
+    rw = rn
+    if (present(width)) rw = real(width, wp)
+
+    node_time = model_node_overhead + &
+         flops / (model_flop_rate * rw/(rw+model_half_width)) + &
+         model_asm_time * a*(a+1)/2 + &
+         model_mem_time * nfact
+  end function node_time
+
 !
 ! This subroutine merges node with its parent, deleting node in the process.
 !
@@ -901,12 +990,68 @@ contains
     !print *, "nflops = ", nflops
   end subroutine calc_stats
 
+!
+! Predict the factorization time using the model of node_time(), both for a
+! serial run (sum over nodes) and along the critical path of the tree (the
+! lower bound on time with unlimited threads).
+!
+  subroutine predict_time(nnodes, sptr, sparent, scc, tserial, tcrit)
+    implicit none
+    integer, intent(in) :: nnodes
+    integer, dimension(nnodes+1), intent(in) :: sptr
+    integer, dimension(nnodes), intent(in) :: sparent
+    integer, dimension(nnodes), intent(in) :: scc
+    real(wp), optional, intent(out) :: tserial
+    real(wp), optional, intent(out) :: tcrit
+
+    integer :: node, par, st
+    real(wp) :: t, r_tserial, r_tcrit
+    real(wp), dimension(:), allocatable :: path ! path(i) is cost of longest
+      ! path from a leaf to the top of node i
+
+    if ((.not. present(tserial)) .and. (.not. present(tcrit))) return
+
+    allocate(path(nnodes), stat=st)
+    if (st .ne. 0) then
+       ! Not worth failing over, just report no prediction
+       if (present(tserial)) tserial = 0.0_wp
+       if (present(tcrit)) tcrit = 0.0_wp
+       return
+    end if
+    path(:) = 0.0_wp ! holds max over children until node itself is visited
+
+    r_tserial = 0.0_wp
+    r_tcrit = 0.0_wp
+    do node = 1, nnodes
+       t = node_time(scc(node), sptr(node+1)-sptr(node))
+       r_tserial = r_tserial + t
+       path(node) = path(node) + t
+       par = sparent(node)
+       if (par .le. nnodes) then
+          path(par) = max(path(par), path(node))
+       else
+          r_tcrit = max(r_tcrit, path(node))
+       end if
+    end do
+
+    if (present(tserial)) tserial = r_tserial
+    if (present(tcrit)) tcrit = r_tcrit
+  end subroutine predict_time
+
 !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 ! Row list routines
 !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 
 !
-! This subroutine determines the row indices for each supernode
+! This subroutine determines the row indices for each supernode. On exit the
+! row indices of each supernode are sorted into increasing order.
+!
+! The row list of a node is the union of its own pivots, the uneliminated
+! indices of its children and the entries of A in its columns (see
+! build_row_list()). As each node only depends on its children, independent
+! subtrees found by find_subtree_tasks() are processed in parallel, followed
+! by the remaining nodes nearer the root in serial. The output does not depend
+! on the number of threads.
 !
   subroutine find_row_lists(n, ptr, row, perm, invp, nnodes, &
        sptr, sparent, scc, rptr, rlist, info, st)
@@ -925,24 +1070,21 @@ contains
     integer, intent(inout) :: info
     integer, intent(out) :: st
 
-    integer :: child ! current child of node
-    integer :: col ! current column of matrix corresponding to piv
-    integer(long) :: i
-    integer(long) :: idx ! current insert position into nodes(node)%index
-    integer :: j
+    integer :: i
     integer :: node ! current node of assembly tree
-    integer :: piv ! current pivot position
-    integer, dimension(:), allocatable :: seen ! tag last time index was seen
+    integer :: ntask ! number of independent subtrees
+    integer :: t ! current subtree
+    integer, dimension(:), allocatable :: tfirst ! first node of each subtree
+    integer, dimension(:), allocatable :: troot ! root node of each subtree
+    logical, dimension(:), allocatable :: intask ! .true. if node is in a
+      ! subtree processed in parallel
     integer, dimension(:), allocatable :: chead ! head of child linked lists
     integer, dimension(:), allocatable :: cnext ! pointer to next child
+    integer, dimension(:), allocatable :: buf, work ! per-thread workspace
 
     ! Allocate and initialise memory
-    allocate(seen(n), chead(nnodes+1), cnext(nnodes+1), stat=st)
-    if (st .ne. 0) then
-       info = ERROR_ALLOCATION
-       return
-    end if
-    seen(:) = 0
+    allocate(chead(nnodes+1), cnext(nnodes+1), intask(nnodes), stat=st)
+    if (st .ne. 0) goto 490
     chead(:) = -1
 
     ! Build child linked lists (backwards so pop off in good order)
@@ -952,116 +1094,307 @@ contains
        chead(i) = node
     end do
 
-    ! Loop over nodes from bottom up building row lists.
+    ! Allocate space for row indices
     rptr(1) = 1
     do node = 1, nnodes
-
-       ! Allocate space for row indices
        rptr(node+1) = rptr(node) + scc(node)
-       idx = rptr(node) ! insert position
-
-       ! Add entries eliminated at this node
-       do piv = sptr(node), sptr(node+1)-1
-          seen(piv) = node
-          rlist(idx) = piv
-          idx = idx + 1
-       end do
+    end do
 
-       ! Find indices inherited from children
-       child = chead(node)
-       do while (child .ne. -1)
-          do i = rptr(child), rptr(child+1)-1
-             j = rlist(i)
-             if (j .lt. sptr(node)) cycle ! eliminated
-             if (seen(j) .eq. node) cycle ! already seen
-             seen(j) = node
-             rlist(idx) = j
-             idx = idx + 1
-          end do
-          child = cnext(child)
+    ! Build row lists of independent subtrees in parallel
+    call find_subtree_tasks(nnodes, sparent, scc, ntask, tfirst, troot, st)
+    if (st .ne. 0) goto 490
+    intask(:) = .false.
+    do t = 1, ntask
+       intask(tfirst(t):troot(t)) = .true.
+    end do
+    !$omp parallel default(shared) private(t, node, buf, work) &
+    !$omp    reduction(max:st) if(ntask.gt.1)
+    st = 0
+    !$omp do schedule(dynamic, 1)
+    do t = 1, ntask
+       if (st .ne. 0) cycle
+       do node = tfirst(t), troot(t)
+          call build_row_list(node, n, ptr, row, perm, invp, nnodes, sptr, &
+               rptr, rlist, chead, cnext, buf, work, st)
+          if (st .ne. 0) exit
        end do
+    end do
+    !$omp end do
+    if (allocated(buf)) deallocate(buf, work)
+    !$omp end parallel
+    if (st .ne. 0) goto 490
 
-       ! Find new indices from A
-       do piv = sptr(node), sptr(node+1)-1
-          col = invp(piv)
-          do i = ptr(col), ptr(col+1)-1
-             j = perm(row(i))
-             if (j .lt. piv) cycle ! in upper triangle
-             if (seen(j) .eq. node) cycle ! already seen in this snode
-             ! Otherwise, this is a new entry
-             seen(j) = node
-             rlist(idx) = j
-             idx = idx + 1
-          end do
-       end do
+    ! Build row lists of remaining nodes in serial
+    do node = 1, nnodes
+       if (intask(node)) cycle
+       call build_row_list(node, n, ptr, row, perm, invp, nnodes, sptr, &
+            rptr, rlist, chead, cnext, buf, work, st)
+       if (st .ne. 0) goto 490
     end do
-  end subroutine find_row_lists
+    return
 
-!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-! Assorted auxilary routines
-!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+490 continue
+    info = ERROR_ALLOCATION
+    return
+  end subroutine find_row_lists
 
 !
-! This subroutine performs a double transpose sort on the row indices of sn
+! Build the sorted row list of a single node, given those of its children.
+!
+! Candidate indices are gathered into buf, sorted and duplicates discarded.
+! buf and work are (re)allocated as required, and may be reused between
+! calls.
 !
-  subroutine dbl_tr_sort(n, nnodes, rptr, rlist, st)
+  subroutine build_row_list(node, n, ptr, row, perm, invp, nnodes, sptr, &
+       rptr, rlist, chead, cnext, buf, work, st)
     implicit none
+    integer, intent(in) :: node ! node to build row list for
     integer, intent(in) :: n
+    integer(ptr_kind), dimension(n+1), intent(in) :: ptr
+    integer, dimension(ptr(n+1)-1), intent(in) :: row
+    integer, dimension(n), intent(in) :: perm
+    integer, dimension(n), intent(in) :: invp
     integer, intent(in) :: nnodes
+    integer, dimension(nnodes+1), intent(in) :: sptr
     integer(long), dimension(nnodes+1), intent(in) :: rptr
     integer, dimension(rptr(nnodes+1)-1), intent(inout) :: rlist
+    integer, dimension(nnodes+1), intent(in) :: chead
+    integer, dimension(nnodes+1), intent(in) :: cnext
+    integer, dimension(:), allocatable, intent(inout) :: buf
+    integer, dimension(:), allocatable, intent(inout) :: work
     integer, intent(out) :: st
 
-    integer :: node
-    integer :: i, j
-    integer(long) :: ii, jj
-    integer(long), dimension(:), allocatable :: ptr
-    integer(long), dimension(:), allocatable :: nptr
-    integer, dimension(:), allocatable :: col
+    integer :: child ! current child of node
+    integer :: col ! current column of matrix corresponding to piv
+    integer(long) :: i
+    integer(long) :: idx ! current insert position into rlist
+    integer :: j
+    integer :: k
+    integer :: nbuf ! number of entries in buf
+    integer(long) :: need ! upper bound on number of entries in buf
+    integer :: piv ! current pivot position
 
-    allocate(ptr(n+2), stat=st)
-    if (st .ne. 0) return
-    ptr(:) = 0
+    st = 0
 
-    ! Count number of entries in each row. ptr(i+2) = #entries in row i
-    do node = 1, nnodes
-       do ii = rptr(node), rptr(node+1)-1
-          j = rlist(ii) ! row entry
-          ptr(j+2) = ptr(j+2) + 1
+    ! Ensure buf is large enough to hold all candidate indices
+    need = sptr(node+1) - sptr(node)
+    child = chead(node)
+    do while (child .ne. -1)
+       need = need + (rptr(child+1) - rptr(child))
+       child = cnext(child)
+    end do
+    do piv = sptr(node), sptr(node+1)-1
+       col = invp(piv)
+       need = need + (ptr(col+1) - ptr(col))
+    end do
+    if (allocated(buf)) then
+       if (size(buf) .lt. need) deallocate(buf, work)
+    end if
+    if (.not. allocated(buf)) then
+       allocate(buf(need), work(need), stat=st)
+       if (st .ne. 0) return
+    end if
+
+    ! Add entries eliminated at this node
+    nbuf = 0
+    do piv = sptr(node), sptr(node+1)-1
+       nbuf = nbuf + 1
+       buf(nbuf) = piv
+    end do
+
+    ! Add indices inherited from children
+    child = chead(node)
+    do while (child .ne. -1)
+       do i = rptr(child), rptr(child+1)-1
+          j = rlist(i)
+          if (j .lt. sptr(node)) cycle ! eliminated
+          nbuf = nbuf + 1
+          buf(nbuf) = j
        end do
+       child = cnext(child)
     end do
 
-    ! Determine row starts. ptr(i+1) = start of row i
-    ptr(1:2) = 1
-    do i = 1, n
-       ptr(i+2) = ptr(i+1) + ptr(i+2)
+    ! Add indices from A
+    do piv = sptr(node), sptr(node+1)-1
+       col = invp(piv)
+       do i = ptr(col), ptr(col+1)-1
+          j = perm(row(i))
+          if (j .lt. piv) cycle ! in upper triangle
+          nbuf = nbuf + 1
+          buf(nbuf) = j
+       end do
+    end do
+
+    ! Sort and store unique entries
+    call sort_increasing(nbuf, buf, work)
+    idx = rptr(node)
+    rlist(idx) = buf(1)
+    do k = 2, nbuf
+       if (buf(k) .eq. buf(k-1)) cycle ! duplicate
+       idx = idx + 1
+       rlist(idx) = buf(k)
     end do
+  end subroutine build_row_list
+
+!
+! Partition the assembly tree into independent subtrees for parallel
+! processing. Each subtree is a contiguous range of nodes tfirst(t):troot(t)
+! of the postordered tree, with weight (summed over its nodes) no more than
+! a fraction of the total weight so that there are several subtrees per
+! thread. Nodes above these subtrees are not in any subtree.
+!
+! If only a single thread is available, ntask is 0.
+!
+  subroutine find_subtree_tasks(nnodes, sparent, weight, ntask, tfirst, &
+       troot, st)
+    implicit none
+    integer, intent(in) :: nnodes
+    integer, dimension(nnodes), intent(in) :: sparent
+    integer, dimension(nnodes), intent(in) :: weight ! weight of each node
+    integer, intent(out) :: ntask ! number of subtrees found
+    integer, dimension(:), allocatable, intent(out) :: tfirst ! first node of
+      ! each subtree
+    integer, dimension(:), allocatable, intent(out) :: troot ! root node of
+      ! each subtree
+    integer, intent(out) :: st
+
+    integer, parameter :: tasks_per_thread = 4
 
-    jj = ptr(n+2)-1 ! total number of entries
-    allocate(col(jj), stat=st)
+    integer, dimension(:), allocatable :: first ! first descendant of node
+    integer :: node
+    integer :: nth ! number of threads
+    integer :: par
+    integer(long), dimension(:), allocatable :: swt ! weight of subtree
+    integer(long) :: threshold ! maximum weight of a subtree
+    integer(long) :: total ! weight of entire tree
+
+    ntask = 0
+    allocate(tfirst(nnodes), troot(nnodes), stat=st)
     if (st .ne. 0) return
 
-    ! Now fill in col array
+    nth = 1
+!$  nth = omp_get_max_threads()
+    if (nth .le. 1) return ! nothing to gain
+
+    ! Determine subtree weights and first descendants
+    allocate(first(nnodes), swt(nnodes), stat=st)
+    if (st .ne. 0) return
+    do node = 1, nnodes
+       first(node) = node
+       swt(node) = weight(node)
+    end do
+    total = 0
+    do node = 1, nnodes
+       par = sparent(node)
+       if (par .le. nnodes) then
+          swt(par) = swt(par) + swt(node)
+          first(par) = min(first(par), first(node))
+       else
+          total = total + swt(node)
+       end if
+    end do
+
+    ! Subtrees are those with root below threshold and parent above it
+    threshold = max(1_long, total / (tasks_per_thread*nth))
     do node = 1, nnodes
-       do ii = rptr(node), rptr(node+1)-1
-          j = rlist(ii) ! row entry
-          col( ptr(j+1) ) = node
-          ptr(j+1) = ptr(j+1) + 1
+       if (swt(node) .gt. threshold) cycle
+       par = sparent(node)
+       if (par .le. nnodes) then
+          if (swt(par) .le. threshold) cycle
+       end if
+       ntask = ntask + 1
+       tfirst(ntask) = first(node)
+       troot(ntask) = node
+    end do
+  end subroutine find_subtree_tasks
+
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+! Assorted auxilary routines
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+
+!
+! Sort a(1:n) into increasing order. Runs of length minsz_ms are sorted by
+! insertion sort, then merged bottom-up alternating between a and work.
+!
+  subroutine sort_increasing(n, a, work)
+    implicit none
+    integer, intent(in) :: n
+    integer, dimension(*), intent(inout) :: a
+    integer, dimension(*), intent(inout) :: work ! workspace of size n
+
+    integer :: i, j
+    integer :: lo, mid, hi
+    integer :: v
+    integer :: width ! length of sorted runs
+    logical :: in_a ! .true. if sorted runs are currently in a
+
+    ! Insertion sort runs of length minsz_ms
+    do lo = 1, n, minsz_ms
+       hi = min(lo+minsz_ms-1, n)
+       do i = lo+1, hi
+          v = a(i)
+          j = i - 1
+          do while (j .ge. lo)
+             if (a(j) .le. v) exit
+             a(j+1) = a(j)
+             j = j - 1
+          end do
+          a(j+1) = v
        end do
     end do
 
-    ! Finally transpose back into nodes
-    allocate(nptr(nnodes), stat=st)
-    if (st .ne. 0) return
-    nptr(:) = rptr(1:nnodes)
-    do i = 1, n
-       do jj = ptr(i), ptr(i+1)-1
-          node = col(jj)
-          rlist(nptr(node)) = i
-          nptr(node) = nptr(node) + 1
+    ! Merge pairs of runs until only one remains
+    width = minsz_ms
+    in_a = .true.
+    do while (width .lt. n)
+       do lo = 1, n, 2*width
+          mid = min(lo+width-1, n)
+          hi = min(lo+2*width-1, n)
+          if (in_a) then
+             call merge_runs(mid-lo+1, a(lo), hi-mid, a(mid+1), work(lo))
+          else
+             call merge_runs(mid-lo+1, work(lo), hi-mid, work(mid+1), a(lo))
+          end if
        end do
+       in_a = .not. in_a
+       width = 2*width
+    end do
+    if (.not. in_a) a(1:n) = work(1:n)
+  end subroutine sort_increasing
+
+!
+! Merge sorted lists x(1:nx) and y(1:ny) into z(1:nx+ny)
+!
+  subroutine merge_runs(nx, x, ny, y, z)
+    implicit none
+    integer, intent(in) :: nx
+    integer, dimension(nx), intent(in) :: x
+    integer, intent(in) :: ny
+    integer, dimension(ny), intent(in) :: y
+    integer, dimension(nx+ny), intent(out) :: z
+
+    integer :: i, j, k
+
+    i = 1
+    j = 1
+    do k = 1, nx+ny
+       if (j .gt. ny) then
+          z(k:nx+ny) = x(i:nx)
+          return
+       end if
+       if (i .gt. nx) then
+          z(k:nx+ny) = y(j:ny)
+          return
+       end if
+       if (x(i) .le. y(j)) then
+          z(k) = x(i)
+          i = i + 1
+       else
+          z(k) = y(j)
+          j = j + 1
+       end if
     end do
-  end subroutine dbl_tr_sort
+  end subroutine merge_runs
 
 !
 ! This subroutine applies the permutation perm to order, invp and cc
@@ -101,6 +101,20 @@ public:
       return gpus; // will be empty ifndef HAVE_NVCC
    }
 
+   /** \brief Bind memory area to the memory of object, migrating any pages
+    *         that have already been touched.
+    *  \returns 0 on success, -1 on failure. */
+   int bind_area(void const* addr, size_t len, hwloc_obj_t const& obj) const {
+#if HWLOC_API_VERSION >= 0x20000
+      return hwloc_set_area_membind(topology_, addr, len, obj->nodeset,
+            HWLOC_MEMBIND_BIND,
+            HWLOC_MEMBIND_MIGRATE | HWLOC_MEMBIND_BYNODESET);
+#else /* HWLOC_API_VERSION */
+      return hwloc_set_area_membind_nodeset(topology_, addr, len,
+            obj->nodeset, HWLOC_MEMBIND_BIND, HWLOC_MEMBIND_MIGRATE);
+#endif /* HWLOC_API_VERSION */
+   }
+
 private:
    int count_type(hwloc_obj_t const& obj, hwloc_obj_type_t type) const {
       if(obj->type == type) return 1;
@@ -14,6 +14,9 @@ module spral_ssids_akeep
    private
    public :: ssids_akeep
 
+   ! Last value assigned to akeep%id
+   integer(long), save :: last_id = 0
+
    type symbolic_subtree_ptr
       integer :: exec_loc
       class(symbolic_subtree_base), pointer :: ptr => null()
@@ -33,6 +36,8 @@ module spral_ssids_akeep
       type(symbolic_subtree_ptr), dimension(:), allocatable :: subtree
       integer, dimension(:), allocatable :: contrib_ptr
       integer, dimension(:), allocatable :: contrib_idx
+      integer, dimension(:), allocatable :: part_parent ! part containing
+         ! parent of part i, or nparts+1 if part i is a root
 
       integer(C_INT), dimension(:), allocatable :: invp ! inverse of pivot order
          ! that is passed to factorize phase
@@ -75,6 +80,10 @@ module spral_ssids_akeep
 
       ! Inform at end of analyse phase
       type(ssids_inform) :: inform
+
+      ! Identifies this analysis, so that a later factorization can tell if
+      ! fkeep was factorized using it. Changed by every call to free().
+      integer(long) :: id = 0
    contains
       procedure, pass(akeep) :: free => free_akeep
    end type ssids_akeep
@@ -103,6 +112,7 @@ subroutine free_akeep(akeep, flag)
    endif
    deallocate(akeep%contrib_ptr, stat=st)
    deallocate(akeep%contrib_idx, stat=st)
+   deallocate(akeep%part_parent, stat=st)
    deallocate(akeep%invp, stat=st)
    deallocate(akeep%nlist, stat=st)
    deallocate(akeep%nptr, stat=st)
@@ -115,6 +125,12 @@ subroutine free_akeep(akeep, flag)
    deallocate(akeep%map, stat=st)
    deallocate(akeep%scaling, stat=st)
    deallocate(akeep%topology, stat=st)
+
+   ! Any factorization using the old analysis must not be reused
+   !$omp atomic capture
+   last_id = last_id + 1
+   akeep%id = last_id
+   !$omp end atomic
 end subroutine free_akeep
 
 end module spral_ssids_akeep
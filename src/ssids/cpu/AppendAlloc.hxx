@@ -7,9 +7,11 @@
 
 //#define MEM_STATS
 
+#include <cstring>
 #include <memory>
 
 #include "compat.hxx" // for std::align if required
+#include "ssids/cpu/SystemMemory.hxx"
 
 namespace spral { namespace ssids { namespace cpu {
 
@@ -17,20 +19,23 @@ namespace append_alloc_internal {
 
 /** A single fixed size page of memory with allocate function.
  * We are required to guarantee it is zero'd, so use calloc rather than anything
- * else for the allocation.
+ * else for the allocation, or a SystemMemory (which places the memory in a
+ * NUMA region and may back it with huge pages) if one is given.
  * Deallocation is not supported.
  */
 class Page {
-#if defined(__AVX512F__)
+#if defined(__AVX512F__) || defined(HAVE_AVX512_KERNELS)
   static const int align = 64; // 64 byte alignment
-#elif defined(__AVX__)
+#elif defined(__AVX__) || defined(HAVE_AVX2_KERNELS)
   static const int align = 32; // 32 byte alignment
 #else
   static const int align = 16; // 16 byte alignment
 #endif
 public:
-   Page(size_t sz, Page* next=nullptr)
-   : next(next), mem_(calloc(sz+align, 1)), ptr_(mem_), space_(sz+align)
+   Page(size_t sz, Page* next=nullptr, SystemMemory* sys_mem=nullptr)
+   : next(next), sys_mem_(sys_mem),
+     mem_(sys_mem ? sys_mem->allocate(sz+align, true) : calloc(sz+align, 1)),
+     ptr_(mem_), space_(sz+align)
    {
       if(!mem_) throw std::bad_alloc();
    }
@@ -44,7 +49,8 @@ public:
       printf("AppendAlloc: Used      %16ld (%.2e GB)\n",
             used, 1e-9*double(used));
 #endif /* MEM_STATS */
-      free(mem_);
+      if(sys_mem_) sys_mem_->deallocate(mem_);
+      else free(mem_);
    }
    void* allocate(size_t sz) {
       if(!std::align(align, sz, ptr_, space_)) return nullptr;
@@ -53,9 +59,25 @@ public:
       space_ -= sz;
       return ret;
    }
+   /** Return number of bytes used so far */
+   size_t used() const {
+      return static_cast<char*>(ptr_) - static_cast<char*>(mem_);
+   }
+   /** Return total number of bytes that may be allocated */
+   size_t capacity() const {
+      return used() + space_ - align;
+   }
+   /** Discard all allocations, zeroing the memory they used */
+   void reset() {
+      size_t sz = used();
+      memset(mem_, 0, sz);
+      ptr_ = mem_;
+      space_ += sz;
+   }
 public:
    Page* const next;
 private:
+   SystemMemory *const sys_mem_; // Source of mem_, or null if calloc
    void *const mem_; // Pointer to memory so we can free it
    void *ptr_; // Next address to return
    size_t space_; // Amount of free memory
@@ -69,8 +91,9 @@ class Pool {
    // Changed to 0MB to allow pages of no minimum size for performance
    // see https://github.com/ralna/spral/issues/119 for more details
 public:
-   Pool(size_t initial_size)
-   : top_page_(new Page(std::max(PAGE_SIZE, initial_size)))
+   Pool(size_t initial_size, SystemMemory* sys_mem=nullptr)
+   : sys_mem_(sys_mem),
+     top_page_(new Page(std::max(PAGE_SIZE, initial_size), nullptr, sys_mem))
    {}
    Pool(const Pool&) =delete; // Not copyable
    Pool& operator=(const Pool&) =delete; // Not copyable
@@ -86,16 +109,55 @@ public:
       void* ptr;
       #pragma omp critical
       {
-         ptr = top_page_->allocate(sz);
+         ptr = (top_page_) ? top_page_->allocate(sz) : nullptr;
          if(!ptr) { // Insufficient space on current top page, make a new one
-            top_page_ = new Page(std::max(PAGE_SIZE, sz), top_page_);
+            // (after release(), big enough for everything it freed)
+            top_page_ = new Page(std::max(std::max(PAGE_SIZE, sz), released_),
+                  top_page_, sys_mem_);
+            released_ = 0;
             ptr = top_page_->allocate(sz);
          }
       }
       return ptr;
    }
+   /** Discard all allocations, retaining the memory for reuse. If more than
+    * one page is in use they are replaced by a single page of their combined
+    * size, so that a repeat of the same allocations fits on one page. The old
+    * pages are freed first, so memory use does not double meanwhile. */
+   void reset() {
+      if(!top_page_) return;
+      if(top_page_->next) {
+         size_t sz = 0;
+         for(Page* page=top_page_; page; page=page->next)
+            sz += page->capacity();
+         for(Page* page=top_page_; page; ) {
+            Page* next = page->next;
+            delete page;
+            page = next;
+         }
+         top_page_ = nullptr; // Valid (empty) state if the new page throws
+         top_page_ = new Page(sz, nullptr, sys_mem_);
+      } else {
+         top_page_->reset();
+      }
+   }
+   /** Discard all allocations and free their memory. The next allocation
+    * obtains a single page of the combined size freed, so that a repeat of
+    * the same allocations needs only one system allocation. */
+   void release() {
+      released_ = 0;
+      for(Page* page=top_page_; page; ) {
+         Page* next = page->next;
+         released_ += page->capacity();
+         delete page;
+         page = next;
+      }
+      top_page_ = nullptr;
+   }
 private:
+   SystemMemory* const sys_mem_; // Source of pages, or null for calloc
    Page* top_page_;
+   size_t released_ = 0; // Size of first page after release()
 };
 
 } /* namespace spral::ssids::cpu::append_alloc_internal */
@@ -109,8 +171,12 @@ class AppendAlloc {
 public :
    typedef T               value_type;
 
-   AppendAlloc(size_t initial_size)
-   : pool_(new append_alloc_internal::Pool(initial_size))
+   /** \brief Constructor.
+    *  \param initial_size Size in bytes of the first page.
+    *  \param sys_mem Source of pages, or null to use calloc. Must outlive
+    *         this and all copies of it. */
+   AppendAlloc(size_t initial_size, SystemMemory* sys_mem=nullptr)
+   : pool_(new append_alloc_internal::Pool(initial_size, sys_mem))
    {}
 
    /** Rebind a type T to a type U AppendAlloc */
@@ -125,6 +191,17 @@ public :
    void deallocate(T* p, std::size_t n) {
       throw std::runtime_error("Deallocation not supported on AppendAlloc");
    }
+   /** Invalidate everything allocated so far (from this or any rebound copy
+    * of this allocator) so the memory may be reused, zeroed, by subsequent
+    * allocations. Must not be called concurrently with allocate(). */
+   void reset() {
+      pool_->reset();
+   }
+   /** As reset(), but the memory is freed rather than kept for reuse (see
+    * Pool::release()). */
+   void release() {
+      pool_->release();
+   }
    template<class U>
    bool operator==(AppendAlloc<U> const& rhs) {
       return true;
@@ -9,6 +9,7 @@
 #include <type_traits>
 #include <vector>
 
+#include "config.h" // for HAVE_AVX*_KERNELS
 #include "omp.hxx"
 
 namespace spral { namespace ssids { namespace cpu {
@@ -20,9 +21,9 @@ namespace spral { namespace ssids { namespace cpu {
 template <typename T, typename Allocator>
 class BlockPool {
    typedef typename std::allocator_traits<Allocator>::template rebind_traits<char> CharAllocTraits;
-#if defined(__AVX512F__)
+#if defined(__AVX512F__) || defined(HAVE_AVX512_KERNELS)
   static const std::size_t align_ = 64; //< Alignment for AVX512 is 64 bytes
-#elif defined(__AVX__)
+#elif defined(__AVX__) || defined(HAVE_AVX2_KERNELS)
   static const std::size_t align_ = 32; //< Alignment for AVX(2) is 32 bytes
 #else
   static const std::size_t align_ = 16; //< Alignment for SSE(2,3,4.1,4.2) or Power's VSX is 16 bytes
@@ -38,7 +39,9 @@ public:
       // Calculate size in elements
       std::size_t sz = block_dimn_*block_dimn_*sizeof(T);
       block_size_ = align_*((sz-1)/align_ + 1);
-      mem_ = CharAllocTraits::allocate(alloc_, num_blocks*block_size_);
+      mem_ = (num_blocks > 0)
+         ? CharAllocTraits::allocate(alloc_, num_blocks*block_size_)
+         : nullptr;
       // Set up stack of free blocks such that we issue them in order
       pool_.reserve(num_blocks);
       for(int i=num_blocks-1; i>=0; --i) {
@@ -47,7 +50,8 @@ public:
    }
    ~BlockPool() {
       // FIXME: Throw an exception if we've not had all memory returned? 
-      CharAllocTraits::deallocate(alloc_, mem_, num_blocks_*block_size_);
+      if(mem_)
+         CharAllocTraits::deallocate(alloc_, mem_, num_blocks_*block_size_);
    }
 
    /** Get next free block in a thread-safe fashion.
@@ -80,6 +84,15 @@ public:
       spral::omp::AcquiredLock scopeLock(lock_);
       pool_.push_back(ptr);
    }
+   /** Return true if ptr is a block belonging to this pool */
+   bool owns(T const* ptr) const {
+      char const* cptr = reinterpret_cast<char const*>(ptr);
+      return (cptr >= mem_ && cptr < mem_ + num_blocks_*block_size_);
+   }
+   /** Return total size of pool in bytes */
+   std::size_t get_mem() const {
+      return num_blocks_*block_size_;
+   }
 private:
    typename CharAllocTraits::allocator_type alloc_;
    std::size_t num_blocks_; //< Number of blocks
@@ -9,6 +9,7 @@
 
 #include <memory>
 
+#include "config.h" // for HAVE_AVX*_KERNELS
 #include "omp.hxx"
 
 namespace spral { namespace ssids { namespace cpu {
@@ -40,9 +41,9 @@ class Page {
    // \}
    static int const nlevel=16; ///< Number of divisions to smallest allocation unit.
   
-#if defined(__AVX512F__)
+#if defined(__AVX512F__) || defined(HAVE_AVX512_KERNELS)
   static int const align=64; ///< Underlying alignment of all pointers returned
-#elif defined(__AVX__)
+#elif defined(__AVX__) || defined(HAVE_AVX2_KERNELS)
   static int const align=32; ///< Underlying alignment of all pointers returned
 #else
   static int const align=16; ///< Underlying alignment of all pointers returned
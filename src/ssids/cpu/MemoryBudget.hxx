@@ -0,0 +1,118 @@
+/** \file
+ *  \copyright 2016 The Science and Technology Facilities Council (STFC)
+ *  \licence   BSD licence, see LICENCE file for details
+ *  \author    Jonathan Hogg
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace spral { namespace ssids { namespace cpu {
+
+/**
+ * \brief Limit on the memory held by the pool allocators of a
+ *        factorization, shared by all of its subtrees.
+ *
+ * The pools (see ThreadCacheAllocator) charge memory by allocate() as it is
+ * first drawn, rounded up as they round it, and keep it charged while freed
+ * blocks are cached for reuse. Only large blocks given back to the system
+ * are returned by release(). The limit thus bounds the resident memory of
+ * the pools, which hold contribution blocks, backups and column data.
+ *
+ * Before a task that allocates contribution blocks is started, the most
+ * memory it may draw for them is reserved by try_reserve(), and the
+ * reservation is returned by release(bytes, false) once they are
+ * allocated. Memory is charged before the reservation is returned, so the
+ * memory counted never falls below that held. Each successful try_reserve()
+ * counts as a running task until the matching finish(). The limit is not
+ * absolute: try_reserve() may be forced to let the factorization progress,
+ * and backups and column data are charged without a reservation.
+ *
+ * Counters are atomic so that subtrees do not serialize on a lock. Only
+ * factorizations with a limit use a budget at all (subtrees are given a null
+ * budget otherwise), so none of this is on the path of unlimited runs.
+ */
+class MemoryBudget {
+public:
+   MemoryBudget() =default;
+   MemoryBudget(MemoryBudget const&) =delete;
+   MemoryBudget& operator=(MemoryBudget const&) =delete;
+
+   /** \brief Set limit for a new factorization and reset peak.
+    *
+    *  Must not be called concurrently with any other member.
+    *  \param limit Limit in bytes. No limit if not positive. */
+   void reset(int64_t limit) {
+      limit_ = limit;
+      peak_ = allocated_.load();
+   }
+
+   /** \brief Return true if a limit is set. */
+   bool has_limit() const {
+      return limit_ > 0;
+   }
+
+   /** \brief Reserve memory for a task if it fits within the limit.
+    *  \param bytes Memory to reserve.
+    *  \param force If true, reserve even if the limit is exceeded.
+    *  \returns true if the memory was reserved, false otherwise. */
+   bool try_reserve(size_t bytes, bool force=false) {
+      int64_t const b = static_cast<int64_t>(bytes);
+      int64_t used = used_.load();
+      do {
+         if(!force && limit_ > 0 && used + b > limit_) return false;
+      } while(!used_.compare_exchange_weak(used, used + b));
+      ++running_;
+      return true;
+   }
+
+   /** \brief Mark a task that reserved memory as finished. */
+   void finish(int ntask=1) {
+      running_ -= ntask;
+   }
+
+   /** \brief Charge memory drawn by a pool. */
+   void allocate(size_t bytes) {
+      used_ += static_cast<int64_t>(bytes);
+      int64_t alloc = (allocated_ += static_cast<int64_t>(bytes));
+      int64_t peak = peak_.load();
+      while(alloc > peak && !peak_.compare_exchange_weak(peak, alloc));
+   }
+
+   /** \brief Return memory given back by a pool, or (if allocated is
+    *         false) a reservation. */
+   void release(size_t bytes, bool allocated=true) {
+      used_ -= static_cast<int64_t>(bytes);
+      if(allocated) allocated_ -= static_cast<int64_t>(bytes);
+   }
+
+   /** \brief Return number of tasks with a reservation that have not
+    *         finished. */
+   int get_running() const {
+      return running_.load();
+   }
+
+   /** \brief Return memory that may be used without exceeding the limit,
+    *         or SIZE_MAX if there is no limit. */
+   size_t get_available() const {
+      if(limit_ <= 0) return SIZE_MAX;
+      return static_cast<size_t>(std::max<int64_t>(limit_ - used_.load(), 0));
+   }
+
+   /** \brief Return peak memory held by the pools since last reset(). */
+   int64_t get_peak() const {
+      return peak_.load();
+   }
+
+private:
+   int64_t limit_ = 0; ///< Limit on used_, no limit if not positive
+   std::atomic<int64_t> used_{0}; ///< Memory held or reserved
+   std::atomic<int64_t> allocated_{0}; ///< Memory held by pools
+   std::atomic<int64_t> peak_{0}; ///< Peak of allocated_
+   std::atomic<int> running_{0}; ///< Tasks with a reservation not finished
+};
+
+}}} /* namespaces spral::ssids::cpu */
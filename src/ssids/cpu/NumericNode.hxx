@@ -5,6 +5,11 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <cstring>
+
+#include "ssids/cpu/MemoryBudget.hxx"
+
 namespace spral { namespace ssids { namespace cpu {
 
 class SymbolicNode;
@@ -17,9 +22,14 @@ public:
     * \brief Constructor
     * \param symb Associated symbolic node.
     * \param pool_alloc Pool Allocator to use for contrib allocation.
+    * \param budget Budget holding the reservation for our contrib, or
+    *        nullptr if none. The pool charges the allocation itself.
     */
-   NumericNode(SymbolicNode const& symb, PoolAllocator const& pool_alloc)
-   : symb(symb), contrib(nullptr), pool_alloc_(pool_alloc)
+   NumericNode(SymbolicNode const& symb, PoolAllocator const& pool_alloc,
+         MemoryBudget* budget=nullptr)
+   : symb(symb), contrib(nullptr), ldcontrib(symb.nrow - symb.ncol),
+     contrib_inplace(false), pool_alloc_(pool_alloc), budget_(budget),
+     contrib_reserved_(0), contrib_base_(nullptr), contrib_len_(0)
    {}
    /**
     * \brief Destructor
@@ -33,20 +43,85 @@ public:
     *
     * Note done at construction time, as a major memory commitment that is
     * transitory.
+    *
+    * \param inplace If true, allocate enough space for ancestors to build
+    *        their contribution blocks in place in ours (see adopt_contrib()).
+    */
+   void alloc_contrib(bool inplace=false) {
+      ldcontrib = (inplace) ? symb.contrib_ld : symb.nrow - symb.ncol;
+      contrib_len_ = get_contrib_size(inplace) / sizeof(T);
+      contrib_base_ = (contrib_len_>0)
+         ? PATraits::allocate(pool_alloc_, contrib_len_)
+         : nullptr;
+      contrib = contrib_base_;
+      contrib_inplace = false;
+      cancel_contrib_reservation(); // now charged by pool_alloc_
+   }
+
+   /** \brief Return size in bytes that alloc_contrib() will allocate. */
+   size_t get_contrib_size(bool inplace=false) const {
+      size_t ld = (inplace) ? symb.contrib_ld : symb.nrow - symb.ncol;
+      return ld*ld*sizeof(T);
+   }
+
+   /**
+    * \brief Record memory reserved in the budget for our contribution block.
+    *
+    * The reservation is returned by alloc_contrib() once the pool has charged
+    * the allocation, or by adopt_contrib() or cancel_contrib_reservation().
+    */
+   void set_contrib_reserved(size_t bytes) {
+      contrib_reserved_ = bytes;
+   }
+
+   /** \brief Set budget future reservations are made in, or nullptr if
+    *         none. Must not hold a reservation. */
+   void set_budget(MemoryBudget* budget) {
+      budget_ = budget;
+   }
+
+   /** \brief Return any reservation not used by alloc_contrib(). */
+   void cancel_contrib_reservation() {
+      if(budget_ && contrib_reserved_>0)
+         budget_->release(contrib_reserved_, false);
+      contrib_reserved_ = 0;
+   }
+
+   /**
+    * \brief Take over the contribution block of our only child in place.
+    *
+    * Our contribution block is the trailing submatrix of the child's from
+    * diagonal offset symb.inplace_offset, extended by new trailing rows and
+    * columns in storage the child allocated for this. The part shared with
+    * the child already holds the child's contribution to it, so needs no
+    * copying; the new part is zeroed. The factorization must then add to
+    * contrib rather than overwrite it.
     */
-   void alloc_contrib() {
-      size_t contrib_dimn = symb.nrow - symb.ncol;
-      contrib_dimn = contrib_dimn*contrib_dimn;
-      contrib = (contrib_dimn>0) ? PATraits::allocate(pool_alloc_, contrib_dimn)
-                                 : nullptr;
+   void adopt_contrib(NumericNode& child) {
+      int m = symb.nrow - symb.ncol;
+      int cm = child.symb.nrow - child.symb.ncol;
+      int offset = symb.inplace_offset;
+      ldcontrib = child.ldcontrib;
+      contrib = &child.contrib[offset*(ldcontrib+1)];
+      contrib_base_ = child.contrib_base_;
+      contrib_len_ = child.contrib_len_;
+      contrib_inplace = true;
+      child.contrib = nullptr;
+      child.contrib_base_ = nullptr;
+      cancel_contrib_reservation(); // no new memory needed
+      // Zero new rows and columns (lower triangle only)
+      int nold = cm - offset;
+      for(int j=0; j<m; ++j) {
+         int from = std::max(j, nold);
+         memset(&contrib[j*ldcontrib+from], 0, (m-from)*sizeof(T));
+      }
    }
 
    /** \brief Free space for contribution block (if allocated) */
    void free_contrib() {
-      if(!contrib) return;
-      size_t contrib_dimn = symb.nrow - symb.ncol;
-      contrib_dimn = contrib_dimn*contrib_dimn;
-      PATraits::deallocate(pool_alloc_, contrib, contrib_dimn);
+      if(!contrib_base_) return;
+      PATraits::deallocate(pool_alloc_, contrib_base_, contrib_len_);
+      contrib_base_ = nullptr;
       contrib = nullptr;
    }
 
@@ -70,9 +145,16 @@ public:
    T *lcol; // Pointer to start of factor data
    int *perm; // Pointer to permutation
    T *contrib; // Pointer to contribution block
+   int ldcontrib; // Leading dimension of contrib
+   bool contrib_inplace; // contrib was adopted from child, so factorization
+                         // must add to it rather than overwrite it
 private:
    PoolAllocator pool_alloc_; // Our own version of pool allocator for freeing
                               // contrib
+   MemoryBudget* budget_; // Budget contrib is reserved in (if any)
+   size_t contrib_reserved_; // Bytes reserved in budget_ for contrib
+   T *contrib_base_; // Start of storage contrib lies in (may be a child's)
+   size_t contrib_len_; // Length of contrib_base_
 };
 
 }}} /* namespaces spral::ssids::cpu */
@@ -19,9 +19,8 @@ using namespace spral::ssids::cpu;
 namespace {
 
 typedef double T;
-const int PAGE_SIZE = 8*1024*1024; // 8MB
-typedef NumericSubtree<true, T, PAGE_SIZE, AppendAlloc<T>> NumericSubtreePosdef;
-typedef NumericSubtree<false, T, PAGE_SIZE, AppendAlloc<T>> NumericSubtreeIndef;
+typedef NumericSubtree<true, T, AppendAlloc<T>> NumericSubtreePosdef;
+typedef NumericSubtree<false, T, AppendAlloc<T>> NumericSubtreeIndef;
 
 } /* end of anon namespace */
 //////////////////////////////////////////////////////////////////////////
@@ -34,6 +33,8 @@ void* spral_ssids_cpu_create_num_subtree_dbl(
       const double *const scaling, // Scaling vector (NULL if none)
       void** child_contrib, // Contributions from child subtrees
       struct cpu_factor_options const* options, // Options in
+      void* budget, // MemoryBudget shared by subtrees (NULL if none)
+      int numa_region, // NUMA region to place factors in (-1 if none)
       ThreadStats* stats // Info out
       ) {
    auto const& symbolic_subtree = *static_cast<SymbolicSubtree const*>(symbolic_subtree_ptr);
@@ -41,7 +42,8 @@ void* spral_ssids_cpu_create_num_subtree_dbl(
    // Perform factorization
    if(posdef) {
       auto* subtree = new NumericSubtreePosdef
-         (symbolic_subtree, aval, scaling, child_contrib, *options, *stats);
+         (symbolic_subtree, aval, scaling, child_contrib, *options,
+          static_cast<MemoryBudget*>(budget), numa_region, *stats);
       if(options->print_level > 9999) {
          printf("Final factors:\n");
          subtree->print();
@@ -49,7 +51,8 @@ void* spral_ssids_cpu_create_num_subtree_dbl(
       return (void*) subtree;
    } else { /* indef */
       auto* subtree = new NumericSubtreeIndef
-         (symbolic_subtree, aval, scaling, child_contrib, *options, *stats);
+         (symbolic_subtree, aval, scaling, child_contrib, *options,
+          static_cast<MemoryBudget*>(budget), numa_region, *stats);
       if(options->print_level > 9999) {
          printf("Final factors:\n");
          subtree->print();
@@ -58,6 +61,62 @@ void* spral_ssids_cpu_create_num_subtree_dbl(
    }
 }
 
+extern "C"
+void spral_ssids_cpu_refactor_num_subtree_dbl(
+      bool posdef,
+      void* subtree_ptr, // pointer to relevant type of NumericSubtree
+      const double *const aval, // Values of A
+      const double *const scaling, // Scaling vector (NULL if none)
+      void** child_contrib, // Contributions from child subtrees
+      struct cpu_factor_options const* options, // Options in
+      void* budget, // MemoryBudget shared by subtrees (NULL if none)
+      ThreadStats* stats // Info out
+      ) {
+   // Perform refactorization
+   try {
+      if(posdef) {
+         auto &subtree = *static_cast<NumericSubtreePosdef*>(subtree_ptr);
+         subtree.refactor(aval, scaling, child_contrib, *options,
+               static_cast<MemoryBudget*>(budget), *stats);
+         if(options->print_level > 9999) {
+            printf("Final factors:\n");
+            subtree.print();
+         }
+      } else { /* indef */
+         auto &subtree = *static_cast<NumericSubtreeIndef*>(subtree_ptr);
+         subtree.refactor(aval, scaling, child_contrib, *options,
+               static_cast<MemoryBudget*>(budget), *stats);
+         if(options->print_level > 9999) {
+            printf("Final factors:\n");
+            subtree.print();
+         }
+      }
+   } catch(std::bad_alloc const&) {
+      *stats = ThreadStats();
+      stats->flag = Flag::ERROR_ALLOCATION;
+   }
+}
+
+extern "C"
+void* spral_ssids_cpu_create_memory_budget() {
+   return (void*) new MemoryBudget();
+}
+
+extern "C"
+void spral_ssids_cpu_destroy_memory_budget(void* budget) {
+   delete static_cast<MemoryBudget*>(budget);
+}
+
+extern "C"
+void spral_ssids_cpu_memory_budget_reset(void* budget, int64_t limit) {
+   static_cast<MemoryBudget*>(budget)->reset(limit);
+}
+
+extern "C"
+int64_t spral_ssids_cpu_memory_budget_peak(void* budget) {
+   return static_cast<MemoryBudget*>(budget)->get_peak();
+}
+
 extern "C"
 void spral_ssids_cpu_destroy_num_subtree_dbl(bool posdef, void* target) {
    if(!target) return;
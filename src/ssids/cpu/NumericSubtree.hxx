@@ -5,14 +5,24 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
 #include "ssids/profile.hxx"
 #include "ssids/cpu/cpu_iface.hxx"
 #include "ssids/cpu/factor.hxx"
 #include "ssids/cpu/BuddyAllocator.hxx"
+#include "ssids/cpu/MemoryBudget.hxx"
 #include "ssids/cpu/NumericNode.hxx"
 #include "ssids/cpu/SymbolicSubtree.hxx"
+#include "ssids/cpu/SystemMemory.hxx"
 #include "ssids/cpu/SmallLeafNumericSubtree.hxx"
+#include "ssids/cpu/ThreadCacheAllocator.hxx"
 #include "ssids/cpu/ThreadStats.hxx"
+#include "ssids/cpu/kernels/simd_kernels.hxx"
 
 
 namespace spral { namespace ssids { namespace cpu {
@@ -21,17 +31,16 @@ namespace spral { namespace ssids { namespace cpu {
  *
  * \tparam posdef true for Cholesky factorization, false for indefinite LDL^T
  * \tparam T underlying numerical type e.g. double
- * \tparam PAGE_SIZE initial size to be used for thread Workspace
  * \tparam FactorAllocator allocator to be used for factor storage. It must
  *         zero memory upon allocation (eg through calloc or memset).
  * */
 template <bool posdef, //< true for Cholesky factoriztion, false for indefinte
           typename T,
-          size_t PAGE_SIZE,
           typename FactorAllocator
           >
 class NumericSubtree {
-   typedef BuddyAllocator<T,std::allocator<T>> PoolAllocator;
+   typedef ThreadCacheAllocator<T,SystemAllocator<T>> PoolAllocator;
+   //typedef BuddyAllocator<T,std::allocator<T>> PoolAllocator;
    //typedef SimpleAlignedAllocator<T> PoolAllocator;
    typedef SmallLeafNumericSubtree<posdef, T, FactorAllocator, PoolAllocator> SLNS;
 public:
@@ -48,6 +57,14 @@ public:
     *         subtrees. Information to be extracted by call to Fortran routine
     *         spral_ssids_contrib_get_data().
     *  \param options user-supplied options controlling execution.
+    *  \param budget limit on the memory held by the pool allocators of this
+    *         and any other subtrees factorized at the same time. Tasks are
+    *         held back while their contribution blocks may exceed it (see
+    *         reserve_task()). Should be null if there is no limit, so that
+    *         no accounting is done.
+    *  \param numa_region NUMA region (counted from 0) whose threads will
+    *         factorize the subtree. Factor, pool and workspace memory is
+    *         bound to it so that it is local to them. No binding if -1.
     *  \param stats collection of statistics for return to user.
     */
    NumericSubtree(
@@ -56,33 +73,408 @@ public:
          T const* scaling,
          void** child_contrib,
          struct cpu_factor_options const& options,
+         MemoryBudget* budget,
+         int numa_region,
          ThreadStats& stats)
-   : symb_(symbolic_subtree),
-     factor_alloc_(symbolic_subtree.get_factor_mem_est(options.multiplier)),
-     pool_alloc_(symbolic_subtree.get_pool_size<T>()),
-     small_leafs_(static_cast<SLNS*>(::operator new[](symb_.small_leafs_.size()*sizeof(SLNS))))
+   : symb_(symbolic_subtree), budget_(budget),
+     sys_mem_(numa_region, options.huge_pages),
+     factor_alloc_(
+           symbolic_subtree.get_factor_mem_est(posdef, options.multiplier),
+           &sys_mem_
+           ),
+     pool_alloc_(symbolic_subtree.get_pool_size<T>(posdef),
+           SystemAllocator<T>(&sys_mem_)),
+     small_leafs_(static_cast<SLNS*>(::operator new[](symb_.small_leafs_.size()*sizeof(SLNS)))),
+     solve_maxfront_(1)
    {
       /* Associate symbolic nodes to numeric ones; copy tree structure */
       nodes_.reserve(symbolic_subtree.nnodes_+1);
       for(int ni=0; ni<symb_.nnodes_+1; ++ni) {
-         nodes_.emplace_back(symbolic_subtree[ni], pool_alloc_);
+         nodes_.emplace_back(symbolic_subtree[ni], pool_alloc_, budget);
          auto* fc = symbolic_subtree[ni].first_child;
          nodes_[ni].first_child = fc ? &nodes_[fc->idx] : nullptr;
          auto* nc = symbolic_subtree[ni].next_child;
          nodes_[ni].next_child = nc ? &nodes_[nc->idx] :  nullptr;
       }
 
+      pool_alloc_.set_budget(budget);
+      factor(aval, scaling, child_contrib, options, stats, false);
+   }
+   ~NumericSubtree() {
+      sys_mem_.deallocate(lfac_);
+      delete[] small_leafs_;
+   }
+
+   /** \brief Refactorize with new values, reusing the storage of the
+    *         previous factorization and, if options.refactor is set and
+    *         where possible, its pivot sequence.
+    *
+    *  The factor allocator is rewound rather than released, zeroing only
+    *  the memory the previous factorization used, and the pool allocator
+    *  keeps its regions, so no new memory is needed (or touched for the
+    *  first time) if the delays are unchanged. If reusing pivots in the
+    *  indefinite case, each node outside the small leaf subtrees whose
+    *  fully summed variables are those of the previous factorization is
+    *  first factorized in the previous pivot order, with the same 1x1 and
+    *  2x2 pivots and no pivot search. Only if one of these fails the
+    *  threshold test is the node factorized again with full pivoting; such
+    *  nodes are counted in stats.not_refactored.
+    *
+    *  Arguments are as for the constructor.
+    */
+   void refactor(
+         T const* aval,
+         T const* scaling,
+         void** child_contrib,
+         struct cpu_factor_options const& options,
+         MemoryBudget* budget,
+         ThreadStats& stats) {
+      bool reuse_pivots = (!posdef && factored_ && options.refactor);
+      if(reuse_pivots) save_pivots();
+      if(demoted_) {
+         sys_mem_.deallocate(lfac_);
+         lfac_ = nullptr;
+         demoted_ = false;
+      }
+      for(auto& node : nodes_) {
+         node.free_contrib();
+         node.set_budget(budget);
+      }
+      budget_ = budget;
+      pool_alloc_.set_budget(budget); // cached blocks are held over
+      factor_alloc_.reset();
+      factor(aval, scaling, child_contrib, options, stats, reuse_pivots);
+   }
+
+   void solve_fwd(int nrhs, double* x, int ldx) const {
+      if(demoted_) solve_fwd_inner<float>(nrhs, x, ldx);
+      else         solve_fwd_inner<T>(nrhs, x, ldx);
+   }
+
+   template <bool do_diag, bool do_bwd>
+   void solve_diag_bwd_inner(int nrhs, double* x, int ldx) const {
+      if(demoted_) solve_diag_bwd_inner<float, do_diag, do_bwd>(nrhs, x, ldx);
+      else         solve_diag_bwd_inner<T, do_diag, do_bwd>(nrhs, x, ldx);
+   }
+
+   void solve_diag(int nrhs, double* x, int ldx) const {
+      solve_diag_bwd_inner<true, false>(nrhs, x, ldx);
+   }
+
+   void solve_diag_bwd(int nrhs, double* x, int ldx) const {
+      solve_diag_bwd_inner<true, true>(nrhs, x, ldx);
+   }
+
+   void solve_bwd(int nrhs, double* x, int ldx) const {
+      solve_diag_bwd_inner<false, true>(nrhs, x, ldx);
+   }
+
+   /** Returns information on diagonal entries and/or pivot order.
+    * Note that piv_order is only set in indefinite case.
+    * One of piv_order or d may be null in indefinite case.
+    */
+   void enquire(int *piv_order, double* d) const {
+      if(demoted_) enquire_inner<float>(piv_order, d);
+      else         enquire_inner<T>(piv_order, d);
+   }
+
+   /** Allows user to alter D values, indef case only. */
+   void alter(double const* d) {
+      if(demoted_) alter_inner<float>(d);
+      else         alter_inner<T>(d);
+   }
+
+   void print() const {
+      if(demoted_) print_inner<float>();
+      else         print_inner<T>();
+   }
+
+   /** Return contribution block from subtree (if not a real root) */
+   void get_contrib(int& n, T const*& val, int& ldval, int const*& rlist,
+         int& ndelay, int const*& delay_perm, T const*& delay_val,
+         int& lddelay) const {
+      auto& root = *nodes_.back().first_child;
+      n = root.symb.nrow - root.symb.ncol;
+      val = root.contrib;
+      ldval = root.ldcontrib;
+      rlist = &root.symb.rlist[root.symb.ncol];
+      ndelay = root.ndelay_out;
+      delay_perm = (ndelay>0) ? &root.perm[root.nelim]
+                              : nullptr;
+      lddelay = align_lda<T>(root.symb.nrow + root.ndelay_in);
+      if(ndelay>0)
+         delay_val = (demoted_) ? delay_val_.data()
+                                : &root.lcol[root.nelim*(lddelay+1)];
+      else
+         delay_val = nullptr;
+   }
+
+   /** Frees root's contribution block */
+   void free_contrib() {
+      nodes_.back().first_child->free_contrib();
+   }
+
+   SymbolicSubtree const& get_symbolic_subtree() { return symb_; }
+
+private:
+   /** \brief Return start of node ni's factors, held in precision F.
+    *
+    *  F is float if the factors have been demoted (see demote_factors()),
+    *  and T otherwise. The leading dimension is align_lda<F>(nrow).
+    */
+   template <typename F>
+   F* get_lcol(int ni) const {
+      return (std::is_same<F,T>::value)
+         ? reinterpret_cast<F*>(nodes_[ni].lcol)
+         : reinterpret_cast<F*>(&lfac_[lfac_ptr_[ni]]);
+   }
+
+   /** \brief Implementation of solve_fwd() with factors held in precision F
+    *          (see get_lcol()). */
+   template <typename F>
+   void solve_fwd_inner(int nrhs, double* x, int ldx) const {
+      if(get_solve_num_threads() > 1) {
+         // Task-based parallel solve over assembly tree
+         if(omp_in_parallel()) {
+            solve_fwd_tasks<F>(nrhs, x, ldx);
+         } else {
+            #pragma omp parallel default(shared)
+            {
+               #pragma omp single
+               solve_fwd_tasks<F>(nrhs, x, ldx);
+            }
+         }
+         return;
+      }
+
+      /* Serial solve: process nodes in order */
+      size_t len = static_cast<size_t>(nrhs)*solve_maxfront_;
+      SolveWork work(*this, 1);
+      F* xlocal = work[0].template get_ptr<F>(len);
+      for(int ni=0; ni<symb_.nnodes_; ++ni)
+         solve_fwd_node<F, false>(ni, nrhs, x, ldx, xlocal);
+   }
+
+   /** \brief Implementation of solve_diag_bwd_inner() with factors held in
+    *          precision F (see get_lcol()). */
+   template <typename F, bool do_diag, bool do_bwd>
+   void solve_diag_bwd_inner(int nrhs, double* x, int ldx) const {
+      if(posdef && !do_bwd) return; // diagonal solve is a no-op for posdef
+
+      if(get_solve_num_threads() > 1) {
+         // Task-based parallel solve over assembly tree
+         if(omp_in_parallel()) {
+            solve_diag_bwd_tasks<F, do_diag, do_bwd>(nrhs, x, ldx);
+         } else {
+            #pragma omp parallel default(shared)
+            {
+               #pragma omp single
+               solve_diag_bwd_tasks<F, do_diag, do_bwd>(nrhs, x, ldx);
+            }
+         }
+         return;
+      }
+
+      /* Serial solve: process nodes in reverse order */
+      size_t len = static_cast<size_t>(nrhs)*solve_maxfront_;
+      SolveWork work(*this, 1);
+      F* xlocal = work[0].template get_ptr<F>(len);
+      for(int ni=symb_.nnodes_-1; ni>=0; --ni)
+         solve_diag_bwd_node<F, do_diag, do_bwd>(ni, nrhs, x, ldx, xlocal);
+   }
+
+   /** \brief Implementation of enquire() with factors held in precision F
+    *          (see get_lcol()). */
+   template <typename F>
+   void enquire_inner(int *piv_order, double* d) const {
+      if(posdef) {
+         for(int ni=0; ni<symb_.nnodes_; ++ni) {
+            int blkm = symb_[ni].nrow;
+            int nelim = symb_[ni].ncol;
+            int ldl = align_lda<F>(blkm);
+            F const* lcol = get_lcol<F>(ni);
+            for(int i=0; i<nelim; ++i)
+               *(d++) = lcol[i*(ldl+1)];
+         }
+      } else { /*indef*/
+         for(int ni=0, piv=0; ni<symb_.nnodes_; ++ni) {
+            int blkm = symb_[ni].nrow + nodes_[ni].ndelay_in;
+            int blkn = symb_[ni].ncol + nodes_[ni].ndelay_in;
+            int ldl = align_lda<F>(blkm);
+            int nelim = nodes_[ni].nelim;
+            F const* dptr = &get_lcol<F>(ni)[blkn*ldl];
+            for(int i=0; i<nelim; ) {
+               if(i+1==nelim || std::isfinite(dptr[2*i+2])) {
+                  /* 1x1 pivot */
+                  if(piv_order) {
+                     piv_order[nodes_[ni].perm[i]-1] = (piv++);
+                  }
+                  if(d) {
+                     *(d++) = dptr[2*i+0];
+                     *(d++) = 0.0;
+                  }
+                  i+=1;
+               } else {
+                  /* 2x2 pivot */
+                  if(piv_order) {
+                     piv_order[nodes_[ni].perm[i]-1] = -(piv++);
+                     piv_order[nodes_[ni].perm[i+1]-1] = -(piv++);
+                  }
+                  if(d) {
+                     *(d++) = dptr[2*i+0];
+                     *(d++) = dptr[2*i+1];
+                     *(d++) = dptr[2*i+3];
+                     *(d++) = 0.0;
+                  }
+                  i+=2;
+               }
+            }
+         }
+      }
+   }
+
+   /** \brief Implementation of alter() with factors held in precision F
+    *          (see get_lcol()). */
+   template <typename F>
+   void alter_inner(double const* d) {
+      for(int ni=0; ni<symb_.nnodes_; ++ni) {
+         int blkm = symb_[ni].nrow + nodes_[ni].ndelay_in;
+         int blkn = symb_[ni].ncol + nodes_[ni].ndelay_in;
+         int ldl = align_lda<F>(blkm);
+         int nelim = nodes_[ni].nelim;
+         F* dptr = &get_lcol<F>(ni)[blkn*ldl];
+         double dum;
+         for(int i=0; i<nelim; ) {
+            if(i+1==nelim || std::isfinite(dptr[2*i+2])) {
+               /* 1x1 pivot */
+               dptr[2*i+0] = *(d++);
+               dum = *(d++);
+               i+=1;
+            } else {
+               /* 2x2 pivot */
+               dptr[2*i+0] = *(d++);
+               dptr[2*i+1] = *(d++);
+               dptr[2*i+3] = *(d++);
+               dum = *(d++);
+               i+=2;
+            }
+         }
+      }
+   }
+
+   /** \brief Implementation of print() with factors held in precision F
+    *          (see get_lcol()). */
+   template <typename F>
+	void print_inner() const {
+		for(int node=0; node<symb_.nnodes_; node++) {
+			printf("== Node %d ==\n", node);
+			int m = symb_[node].nrow + nodes_[node].ndelay_in;
+			int n = symb_[node].ncol + nodes_[node].ndelay_in;
+         int ldl = align_lda<F>(m);
+         int nelim = nodes_[node].nelim;
+         F const* lcol = get_lcol<F>(node);
+			int const* rlist = &symb_[node].rlist[ symb_[node].ncol ];
+			for(int i=0; i<m; ++i) {
+				if(i<n) printf("%d%s:", nodes_[node].perm[i], (i<nelim)?"X":"D");
+				else    printf("%d:", rlist[i-n]);
+				for(int j=0; j<n; j++) printf(" %10.2e", lcol[j*ldl+i]);
+            F const* d = &lcol[n*ldl];
+				if(!posdef && i<nelim)
+               printf("  d: %10.2e %10.2e", d[2*i+0], d[2*i+1]);
+		      printf("\n");
+			}
+		}
+	}
+
+   /** \brief Reserve memory in the budget for a task about to be created.
+    *
+    *  If it does not fit, we wait for this subtree's tasks one at a time,
+    *  oldest first, as each may free its children's contribution blocks,
+    *  and retry after each. Once none are left we give the blocks cached by
+    *  our pool back to the system, as waiting does not free them, then wait
+    *  for tasks of any other subtrees sharing the budget. If no task is
+    *  running, the task goes ahead regardless so that the factorization
+    *  completes: this only happens if the budget is less than
+    *  factorization in this order requires, or if other subtrees' pools
+    *  hold it.
+    *
+    *  \param bytes Memory to reserve: the footprint in the pool of each
+    *         contribution block the task allocates.
+    *  \param created Dependence object of each task created so far, in
+    *         order of creation.
+    *  \param nwaited Number of entries of created already waited for.
+    */
+   void reserve_task(size_t bytes,
+         std::vector<NumericNode<T,PoolAllocator>*> const& created,
+         size_t& nwaited) {
+      if(!budget_) return;
+      bool released = false;
+      while(!budget_->try_reserve(bytes,
+               released && budget_->get_running()==0)) {
+         if(nwaited < created.size()) {
+            // An undeferred task waits for just the earlier tasks sharing its
+            // dependence, executing other tasks meanwhile (unlike taskyield)
+            auto* dep = created[nwaited++]; // for depend
+            #pragma omp task if(0) depend(inout: dep[0:1])
+            { (void) dep; }
+         } else if(!released) {
+            pool_alloc_.release_cached();
+            released = true;
+         } else {
+            #pragma omp taskyield
+         }
+      }
+   }
+
+   /** \brief Mark end of a task whose memory was reserved by
+    *         reserve_task(), counting it in nfinished. */
+   void finish_task(int& nfinished) {
+      if(budget_) budget_->finish();
+      #pragma omp atomic update
+      nfinished++;
+   }
+
+   /** \brief Perform factorization of all nodes, then set up for solves.
+    *  \param reuse_pivots If true, first try the pivot sequence recorded by
+    *         save_pivots() at each node.
+    *  Other arguments are as for the constructor.
+    */
+   void factor(
+         T const* aval,
+         T const* scaling,
+         void** child_contrib,
+         struct cpu_factor_options const& options,
+         ThreadStats& stats,
+         bool reuse_pivots) {
+      factored_ = false;
+      sys_mem_.reset_peak();
+
       /* Allocate workspaces */
       int num_threads = omp_get_num_threads();
       std::vector<ThreadStats> thread_stats(num_threads);
       std::vector<Workspace> work;
       work.reserve(num_threads);
       for(int i=0; i<num_threads; ++i)
-         work.emplace_back(PAGE_SIZE);
+         work.emplace_back(symb_.get_work_mem(posdef), &sys_mem_);
+      std::vector<Workspace> map_work; // grown to length n+1 on first use
+      map_work.reserve(num_threads);
+      for(int i=0; i<num_threads; ++i)
+         map_work.emplace_back(0);
 
       // initialise stats already so we can safely early-return in case of
       // failure if not compiled with OpenMP (instead of omp cancel)
       stats = ThreadStats();
+      stats.cpu_isa = get_simd_kernels<T>().arch;
+
+      // Nodes may take over an only child's contribution block in place
+      // (see assemble_pre()) unless the factorization cannot add to it:
+      // aggressive APP assumes it starts at zero, and a failed attempt to
+      // reuse previous pivots leaves it undefined. Nor do we under a memory
+      // limit, as the bottom of each chain allocates storage for the whole
+      // chain early and exceeds the peak predicted by analyse.
+      bool inplace = !reuse_pivots &&
+         (posdef || options.pivot_method != PivotMethod::app_aggressive) &&
+         !budget_;
 
       // Each node is depend(inout) on itself and depend(in) on its parent.
       // Whilst this isn't really what's happening it does ensure our
@@ -91,14 +483,32 @@ public:
       bool abort;
       #pragma omp atomic write
       abort = false; // Set to true to abort remaining tasks
+      int ntask = 0; // Number of tasks created...
+      int nfinished = 0; // ...and that ran to completion
+      // Tasks created, as dependence objects, for reserve_task() to wait on
+      std::vector<NumericNode<T,PoolAllocator>*> created;
+      size_t nwaited = 0;
+      if(budget_) created.reserve(symb_.small_leafs_.size() + symb_.nnodes_);
       #pragma omp taskgroup
       {
          /* Loop over small leaf subtrees */
          for(unsigned int si=0; si<symb_.small_leafs_.size(); ++si) {
-            auto* parent_lcol = &nodes_[symb_.small_leafs_[si].get_parent()];
+            auto const& leaf = symb_.small_leafs_[si];
+            size_t need = 0;
+            for(int ni=leaf.get_sa(); ni<=leaf.get_en(); ++ni) {
+               size_t bytes = PoolAllocator::footprint(
+                     nodes_[ni].get_contrib_size() / sizeof(T));
+               nodes_[ni].set_contrib_reserved(bytes);
+               need += bytes;
+            }
+            reserve_task(need, created, nwaited);
+            ++ntask;
+            auto* parent_lcol = &nodes_[leaf.get_parent()];
+            if(budget_) created.push_back(parent_lcol);
             #pragma omp task default(none) \
                firstprivate(si) \
-               shared(aval, abort, options, scaling, thread_stats, work) \
+               shared(aval, abort, nfinished, options, scaling, \
+                      thread_stats, work) \
                depend(in: parent_lcol[0:1])
             {
               bool my_abort;
@@ -151,17 +561,28 @@ public:
                   return;
 #endif /* _OPENMP */
                }
-            } } // task/abort
+              }
+              finish_task(nfinished);
+            } // task
          }
 
          /* Loop over singleton nodes in order */
          for(int ni=0; ni<symb_.nnodes_; ++ni) {
             if(symb_[ni].insmallleaf) continue; // already handled
+            // No new memory if contrib is planned to be built in place
+            size_t need = (inplace && symb_[ni].inplace_offset >= 0)
+               ? 0 : PoolAllocator::footprint(
+                     nodes_[ni].get_contrib_size(inplace) / sizeof(T));
+            nodes_[ni].set_contrib_reserved(need);
+            reserve_task(need, created, nwaited);
+            ++ntask;
             auto* this_lcol = &nodes_[ni]; // for depend
+            if(budget_) created.push_back(this_lcol);
             auto* parent_lcol = &nodes_[symb_[ni].parent]; // for depend
             #pragma omp task default(none) \
                firstprivate(ni) \
-               shared(aval, abort, child_contrib, options, scaling, \
+               shared(aval, abort, child_contrib, inplace, nfinished, \
+                      options, reuse_pivots, map_work, scaling, \
                       thread_stats, work) \
                depend(inout: this_lcol[0:1]) \
                depend(in: parent_lcol[0:1])
@@ -178,8 +599,9 @@ public:
                   int this_thread = omp_get_thread_num();
                   // Assembly of node (not of contribution block)
                   assemble_pre
-                     (posdef, symb_.n, symb_[ni], child_contrib, nodes_[ni],
-                      factor_alloc_, pool_alloc_, work, aval, scaling);
+                     (posdef, inplace, symb_.n, symb_[ni], child_contrib,
+                      nodes_[ni], factor_alloc_, map_work, work, aval,
+                      scaling);
                   // Update stats
                   int nrow = symb_[ni].nrow + nodes_[ni].ndelay_in;
                   thread_stats[this_thread].maxfront =
@@ -188,11 +610,23 @@ public:
                   thread_stats[this_thread].maxsupernode =
                      std::max(thread_stats[this_thread].maxsupernode, ncol);
                   
-                  // Factorization
-                  factor_node<posdef>
-                     (ni, symb_[ni], nodes_[ni], options,
-                      thread_stats[this_thread], work,
-                      pool_alloc_);
+                  // Factorization, trying previous pivots first if asked
+                  bool refactored = false;
+                  if(reuse_pivots && prev_nelim_[ni] > 0) {
+                     long pp = prev_perm_ptr_[ni];
+                     refactored = refactor_node_indef
+                        (symb_[ni], nodes_[ni], prev_perm_ptr_[ni+1]-pp,
+                         prev_nelim_[ni], &prev_perm_[pp], options,
+                         thread_stats[this_thread], work, pool_alloc_);
+                     if(!refactored)
+                        thread_stats[this_thread].not_refactored++;
+                  }
+                  if(!refactored)
+                     factor_node<posdef>
+                        (ni, symb_[ni], nodes_[ni], options,
+                         thread_stats[this_thread], work,
+                         pool_alloc_,
+                         (budget_) ? budget_->get_available() : SIZE_MAX);
                   if(thread_stats[this_thread].flag<Flag::SUCCESS) {
 #ifdef _OPENMP
                      #pragma omp atomic write
@@ -209,7 +643,7 @@ public:
                   my_abort = abort;
                   if (!my_abort)
                      assemble_post(symb_.n, symb_[ni], child_contrib,
-                           nodes_[ni], pool_alloc_, work);
+                           nodes_[ni], map_work, work);
                } catch (std::bad_alloc const&) {
                   thread_stats[omp_get_thread_num()].flag =
                      Flag::ERROR_ALLOCATION;
@@ -233,16 +667,29 @@ public:
                   return;
 #endif /* _OPENMP */
                }
-            } } // task/abort
+              }
+              finish_task(nfinished);
+            } // task
          }
       } // taskgroup
+      if(budget_) {
+         // Account for any tasks cancelled before they finished
+         budget_->finish(ntask - nfinished);
+         for(auto& node : nodes_)
+            node.cancel_contrib_reservation();
+      }
 
 
       // Reduce thread_stats (stats already initialised above)
       for(auto tstats : thread_stats)
          stats += tstats;
+      stats.num_huge_pages = sys_mem_.get_peak_huge_pages();
       if(stats.flag < 0) return;
 
+      // Set up index arrays and workspace so that solves need not allocate
+      setup_solve();
+      factored_ = true;
+
       // Count stats
       // FIXME: Do this as we go along...
       if(posdef) {
@@ -278,273 +725,475 @@ public:
             }
          }
       }
-   }
-   ~NumericSubtree() {
-      delete[] small_leafs_;
-   }
 
-   void solve_fwd(int nrhs, double* x, int ldx) const {
-      /* Allocate memory */
-      double* xlocal = new double[nrhs*symb_.n];
-      int* map_alloc = (!posdef) ? new int[symb_.n] : nullptr; // only indef
+      if(options.compress_factors) demote_factors();
+   }
 
-      /* Main loop */
+   /** \brief Convert the factors to single precision, and free the storage
+    *         they were computed in.
+    *
+    *  The factor memory held for the solves is halved, as is their memory
+    *  traffic, as they are then performed in single precision. Peak memory
+    *  is not: the single precision factors are allocated while the double
+    *  precision ones are still held. Full accuracy is recovered by
+    *  iterative refinement (see ssids_solve()). Permutations,
+    *  and any delayed columns of the root passed to the parent subtree, are
+    *  kept as they were. If the single precision factors cannot be
+    *  allocated, or an entry would overflow, the factors are left as they
+    *  are.
+    */
+   void demote_factors() {
+      /* Allocate single precision factors */
+      lfac_ptr_.resize(symb_.nnodes_+1);
+      lfac_ptr_[0] = 0;
       for(int ni=0; ni<symb_.nnodes_; ++ni) {
-         int m = symb_[ni].nrow;
-         int n = symb_[ni].ncol;
-         int nelim = (posdef) ? n
-                              : nodes_[ni].nelim;
-         int ndin = (posdef) ? 0
-                             : nodes_[ni].ndelay_in;
-         int ldl = align_lda<T>(m+ndin);
-
-         /* Build map (indef only) */
-         int const *map;
-         if(!posdef) {
-            // indef need to allow for permutation and/or delays
-            for(int i=0; i<n+ndin; ++i)
-               map_alloc[i] = nodes_[ni].perm[i];
-            for(int i=n; i<m; ++i)
-               map_alloc[i+ndin] = symb_[ni].rlist[i];
-            map = map_alloc;
-         } else {
-            // posdef there is no permutation
-            map = symb_[ni].rlist;
+         int ndin = (posdef) ? 0 : nodes_[ni].ndelay_in;
+         size_t ldl = align_lda<float>(symb_[ni].nrow + ndin);
+         int n = symb_[ni].ncol + ndin;
+         lfac_ptr_[ni+1] = lfac_ptr_[ni] + ((posdef) ? ldl*n : (ldl+2)*n);
+      }
+      try {
+         lfac_ = static_cast<float*>(
+               sys_mem_.allocate(lfac_ptr_[symb_.nnodes_]*sizeof(float), false));
+         lperm_.resize(solve_rows_.size());
+         auto const* root = nodes_.back().first_child;
+         if(root && root->ndelay_out > 0) {
+            size_t lddelay = align_lda<T>(root->symb.nrow + root->ndelay_in);
+            delay_val_.resize((root->ndelay_out-1)*lddelay +
+                  root->symb.nrow + root->ndelay_in - root->nelim);
          }
+      } catch(std::bad_alloc const&) {
+         sys_mem_.deallocate(lfac_);
+         lfac_ = nullptr;
+         return;
+      }
 
-         /* Gather into dense vector xlocal */
-         // FIXME: don't bother copying elements of x > m, just use beta=0
-         //        in dgemm call and then add as we scatter
-         for(int r=0; r<nrhs; ++r)
-         for(int i=0; i<m+ndin; ++i)
-            xlocal[r*symb_.n+i] = x[r*ldx + map[i]-1]; // Fortran indexed
-
-         /* Perform dense solve */
-         if(posdef) {
-            cholesky_solve_fwd(m, n, nodes_[ni].lcol, ldl, nrhs, xlocal, symb_.n);
-         } else { /* indef */
-            ldlt_app_solve_fwd(m+ndin, nelim, nodes_[ni].lcol, ldl, nrhs,
-                  xlocal, symb_.n);
+      /* Convert L (and D), allowing for the change in leading dimension */
+      float const flt_max = std::numeric_limits<float>::max();
+      bool overflow = false;
+      for(int ni=0; ni<symb_.nnodes_; ++ni) {
+         int ndin = (posdef) ? 0 : nodes_[ni].ndelay_in;
+         int m = symb_[ni].nrow + ndin;
+         int n = symb_[ni].ncol + ndin;
+         size_t ldl = align_lda<T>(m);
+         size_t ldf = align_lda<float>(m);
+         T const* src = nodes_[ni].lcol;
+         float* dest = &lfac_[lfac_ptr_[ni]];
+         for(int j=0; j<n; ++j)
+            for(int i=0; i<m; ++i) {
+               T v = src[j*ldl+i];
+               overflow |= (std::fabs(v) > flt_max && std::isfinite(v));
+               dest[j*ldf+i] = v;
+            }
+         if(!posdef) {
+            // NB: D marks 2x2 pivots with infinity, which is preserved
+            for(int i=0; i<2*n; ++i) {
+               T v = src[n*ldl+i];
+               overflow |= (std::fabs(v) > flt_max && std::isfinite(v));
+               dest[n*ldf+i] = v;
+            }
          }
+      }
+      if(overflow) {
+         sys_mem_.deallocate(lfac_);
+         lfac_ = nullptr;
+         delay_val_.clear();
+         return;
+      }
 
-         /* Scatter result */
-         for(int r=0; r<nrhs; ++r)
-         for(int i=0; i<m+ndin; ++i)
-            x[r*ldx + map[i]-1] = xlocal[r*symb_.n+i];
+      /* Keep what outlives the double precision storage */
+      auto* root = nodes_.back().first_child;
+      if(!delay_val_.empty()) {
+         size_t lddelay = align_lda<T>(root->symb.nrow + root->ndelay_in);
+         T const* src = &root->lcol[root->nelim*(lddelay+1)];
+         std::copy(src, src+delay_val_.size(), delay_val_.begin());
+      }
+      for(int ni=0; ni<symb_.nnodes_; ++ni) {
+         int n = symb_[ni].ncol + nodes_[ni].ndelay_in;
+         int* perm = &lperm_[solve_rows_ptr_[ni]];
+         if(nodes_[ni].perm) std::copy(nodes_[ni].perm, nodes_[ni].perm+n, perm);
+         nodes_[ni].perm = perm;
+         nodes_[ni].lcol = nullptr;
       }
+      factor_alloc_.release();
+      demoted_ = true;
+   }
 
-      /* Cleanup memory */
-      if(!posdef) delete[] map_alloc; // only used in indef case
-      delete[] xlocal;
+   /** \brief Record the pivot sequence of the current factors for use by
+    *         refactor().
+    *
+    *  For each node not in a small leaf subtree, the fully summed variables
+    *  are stored in pivot order (eliminated variables first) with both
+    *  variables of a 2x2 pivot negated, as in enquire().
+    */
+   void save_pivots() {
+      if(demoted_) save_pivots_inner<float>();
+      else         save_pivots_inner<T>();
    }
 
-   template <bool do_diag, bool do_bwd>
-   void solve_diag_bwd_inner(int nrhs, double* x, int ldx) const {
-      if(posdef && !do_bwd) return; // diagonal solve is a no-op for posdef
+   /** \brief Implementation of save_pivots() with factors held in precision
+    *          F (see get_lcol()). */
+   template <typename F>
+   void save_pivots_inner() {
+      prev_nelim_.assign(symb_.nnodes_, 0);
+      prev_perm_ptr_.assign(symb_.nnodes_+1, 0);
+      for(int ni=0; ni<symb_.nnodes_; ++ni) {
+         int n = (symb_[ni].insmallleaf) ? 0
+                                         : symb_[ni].ncol + nodes_[ni].ndelay_in;
+         prev_perm_ptr_[ni+1] = prev_perm_ptr_[ni] + n;
+      }
+      prev_perm_.resize(prev_perm_ptr_[symb_.nnodes_]);
+      for(int ni=0; ni<symb_.nnodes_; ++ni) {
+         if(symb_[ni].insmallleaf) continue;
+         int m = symb_[ni].nrow + nodes_[ni].ndelay_in;
+         int n = symb_[ni].ncol + nodes_[ni].ndelay_in;
+         int nelim = nodes_[ni].nelim;
+         F const* d = &get_lcol<F>(ni)[n*align_lda<F>(m)];
+         int* perm = &prev_perm_[prev_perm_ptr_[ni]];
+         for(int i=0; i<n; ++i)
+            perm[i] = nodes_[ni].perm[i];
+         for(int i=0; i<nelim; ) {
+            if(i+1==nelim || std::isfinite(d[2*i+2])) {
+               i+=1;
+            } else {
+               perm[i] = -perm[i];
+               perm[i+1] = -perm[i+1];
+               i+=2;
+            }
+         }
+         prev_nelim_[ni] = nelim;
+      }
+   }
 
-      /* Allocate memory - map only needed for indef bwd/diag_bwd solve */
-      double* xlocal = new double[nrhs*symb_.n];
-      int* map_alloc = (!posdef && do_bwd) ? new int[symb_.n]
-                                           : nullptr;
+   /** \brief Return number of threads available to the solve phase.
+    *
+    * If we are already inside a parallel region (e.g. one subtree of many)
+    * we spawn tasks into the current team, otherwise we may create our own.
+    */
+   static int get_solve_num_threads() {
+      return (omp_in_parallel()) ? omp_get_num_threads()
+                                 : omp_get_max_threads();
+   }
 
-      /* Perform solve */
-      for(int ni=symb_.nnodes_-1; ni>=0; --ni) {
+   /** \brief Set up index arrays and persistent workspace for solve.
+    *
+    * Called once factorization is complete. Row i of node ni's factors
+    * (allowing for delays and permutation) corresponds to the (C-indexed)
+    * variable solve_rows_[solve_rows_ptr_[ni]+i], so the solves need not
+    * rebuild this from perm and rlist each time. Workspace is sized for a
+    * single right-hand side, so that repeated solves with the same (or
+    * smaller) nrhs perform no heap allocation.
+    */
+   void setup_solve() {
+      /* Build index arrays */
+      solve_maxfront_ = 1;
+      solve_rows_ptr_.resize(symb_.nnodes_+1);
+      solve_rows_ptr_[0] = 0;
+      for(int ni=0; ni<symb_.nnodes_; ++ni) {
+         int ndin = (posdef) ? 0 : nodes_[ni].ndelay_in;
+         int blkm = symb_[ni].nrow + ndin;
+         solve_maxfront_ = std::max(solve_maxfront_, blkm);
+         solve_rows_ptr_[ni+1] = solve_rows_ptr_[ni] + blkm;
+      }
+      solve_rows_.resize(solve_rows_ptr_[symb_.nnodes_]);
+      for(int ni=0; ni<symb_.nnodes_; ++ni) {
+         int* rows = &solve_rows_[solve_rows_ptr_[ni]];
          int m = symb_[ni].nrow;
-         int n = symb_[ni].ncol;
-         int nelim = (posdef) ? n
-                              : nodes_[ni].nelim;
-         int ndin = (posdef) ? 0
-                             : nodes_[ni].ndelay_in;
-
-         /* Build map (indef only) */
-         int const *map;
-         if(!posdef) {
-            // indef need to allow for permutation and/or delays
-            if(do_bwd) {
-               for(int i=0; i<n+ndin; ++i)
-                  map_alloc[i] = nodes_[ni].perm[i];
-               for(int i=n; i<m; ++i)
-                  map_alloc[i+ndin] = symb_[ni].rlist[i];
-               map = map_alloc;
-            } else { // if only doing diagonal, only need first nelim<=n+ndin
-               map = nodes_[ni].perm;
-            }
-         } else {
+         if(posdef) {
             // posdef there is no permutation
-            map = symb_[ni].rlist;
+            for(int i=0; i<m; ++i)
+               rows[i] = symb_[ni].rlist[i] - 1; // rlist is Fortran indexed
+         } else {
+            // indef need to allow for permutation and/or delays
+            int n = symb_[ni].ncol;
+            int ndin = nodes_[ni].ndelay_in;
+            for(int i=0; i<n+ndin; ++i)
+               rows[i] = nodes_[ni].perm[i] - 1; // perm is Fortran indexed
+            for(int i=n; i<m; ++i)
+               rows[i+ndin] = symb_[ni].rlist[i] - 1;
          }
+      }
 
-         /* Gather into dense vector xlocal */
-         int blkm = (do_bwd) ? m+ndin
-                             : nelim;
-         int ldl = align_lda<T>(m+ndin);
-         for(int r=0; r<nrhs; ++r)
-         for(int i=0; i<blkm; ++i)
-            xlocal[r*symb_.n+i] = x[r*ldx + map[i]-1];
+      /* Allocate per-thread workspace */
+      solve_work_.reserve(omp_get_max_threads());
+      while(solve_work_.size() < static_cast<size_t>(omp_get_max_threads()))
+         solve_work_.emplace_back(solve_maxfront_*sizeof(double));
+   }
 
-         /* Perform dense solve */
-         if(posdef) {
-            cholesky_solve_bwd(m, n, nodes_[ni].lcol, ldl, nrhs, xlocal, symb_.n);
-         } else {
-            if(do_diag) ldlt_app_solve_diag(
-                  nelim, &nodes_[ni].lcol[(n+ndin)*ldl], nrhs, xlocal, symb_.n
-                  );
-            if(do_bwd) ldlt_app_solve_bwd(
-                  m+ndin, nelim, nodes_[ni].lcol, ldl, nrhs, xlocal, symb_.n
-                  );
+   /** \brief Per-thread workspace for the duration of a single solve.
+    *
+    * The workspace kept between calls (solve_work_) is used, so that
+    * repeated solves need not allocate, unless a concurrent solve with this
+    * subtree holds it. Workspace is then allocated for this solve alone, so
+    * that concurrent solves remain safe.
+    */
+   class SolveWork {
+   public:
+      SolveWork(NumericSubtree const& subtree, int num_threads)
+      : subtree_(subtree),
+        owner_(!subtree.solve_work_busy_.test_and_set(std::memory_order_acquire))
+      {
+         auto& work = (owner_) ? subtree.solve_work_ : local_;
+         try {
+            while(work.size() < static_cast<size_t>(num_threads))
+               work.emplace_back(subtree.solve_maxfront_*sizeof(double));
+         } catch(...) {
+            if(owner_) subtree.solve_work_busy_.clear(std::memory_order_release);
+            throw;
          }
+      }
+      SolveWork(SolveWork const&) =delete;
+      SolveWork& operator=(SolveWork const&) =delete;
+      ~SolveWork() {
+         if(owner_) subtree_.solve_work_busy_.clear(std::memory_order_release);
+      }
+      /** \brief Return workspace of thread i. */
+      Workspace& operator[](int i) {
+         return (owner_) ? subtree_.solve_work_[i] : local_[i];
+      }
+   private:
+      NumericSubtree const& subtree_;
+      bool const owner_; ///< True if we hold subtree_.solve_work_
+      std::vector<Workspace> local_; ///< Used if owner_ is false
+   };
 
-         /* Scatter result (only first nelim entries have changed) */
-         for(int r=0; r<nrhs; ++r)
+   /** \brief Perform forward solve with a single node.
+    *
+    * Only the eliminated variables need be gathered: the update to the
+    * remaining rows is formed with beta=0 and added to x as we scatter.
+    *
+    * \tparam F precision in which factors are held (see get_lcol()). The
+    *         dense solve is performed in this precision.
+    * \tparam concurrent If true, other nodes may be updating the same rows
+    *         at the same time, so the update is added atomically.
+    * \param xlocal Workspace of size at least nrhs*(nrow+ndelay_in).
+    */
+   template <typename F, bool concurrent>
+   void solve_fwd_node(int ni, int nrhs, double* x, int ldx, F* xlocal)
+   const {
+      int m = symb_[ni].nrow;
+      int n = symb_[ni].ncol;
+      int nelim = (posdef) ? n
+                           : nodes_[ni].nelim;
+      int ndin = (posdef) ? 0
+                          : nodes_[ni].ndelay_in;
+      int ldl = align_lda<F>(m+ndin);
+      int blkm = m+ndin;
+      int const* rows = &solve_rows_[solve_rows_ptr_[ni]];
+      F const* lcol = get_lcol<F>(ni);
+
+      /* Gather eliminated variables, zero the remainder */
+      for(int r=0; r<nrhs; ++r) {
+         double const* xr = &x[r*static_cast<long>(ldx)];
+         F* xlr = &xlocal[r*blkm];
          for(int i=0; i<nelim; ++i)
-            x[r*ldx + map[i]-1] = xlocal[r*symb_.n+i];
+            xlr[i] = xr[rows[i]];
+         for(int i=nelim; i<blkm; ++i)
+            xlr[i] = 0.0;
       }
 
-      /* Cleanup memory */
-      if(!posdef && do_bwd) delete[] map_alloc; // only used in indef case
-      delete[] xlocal;
-   }
+      /* Perform dense solve */
+      if(posdef) {
+         cholesky_solve_fwd(m, n, lcol, ldl, nrhs, xlocal, blkm);
+      } else { /* indef */
+         ldlt_app_solve_fwd(blkm, nelim, lcol, ldl, nrhs, xlocal, blkm);
+      }
 
-   void solve_diag(int nrhs, double* x, int ldx) const {
-      solve_diag_bwd_inner<true, false>(nrhs, x, ldx);
+      /* Scatter result: overwrite eliminated variables, add the rest */
+      for(int r=0; r<nrhs; ++r) {
+         double* xr = &x[r*static_cast<long>(ldx)];
+         F const* xlr = &xlocal[r*blkm];
+         for(int i=0; i<nelim; ++i)
+            xr[rows[i]] = xlr[i];
+         if(concurrent) {
+            for(int i=nelim; i<blkm; ++i) {
+               #pragma omp atomic
+               xr[rows[i]] += xlr[i];
+            }
+         } else {
+            for(int i=nelim; i<blkm; ++i)
+               xr[rows[i]] += xlr[i];
+         }
+      }
    }
 
-   void solve_diag_bwd(int nrhs, double* x, int ldx) const {
-      solve_diag_bwd_inner<true, true>(nrhs, x, ldx);
-   }
+   /** \brief Perform diagonal and/or backward solve with a single node.
+    *
+    * Only the node's eliminated variables are written, and all other rows
+    * belong to ancestors that have already been solved, so no
+    * synchronization is required in a task-parallel solve. The diagonal
+    * solve only needs the eliminated variables to be gathered.
+    *
+    * \tparam F precision in which factors are held (see get_lcol()). The
+    *         dense solve is performed in this precision.
+    * \param xlocal Workspace of size at least nrhs*(nrow+ndelay_in).
+    */
+   template <typename F, bool do_diag, bool do_bwd>
+   void solve_diag_bwd_node(int ni, int nrhs, double* x, int ldx,
+         F* xlocal) const {
+      int m = symb_[ni].nrow;
+      int n = symb_[ni].ncol;
+      int nelim = (posdef) ? n
+                           : nodes_[ni].nelim;
+      int ndin = (posdef) ? 0
+                          : nodes_[ni].ndelay_in;
+      int ldl = align_lda<F>(m+ndin);
+      int blkm = (do_bwd) ? m+ndin
+                          : nelim;
+      int const* rows = &solve_rows_[solve_rows_ptr_[ni]];
+      F const* lcol = get_lcol<F>(ni);
 
-   void solve_bwd(int nrhs, double* x, int ldx) const {
-      solve_diag_bwd_inner<false, true>(nrhs, x, ldx);
+      /* Gather */
+      for(int r=0; r<nrhs; ++r) {
+         double const* xr = &x[r*static_cast<long>(ldx)];
+         F* xlr = &xlocal[r*blkm];
+         for(int i=0; i<blkm; ++i)
+            xlr[i] = xr[rows[i]];
+      }
+
+      /* Perform dense solve */
+      if(posdef) {
+         cholesky_solve_bwd(m, n, lcol, ldl, nrhs, xlocal, blkm);
+      } else {
+         if(do_diag) ldlt_app_solve_diag(
+               nelim, &lcol[(n+ndin)*ldl], nrhs, xlocal, blkm
+               );
+         if(do_bwd) ldlt_app_solve_bwd(
+               m+ndin, nelim, lcol, ldl, nrhs, xlocal, blkm
+               );
+      }
+
+      /* Scatter result (only first nelim entries have changed) */
+      for(int r=0; r<nrhs; ++r) {
+         double* xr = &x[r*static_cast<long>(ldx)];
+         F const* xlr = &xlocal[r*blkm];
+         for(int i=0; i<nelim; ++i)
+            xr[rows[i]] = xlr[i];
+      }
    }
 
-   /** Returns information on diagonal entries and/or pivot order.
-    * Note that piv_order is only set in indefinite case.
-    * One of piv_order or d may be null in indefinite case.
+   /** \brief Task-parallel forward solve.
+    *
+    * Follows the same tree dependencies as the factorization: each node
+    * cannot start until all its children are done. Small leaf subtrees are
+    * treated as a single task. Must be called from within a parallel region.
+    * Factors are held in precision F (see get_lcol()).
     */
-   void enquire(int *piv_order, double* d) const {
-      if(posdef) {
-         for(int ni=0; ni<symb_.nnodes_; ++ni) {
-            int blkm = symb_[ni].nrow;
-            int nelim = symb_[ni].ncol;
-            int ldl = align_lda<T>(blkm);
-            for(int i=0; i<nelim; ++i)
-               *(d++) = nodes_[ni].lcol[i*(ldl+1)];
-         }
-      } else { /*indef*/
-         for(int ni=0, piv=0; ni<symb_.nnodes_; ++ni) {
-            int blkm = symb_[ni].nrow + nodes_[ni].ndelay_in;
-            int blkn = symb_[ni].ncol + nodes_[ni].ndelay_in;
-            int ldl = align_lda<T>(blkm);
-            int nelim = nodes_[ni].nelim;
-            double const* dptr = &nodes_[ni].lcol[blkn*ldl];
-            for(int i=0; i<nelim; ) {
-               if(i+1==nelim || std::isfinite(dptr[2*i+2])) {
-                  /* 1x1 pivot */
-                  if(piv_order) {
-                     piv_order[nodes_[ni].perm[i]-1] = (piv++);
-                  }
-                  if(d) {
-                     *(d++) = dptr[2*i+0];
-                     *(d++) = 0.0;
-                  }
-                  i+=1;
-               } else {
-                  /* 2x2 pivot */
-                  if(piv_order) {
-                     piv_order[nodes_[ni].perm[i]-1] = -(piv++);
-                     piv_order[nodes_[ni].perm[i+1]-1] = -(piv++);
-                  }
-                  if(d) {
-                     *(d++) = dptr[2*i+0];
-                     *(d++) = dptr[2*i+1];
-                     *(d++) = dptr[2*i+3];
-                     *(d++) = 0.0;
-                  }
-                  i+=2;
-               }
+   template <typename F>
+   void solve_fwd_tasks(int nrhs, double* x, int ldx) const {
+      /* Per-thread gather/scatter buffers */
+      size_t len = static_cast<size_t>(nrhs)*solve_maxfront_;
+      SolveWork work(*this, omp_get_num_threads());
+
+      #pragma omp taskgroup
+      {
+         /* Loop over small leaf subtrees */
+         for(unsigned int si=0; si<symb_.small_leafs_.size(); ++si) {
+            auto const& leaf = symb_.small_leafs_[si];
+            auto* parent_node = &nodes_[leaf.get_parent()]; // for depend
+            #pragma omp task default(shared) \
+               firstprivate(si) \
+               depend(in: parent_node[0:1])
+            {
+               auto const& leaf = symb_.small_leafs_[si];
+               F* xlocal =
+                  work[omp_get_thread_num()].template get_ptr<F>(len);
+               for(int ni=leaf.get_sa(); ni<=leaf.get_en(); ++ni)
+                  solve_fwd_node<F, true>(ni, nrhs, x, ldx, xlocal);
             }
          }
-      }
-   }
 
-   /** Allows user to alter D values, indef case only. */
-   void alter(double const* d) {
-      for(int ni=0; ni<symb_.nnodes_; ++ni) {
-         int blkm = symb_[ni].nrow + nodes_[ni].ndelay_in;
-         int blkn = symb_[ni].ncol + nodes_[ni].ndelay_in;
-         int ldl = align_lda<T>(blkm);
-         int nelim = nodes_[ni].nelim;
-         double* dptr = &nodes_[ni].lcol[blkn*ldl];
-         double dum;
-         for(int i=0; i<nelim; ) {
-            if(i+1==nelim || std::isfinite(dptr[2*i+2])) {
-               /* 1x1 pivot */
-               dptr[2*i+0] = *(d++);
-               dum = *(d++);
-               i+=1;
-            } else {
-               /* 2x2 pivot */
-               dptr[2*i+0] = *(d++);
-               dptr[2*i+1] = *(d++);
-               dptr[2*i+3] = *(d++);
-               dum = *(d++);
-               i+=2;
+         /* Loop over singleton nodes in order */
+         for(int ni=0; ni<symb_.nnodes_; ++ni) {
+            if(symb_[ni].insmallleaf) continue; // already handled
+            auto* this_node = &nodes_[ni]; // for depend
+            auto* parent_node = &nodes_[symb_[ni].parent]; // for depend
+            #pragma omp task default(shared) \
+               firstprivate(ni) \
+               depend(inout: this_node[0:1]) \
+               depend(in: parent_node[0:1])
+            {
+               F* xlocal =
+                  work[omp_get_thread_num()].template get_ptr<F>(len);
+               solve_fwd_node<F, true>(ni, nrhs, x, ldx, xlocal);
             }
          }
-      }
+      } // taskgroup
    }
 
-	void print() const {
-		for(int node=0; node<symb_.nnodes_; node++) {
-			printf("== Node %d ==\n", node);
-			int m = symb_[node].nrow + nodes_[node].ndelay_in;
-			int n = symb_[node].ncol + nodes_[node].ndelay_in;
-         int ldl = align_lda<T>(m);
-         int nelim = nodes_[node].nelim;
-			int const* rlist = &symb_[node].rlist[ symb_[node].ncol ];
-			for(int i=0; i<m; ++i) {
-				if(i<n) printf("%d%s:", nodes_[node].perm[i], (i<nelim)?"X":"D");
-				else    printf("%d:", rlist[i-n]);
-				for(int j=0; j<n; j++) printf(" %10.2e", nodes_[node].lcol[j*ldl+i]);
-            T const* d = &nodes_[node].lcol[n*ldl];
-				if(!posdef && i<nelim)
-               printf("  d: %10.2e %10.2e", d[2*i+0], d[2*i+1]);
-		      printf("\n");
-			}
-		}
-	}
+   /** \brief Task-parallel diagonal and/or backward solve.
+    *
+    * Dependencies are the reverse of solve_fwd_tasks(): each node cannot
+    * start until its parent is done. Must be called from within a parallel
+    * region. Factors are held in precision F (see get_lcol()).
+    */
+   template <typename F, bool do_diag, bool do_bwd>
+   void solve_diag_bwd_tasks(int nrhs, double* x, int ldx) const {
+      /* Per-thread gather/scatter buffers */
+      size_t len = static_cast<size_t>(nrhs)*solve_maxfront_;
+      SolveWork work(*this, omp_get_num_threads());
 
-   /** Return contribution block from subtree (if not a real root) */
-   void get_contrib(int& n, T const*& val, int& ldval, int const*& rlist,
-         int& ndelay, int const*& delay_perm, T const*& delay_val,
-         int& lddelay) const {
-      auto& root = *nodes_.back().first_child;
-      n = root.symb.nrow - root.symb.ncol;
-      val = root.contrib;
-      ldval = n;
-      rlist = &root.symb.rlist[root.symb.ncol];
-      ndelay = root.ndelay_out;
-      delay_perm = (ndelay>0) ? &root.perm[root.nelim]
-                              : nullptr;
-      lddelay = align_lda<T>(root.symb.nrow + root.ndelay_in);
-      delay_val = (ndelay>0) ? &root.lcol[root.nelim*(lddelay+1)] 
-                             : nullptr;
-   }
+      #pragma omp taskgroup
+      {
+         /* Loop over singleton nodes in reverse order */
+         for(int ni=symb_.nnodes_-1; ni>=0; --ni) {
+            if(symb_[ni].insmallleaf) continue; // handled below
+            auto* this_node = &nodes_[ni]; // for depend
+            auto* parent_node = &nodes_[symb_[ni].parent]; // for depend
+            #pragma omp task default(shared) \
+               firstprivate(ni) \
+               depend(inout: this_node[0:1]) \
+               depend(in: parent_node[0:1])
+            {
+               F* xlocal =
+                  work[omp_get_thread_num()].template get_ptr<F>(len);
+               solve_diag_bwd_node<F, do_diag, do_bwd>(ni, nrhs, x, ldx,
+                     xlocal);
+            }
+         }
 
-   /** Frees root's contribution block */
-   void free_contrib() {
-      nodes_.back().first_child->free_contrib();
+         /* Loop over small leaf subtrees (parents are all singletons) */
+         for(unsigned int si=0; si<symb_.small_leafs_.size(); ++si) {
+            auto const& leaf = symb_.small_leafs_[si];
+            auto* parent_node = &nodes_[leaf.get_parent()]; // for depend
+            #pragma omp task default(shared) \
+               firstprivate(si) \
+               depend(in: parent_node[0:1])
+            {
+               auto const& leaf = symb_.small_leafs_[si];
+               F* xlocal =
+                  work[omp_get_thread_num()].template get_ptr<F>(len);
+               for(int ni=leaf.get_en(); ni>=leaf.get_sa(); --ni)
+                  solve_diag_bwd_node<F, do_diag, do_bwd>(ni, nrhs, x, ldx,
+                        xlocal);
+            }
+         }
+      } // taskgroup
    }
 
-   SymbolicSubtree const& get_symbolic_subtree() { return symb_; }
-
-private:
    SymbolicSubtree const& symb_;
+   MemoryBudget* budget_; ///< Limit on pool memory (null if none)
+   SystemMemory sys_mem_; ///< Source of factor, pool and workspace memory
    FactorAllocator factor_alloc_;
    PoolAllocator pool_alloc_;
    std::vector<NumericNode<T,PoolAllocator>> nodes_;
    SLNS *small_leafs_; // Apparently emplace_back isn't threadsafe, so
       // std::vector is out. So we use placement new instead.
+   int solve_maxfront_; ///< Max rows in any node's factors (incl. delays)
+   mutable std::vector<Workspace> solve_work_; ///< Per-thread solve workspace
+   mutable std::atomic_flag solve_work_busy_ = ATOMIC_FLAG_INIT; ///< Set
+      ///< while a solve holds solve_work_ (see SolveWork)
+   std::vector<long> solve_rows_ptr_; ///< Node ni's rows in solve_rows_
+   std::vector<int> solve_rows_; ///< Variable for each row of each node
+   bool factored_ = false; ///< True if factors are complete and valid
+   std::vector<int> prev_nelim_; ///< Eliminations at node in save_pivots()
+   std::vector<long> prev_perm_ptr_; ///< Node ni's pivots in prev_perm_
+   std::vector<int> prev_perm_; ///< Pivot sequence saved by save_pivots()
+   bool demoted_ = false; ///< True if factors held in lfac_ (single precision)
+   float* lfac_ = nullptr; ///< Factors after demote_factors()
+   std::vector<size_t> lfac_ptr_; ///< Node ni's factors start at lfac_ptr_[ni]
+   std::vector<int> lperm_; ///< Node permutations after demote_factors()
+   std::vector<T> delay_val_; ///< Root's delays after demote_factors()
 };
 
 }}} /* end of namespace spral::ssids::cpu */
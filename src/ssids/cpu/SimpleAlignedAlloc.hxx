@@ -7,6 +7,7 @@
 
 #include <memory>
 
+#include "config.h" // for HAVE_AVX*_KERNELS
 #include "omp.hxx"
 
 namespace spral { namespace ssids { namespace cpu {
@@ -18,9 +19,9 @@ namespace spral { namespace ssids { namespace cpu {
  */
 template <typename T>
 class SimpleAlignedAllocator {
-#if defined(__AVX512F__)
+#if defined(__AVX512F__) || defined(HAVE_AVX512_KERNELS)
   int const align = 64;
-#elif defined(__AVX__)
+#elif defined(__AVX__) || defined(HAVE_AVX2_KERNELS)
   int const align = 32;
 #else
   int const align = 16;
@@ -122,7 +122,7 @@ void assemble(
 
    /* Get space for contribution block + zero it */
    int64_t contrib_dimn = snode.nrow - snode.ncol;
-   node->contrib = (contrib_dimn > 0) ? PATraits::allocate(pool_alloc, contrib_dimn*contrib_dimn) : nullptr;
+   node->alloc_contrib();
    if(node->contrib)
       memset(node->contrib, 0, contrib_dimn*contrib_dimn*sizeof(T));
 
@@ -136,8 +136,9 @@ void assemble(
       /* Build lookup vector, allowing for insertion of delayed vars */
       /* Note that while rlist[] is 1-indexed this is fine so long as lookup
        * is also 1-indexed (which it is as it is another node's rlist[] */
-      for(int i=0; i<snode.nrow; i++)
-         map[ snode.rlist[i] ] = i;
+      if(needs_map(snode, *node))
+         for(int i=0; i<snode.nrow; i++)
+            map[ snode.rlist[i] ] = i;
       /* Loop over children adding contributions */
       for(auto* child=node->first_child; child!=NULL; child=child->next_child) {
          SymbolicNode const& csnode = child->symb;
@@ -145,14 +146,14 @@ void assemble(
          if(child->contrib) {
             int cm = csnode.nrow - csnode.ncol;
             for(int i=0; i<cm; i++) {
-               int c = map[ csnode.rlist[csnode.ncol+i] ];
+               int c = child_row_pos(csnode, csnode.ncol+i, snode, 0, map);
                T *src = &child->contrib[i*cm];
                if(c < snode.ncol) {
                   // Contribution added to lcol
                   int ldd = align_lda<double>(nrow);
                   T *dest = &node->lcol[c*ldd];
                   for(int j=i; j<cm; j++) {
-                     int r = map[ csnode.rlist[csnode.ncol+j] ];
+                     int r = child_row_pos(csnode, csnode.ncol+j, snode, 0, map);
                      dest[r] += src[j];
                   }
                } else {
@@ -161,7 +162,8 @@ void assemble(
                   int ldd = snode.nrow - snode.ncol;
                   T *dest = &node->contrib[(c-ncol)*ldd];
                   for(int j=i; j<cm; j++) {
-                     int r = map[ csnode.rlist[csnode.ncol+j] ] - ncol;
+                     int r = child_row_pos(csnode, csnode.ncol+j, snode, 0, map)
+                        - ncol;
                      dest[r] += src[j];
                   }
                }
@@ -249,8 +251,7 @@ private:
       memset(node.lcol, 0, len*sizeof(T));
 
       /* Get space for contribution block + (explicitly do not zero it!) */
-      int64_t contrib_dimn = snode.nrow - snode.ncol;
-      node.contrib = (contrib_dimn > 0) ? PATraits::allocate(pool_alloc, contrib_dimn*contrib_dimn) : nullptr;
+      node.alloc_contrib();
 
       /* Alloc + set perm for expected eliminations at this node (delays are set
        * when they are imported from children) */
@@ -290,10 +291,12 @@ private:
          /* Build lookup vector, allowing for insertion of delayed vars */
          /* Note that while rlist[] is 1-indexed this is fine so long as lookup
           * is also 1-indexed (which it is as it is another node's rlist[] */
-         for(int i=0; i<snode.ncol; i++)
-            map[ snode.rlist[i] ] = i;
-         for(int i=snode.ncol; i<snode.nrow; i++)
-            map[ snode.rlist[i] ] = i + node.ndelay_in;
+         if(needs_map(snode, node)) {
+            for(int i=0; i<snode.ncol; i++)
+               map[ snode.rlist[i] ] = i;
+            for(int i=snode.ncol; i<snode.nrow; i++)
+               map[ snode.rlist[i] ] = i + node.ndelay_in;
+         }
          /* Loop over children adding contributions */
          int delay_col = snode.ncol;
          for(auto* child=node.first_child; child!=NULL; child=child->next_child) {
@@ -313,7 +316,7 @@ private:
                dest = node.lcol;
                src = &child->lcol[child->nelim*lds + child->ndelay_in +i*lds];
                for(int j=csnode.ncol; j<csnode.nrow; j++) {
-                  int r = map[ csnode.rlist[j] ];
+                  int r = child_row_pos(csnode, j, snode, node.ndelay_in, map);
                   if(r < ncol) dest[r*ldl+delay_col] = src[j];
                   else         dest[delay_col*ldl+r] = src[j];
                }
@@ -324,7 +327,8 @@ private:
             if(child->contrib) {
                int cm = csnode.nrow - csnode.ncol;
                for(int i=0; i<cm; i++) {
-                  int c = map[ csnode.rlist[csnode.ncol+i] ];
+                  int c = child_row_pos(csnode, csnode.ncol+i, snode,
+                        node.ndelay_in, map);
                   T *src = &child->contrib[i*cm];
                   // NB: we handle contribution to contrib in assemble_post()
                   if(c < snode.ncol) {
@@ -332,7 +336,8 @@ private:
                      int ldd = align_lda<T>(nrow);
                      T *dest = &node.lcol[c*ldd];
                      for(int j=i; j<cm; j++) {
-                        int r = map[ csnode.rlist[csnode.ncol+j] ];
+                        int r = child_row_pos(csnode, csnode.ncol+j, snode,
+                              node.ndelay_in, map);
                         dest[r] += src[j];
                      }
                   }
@@ -372,7 +377,7 @@ private:
          int nelim = node->nelim;
          int ldld = align_lda<T>(m-n);
          T *ld = work.get_ptr<T>(nelim*ldld);
-         calcLD<OP_N>(m-n, nelim, &lcol[n], ldl, d, ld, ldld);
+         get_simd_kernels<T>().calcLD_N(m-n, nelim, &lcol[n], ldl, d, ld, ldld);
          host_gemm<T>(OP_N, OP_T, m-n, m-n, nelim,
                -1.0, &lcol[n], ldl, ld, ldld,
                0.0, node->contrib, m-n);
@@ -412,17 +417,20 @@ private:
          /* Build lookup vector, allowing for insertion of delayed vars */
          /* Note that while rlist[] is 1-indexed this is fine so long as lookup
           * is also 1-indexed (which it is as it is another node's rlist[] */
-         for(int i=0; i<snode.ncol; i++)
-            map[ snode.rlist[i] ] = i;
-         for(int i=snode.ncol; i<snode.nrow; i++)
-            map[ snode.rlist[i] ] = i + node.ndelay_in;
+         if(needs_map(snode, node)) {
+            for(int i=0; i<snode.ncol; i++)
+               map[ snode.rlist[i] ] = i;
+            for(int i=snode.ncol; i<snode.nrow; i++)
+               map[ snode.rlist[i] ] = i + node.ndelay_in;
+         }
          /* Loop over children adding contributions */
          for(auto* child=node.first_child; child!=NULL; child=child->next_child) {
             SymbolicNode const& csnode = child->symb;
             if(!child->contrib) continue;
             int cm = csnode.nrow - csnode.ncol;
             for(int i=0; i<cm; i++) {
-               int c = map[ csnode.rlist[csnode.ncol+i] ];
+               int c = child_row_pos(csnode, csnode.ncol+i, snode,
+                     node.ndelay_in, map);
                T *src = &child->contrib[i*cm];
                // NB: only interested in contribution to generated element
                if(c >= snode.ncol) {
@@ -430,7 +438,8 @@ private:
                   int ldd = snode.nrow - snode.ncol;
                   T *dest = &node.contrib[(c-ncol)*ldd];
                   for(int j=i; j<cm; j++) {
-                     int r = map[ csnode.rlist[csnode.ncol+j] ] - ncol;
+                     int r = child_row_pos(csnode, csnode.ncol+j, snode,
+                           node.ndelay_in, map) - ncol;
                      dest[r] += src[j];
                   }
                }
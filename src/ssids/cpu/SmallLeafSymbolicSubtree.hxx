@@ -110,6 +110,10 @@ public:
 
    /** \brief Return parent node of subtree in parttree indexing. */
    int get_parent() const { return parent_; }
+   /** \brief Return first node of subtree in parttree indexing. */
+   int get_sa() const { return sa_; }
+   /** \brief Return last node of subtree in parttree indexing. */
+   int get_en() const { return en_; }
    /** \brief Return given node of this tree. */
    Node const& operator[](int idx) const { return nodes_[idx]; }
 protected:
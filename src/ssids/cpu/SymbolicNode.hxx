@@ -21,7 +21,13 @@ struct SymbolicNode {
    int const* rlist; //< Pointer to row lists
    int num_a; //< Number of entries mapped from A to L
    int64_t const* amap; //< Pointer to map from A to L locations
+   int const* relidx; //< Position in parent's rlist of each row of
+                      //< contribution block (nullptr if not stored)
    int parent; //< index of parent node
+   int contrib_ld; //< Leading dimension of contribution block storage, more
+                   //< than nrow-ncol if ancestors extend it in place
+   int inplace_offset; //< If >= 0, contribution block is built in place in
+                       //< that of only child, at this diagonal offset
    std::vector<int> contrib; //< index of expected contribution(s)
 };
 
@@ -19,6 +19,26 @@ void* spral_ssids_cpu_create_symbolic_subtree(
          );
 }
 
+extern "C"
+int64_t spral_ssids_cpu_symbolic_subtree_relidx_mem(void const* target) {
+   auto const* subtree = static_cast<SymbolicSubtree const*>(target);
+   return subtree->get_relidx_mem();
+}
+
+extern "C"
+int64_t spral_ssids_cpu_symbolic_subtree_factor_mem(void const* target,
+      bool posdef) {
+   auto const* subtree = static_cast<SymbolicSubtree const*>(target);
+   return subtree->get_factor_mem(posdef);
+}
+
+extern "C"
+int64_t spral_ssids_cpu_symbolic_subtree_work_mem(void const* target,
+      bool posdef) {
+   auto const* subtree = static_cast<SymbolicSubtree const*>(target);
+   return subtree->get_work_mem(posdef);
+}
+
 extern "C"
 void spral_ssids_cpu_destroy_symbolic_subtree(void* target) {
    if(!target) return;
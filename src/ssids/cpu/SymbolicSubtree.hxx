@@ -5,12 +5,17 @@
  */
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <vector>
 
+#include "ssids/cpu/block_size.hxx"
 #include "ssids/cpu/SmallLeafSymbolicSubtree.hxx"
 #include "ssids/cpu/SymbolicNode.hxx"
+#include "ssids/cpu/ThreadCacheAllocator.hxx"
+#include "ssids/cpu/kernels/ldlt_app.hxx"
+#include "ssids/cpu/kernels/ldlt_tpp.hxx"
 
 namespace spral { namespace ssids { namespace cpu {
 
@@ -24,7 +29,6 @@ public:
       sa--;
       // FIXME: don't process nodes that are in small leaf subtrees
       /* Fill out basic details */
-      maxfront_ = 0;
       for(int ni=0; ni<nnodes_; ++ni) {
          nodes_[ni].idx = ni;
          nodes_[ni].nrow = static_cast<int>(rptr[sa+ni+1] - rptr[sa+ni]);
@@ -34,9 +38,9 @@ public:
          nodes_[ni].rlist = &rlist[rptr[sa+ni]-1]; // rptr is Fortran indexed
          nodes_[ni].num_a = nptr[sa+ni+1] - nptr[sa+ni];
          nodes_[ni].amap = &nlist[2*(nptr[sa+ni]-1)]; // nptr is Fortran indexed
+         nodes_[ni].relidx = nullptr;
          nodes_[ni].parent = sparent[sa+ni]-sa-1; // sparent is Fortran indexed
          nodes_[ni].insmallleaf = false; // default to not in small leaf subtree
-         maxfront_ = std::max(maxfront_, (size_t) nodes_[ni].nrow);
       }
       nodes_[nnodes_].first_child = nullptr; // List of roots
       /* Build child linked lists */
@@ -45,15 +49,13 @@ public:
          nodes_[ni].next_child = parent->first_child;
          parent->first_child = &nodes_[ni];
       }
+      /* Store relative indices of children's rows in their parent */
+      if(options.store_relidx) build_relidx();
       /* Record contribution block inputs */
       for(int ci=0; ci<ncontrib; ++ci) {
          int idx = contrib_idx[ci]-1 - sa; // contrib_idx is Fortran indexed
          nodes_[idx].contrib.push_back(ci);
       }
-      /* Count size of factors */
-      nfactor_ = 0;
-      for(int ni=0; ni<nnodes_; ++ni)
-         nfactor_ += static_cast<size_t>(nodes_[ni].nrow)*nodes_[ni].ncol;
       /* Find small leaf subtrees */
       // Count flops below each node
       std::vector<int64_t> flops(nnodes_+1, 0);
@@ -82,29 +84,256 @@ public:
             nodes_[i].insmallleaf = true;
          ni = last+1; // Skip to next node not in this subtree
       }
+      /* Find chains of nodes that can extend their child's contribution
+       * block in place */
+      plan_inplace_contrib();
+      /* Predict memory needed by factorization */
+      for(int i=0; i<2; ++i)
+         predict_mem(i==1, options);
    }
 
    SymbolicNode const& operator[](int idx) const {
       return nodes_[idx];
    }
-   size_t get_factor_mem_est(double multiplier) const {
-      size_t mem = n*sizeof(int) + (2*n+nfactor_)*sizeof(double);
+   /** Return memory (in bytes) used by relative indices */
+   size_t get_relidx_mem() const {
+      return relidx_.size()*sizeof(int);
+   }
+   /** Return memory (in bytes) for factors if there are no delays */
+   size_t get_factor_mem(bool posdef) const {
+      return factor_mem_[posdef];
+   }
+   /** Return memory (in bytes) to allocate for factors, allowing for delays
+    *  in the indefinite case by the given multiplier */
+   size_t get_factor_mem_est(bool posdef, double multiplier) const {
+      size_t mem = get_factor_mem(posdef);
+      if(posdef) return mem;
       return std::max(mem, static_cast<size_t>(mem*multiplier));
    }
+   /** Return size of initial pool for contribution blocks and other
+    *  temporary storage, in units of T */
    template <typename T>
-   size_t get_pool_size() const {
-      return maxfront_*align_lda<double>(maxfront_);
+   size_t get_pool_size(bool posdef) const {
+      return (pool_mem_[posdef]-1) / sizeof(T) + 1;
+   }
+   /** Return memory (in bytes) for each thread's Workspace */
+   size_t get_work_mem(bool posdef) const {
+      return work_mem_[posdef];
    }
 public:
    int const n; //< Maximum row index
 private:
+   /** For every node with a parent in this subtree, find the position in
+    *  the parent's row list of each row of its contribution block. */
+   void build_relidx() {
+      size_t nrelidx = 0;
+      for(int ni=0; ni<nnodes_; ++ni)
+         if(nodes_[ni].parent < nnodes_)
+            nrelidx += nodes_[ni].nrow - nodes_[ni].ncol;
+      relidx_.resize(nrelidx);
+      std::vector<int> map(n+1);
+      size_t next = 0;
+      for(int pi=0; pi<nnodes_; ++pi) {
+         SymbolicNode const& pnode = nodes_[pi];
+         if(!pnode.first_child) continue;
+         for(int i=0; i<pnode.nrow; ++i)
+            map[ pnode.rlist[i] ] = i;
+         for(auto* child=pnode.first_child; child; child=child->next_child) {
+            int cm = child->nrow - child->ncol;
+            for(int j=0; j<cm; ++j)
+               relidx_[next+j] = map[ child->rlist[child->ncol+j] ];
+            child->relidx = relidx_.data() + next;
+            next += cm;
+         }
+      }
+   }
+
+   /** Find chains of nodes whose contribution block can be built in place
+    *  in that of their only child (see NumericNode::adopt_contrib()).
+    *
+    *  This needs the child's contribution rows, less any of the parent's
+    *  fully summed columns (which come first), to be the first rows of the
+    *  parent's contribution block in the same order. The parent's block is
+    *  then the child's extended by new trailing rows and columns, as is
+    *  common along chains of separator nodes.
+    *
+    *  The node at the bottom of each chain allocates storage for the whole
+    *  chain. The chain is cut before this exceeds the memory of the child
+    *  and parent blocks that would otherwise both be held during assembly of
+    *  any one node of the chain. This bounds, but does not remove, the
+    *  extra memory held: the storage is allocated while the blocks of the
+    *  bottom node's children are still held, and the top node's block keeps
+    *  its larger size until its parent is assembled. Peak memory may hence
+    *  grow, as predict_mem() allows for. Including the children's blocks in
+    *  the test would cut almost every chain, as at the bottom of a
+    *  separator chain they are typically the two largest blocks around. */
+   void plan_inplace_contrib() {
+      std::vector<int> base(nnodes_); // node that allocates storage
+      std::vector<int> base_offset(nnodes_, 0); // offset within base's
+      for(int ni=0; ni<nnodes_; ++ni) {
+         SymbolicNode& node = nodes_[ni];
+         node.contrib_ld = node.nrow - node.ncol;
+         node.inplace_offset = -1;
+         base[ni] = ni;
+         // Children precede parents, so child's chain is already known
+         SymbolicNode const* child = node.first_child;
+         if(!child || child->next_child) continue; // not an only child
+         if(node.insmallleaf || child->insmallleaf) continue;
+         int m = node.nrow - node.ncol;
+         int cm = child->nrow - child->ncol;
+         if(m == 0 || cm == 0) continue;
+         // Fully summed columns of a node are consecutive
+         int first = node.rlist[0];
+         if(node.rlist[node.ncol-1] != first + node.ncol-1) continue;
+         int offset = 0;
+         while(offset < cm) {
+            int row = child->rlist[child->ncol+offset];
+            if(row < first || row >= first+node.ncol) break;
+            ++offset;
+         }
+         if(cm-offset > m) continue;
+         if(!std::equal(&child->rlist[child->ncol+offset],
+                  &child->rlist[child->nrow], &node.rlist[node.ncol]))
+            continue;
+         int cbase = base[child->idx];
+         int64_t total_offset = base_offset[child->idx] + offset;
+         int64_t ld = std::max<int64_t>(nodes_[cbase].contrib_ld,
+               total_offset + m);
+         if(ld*ld > int64_t(cm)*cm + int64_t(m)*m) continue;
+         nodes_[cbase].contrib_ld = static_cast<int>(ld);
+         node.inplace_offset = offset;
+         base[ni] = cbase;
+         base_offset[ni] = static_cast<int>(total_offset);
+      }
+      for(int ni=0; ni<nnodes_; ++ni)
+         nodes_[ni].contrib_ld = nodes_[base[ni]].contrib_ld;
+   }
+
+   /** Predict the memory used by a factorization that processes the nodes
+    *  one at a time in order, with no delays.
+    *
+    *  Factor memory is exact, up to the alignment of each allocation. The
+    *  pool holds contribution blocks and APP backups, and its use is
+    *  simulated by ThreadCacheAllocator's CacheSimulator. Workspace is the
+    *  most any node asks for. */
+   void predict_mem(bool posdef, struct cpu_factor_options const& options) {
+      size_t const align = 64; // at least that of any allocation
+      auto aligned = [align](size_t sz) { return align*((sz-1)/align + 1); };
+      bool inplace =
+         posdef || options.pivot_method != PivotMethod::app_aggressive;
+      bool app = !posdef && options.pivot_method != PivotMethod::tpp;
+
+      /* Factors */
+      size_t factor_mem = 0;
+      for(int ni=0; ni<nnodes_; ++ni) {
+         SymbolicNode const& node = nodes_[ni];
+         size_t ldl = align_lda<double>(node.nrow);
+         // Small leaf subtrees allocate posdef factors in one go, below
+         if(!posdef || !node.insmallleaf)
+            factor_mem += aligned(
+                  (posdef ? ldl : ldl+2) * node.ncol * sizeof(double)
+                  );
+         factor_mem += aligned(node.ncol * sizeof(int)); // perm
+      }
+      if(posdef) {
+         for(auto const& leaf : small_leafs_) {
+            size_t nfactor = 0;
+            for(int ni=leaf.get_sa(); ni<=leaf.get_en(); ++ni)
+               nfactor += align_lda<double>(nodes_[ni].nrow)*nodes_[ni].ncol;
+            factor_mem += aligned(nfactor*sizeof(double));
+         }
+      }
+      factor_mem_[posdef] = factor_mem;
+
+      /* Pool */
+      thread_cache_alloc_internal::CacheSimulator pool;
+      std::vector<size_t> block(nnodes_, 0); // bytes of contrib held
+      for(int ni=0; ni<nnodes_; ++ni) {
+         SymbolicNode const& node = nodes_[ni];
+         bool adopt = inplace && node.inplace_offset >= 0;
+         if(!adopt) {
+            size_t ld = (inplace && !node.insmallleaf)
+               ? node.contrib_ld : node.nrow - node.ncol;
+            block[ni] = ld*ld*sizeof(double);
+            if(block[ni]) pool.allocate(block[ni]);
+         }
+         if(app && !node.insmallleaf) {
+            // As ldlt_app_factor(): backup and column data of node, then of
+            // the diagonal block being factorized
+            int const inner_block_size = LDLT_APP_INNER_BLOCK_SIZE;
+            int const block_size = get_block_size(node.nrow, options);
+            size_t const col_sz = ldlt_app_column_data_bytes<double>();
+            int blkn = std::min(block_size, node.ncol);
+            BackupMethod backup = ldlt_app_backup_method(node.nrow,
+                  node.ncol, block_size, options.pivot_method, SIZE_MAX);
+            size_t sizes[] = {
+               ldlt_app_backup_mem(backup, node.nrow, node.ncol, block_size),
+               ((node.ncol-1)/block_size + 1) * col_sz,
+               ((node.ncol-1)/block_size + 1) * block_size * sizeof(int),
+               align_lda<double>(std::min(block_size, node.nrow)) * blkn
+                  * sizeof(double),
+               ((blkn-1)/inner_block_size + 1) * col_sz,
+               ((blkn-1)/inner_block_size + 1) * inner_block_size
+                  * sizeof(int)
+            };
+            for(size_t sz : sizes) pool.allocate(sz);
+            for(size_t sz : sizes) pool.deallocate(sz);
+         }
+         for(auto* child=node.first_child; child; child=child->next_child) {
+            if(adopt) block[ni] = block[child->idx]; // only child
+            else if(block[child->idx]) pool.deallocate(block[child->idx]);
+         }
+      }
+      // Allow for small allocations not simulated above
+      pool_mem_[posdef] =
+         pool.get_region_used() + thread_cache_alloc_internal::CHUNK_SIZE;
+
+      /* Workspace */
+      size_t work_mem = 0;
+      for(int ni=0; ni<nnodes_; ++ni) {
+         SymbolicNode const& node = nodes_[ni];
+         int m = node.nrow;
+         int nc = node.ncol;
+         if(node.insmallleaf) {
+            // Row map, then TPP's copies of L*D
+            work_mem = std::max(work_mem, (n+1)*sizeof(int));
+            if(!posdef) {
+               work_mem = std::max(work_mem, 2*m*sizeof(double));
+               if(m > nc)
+                  work_mem = std::max(work_mem,
+                        nc*align_lda<double>(m-nc)*sizeof(double));
+            }
+            continue;
+         }
+         // Block update of APP, or full TPP
+         if(app) {
+            int const block_size = get_block_size(m, options);
+            work_mem = std::max(work_mem,
+                  block_size*align_lda<double>(block_size)*sizeof(double));
+         }
+         if(!posdef && options.pivot_method == PivotMethod::tpp) {
+            work_mem = std::max(work_mem, TPP_BLOCK_SIZE*m*sizeof(double));
+            if(m > nc)
+               work_mem = std::max(work_mem,
+                     nc*align_lda<double>(m-nc)*sizeof(double));
+         }
+         // Cached row positions for assembly of each child
+         for(auto* child=node.first_child; child; child=child->next_child)
+            work_mem = std::max(work_mem,
+                  2*(child->nrow - child->ncol)*sizeof(int));
+      }
+      work_mem_[posdef] = work_mem;
+   }
+
    int nnodes_;
-   size_t nfactor_;
-   size_t maxfront_;
+   size_t factor_mem_[2]; //< Predicted factor memory, indexed by posdef
+   size_t pool_mem_[2]; //< Predicted pool memory, indexed by posdef
+   size_t work_mem_[2]; //< Predicted Workspace per thread, indexed by posdef
    std::vector<SymbolicNode> nodes_;
+   std::vector<int> relidx_; //< Storage for SymbolicNode::relidx
    std::vector<SmallLeafSymbolicSubtree> small_leafs_;
 
-   template <bool posdef, typename T, size_t PAGE_SIZE, typename FactorAlloc>
+   template <bool posdef, typename T, typename FactorAlloc>
    friend class NumericSubtree;
 };
 
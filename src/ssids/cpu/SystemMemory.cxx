@@ -0,0 +1,190 @@
+/** \file
+ *  \copyright 2016 The Science and Technology Facilities Council (STFC)
+ *  \licence   BSD licence, see LICENCE file for details
+ *  \author    Jonathan Hogg
+ */
+#include "ssids/cpu/SystemMemory.hxx"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include "config.h"
+#include "hw_topology/hwloc_wrapper.hxx"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif /* __linux__ */
+
+namespace spral { namespace ssids { namespace cpu {
+
+namespace {
+
+/** How an area was obtained */
+enum AreaKind { AREA_MALLOC, AREA_MMAP };
+
+/** Record of an area, stored at its start ahead of the memory returned */
+struct AreaHeader {
+   void* base; ///< Start of underlying allocation
+   size_t len; ///< Length of underlying allocation
+   int64_t nhuge; ///< Number of huge pages in area
+   AreaKind kind; ///< How area was obtained
+};
+/** Space reserved for AreaHeader, preserving alignment of mmap'd areas */
+size_t const HEADER_SIZE = 64;
+static_assert(sizeof(AreaHeader) <= HEADER_SIZE, "AreaHeader too large");
+
+size_t round_up(size_t sz, size_t unit) {
+   return unit * ((sz + unit - 1) / unit);
+}
+
+#ifdef __linux__
+/** Return size of transparent huge pages, or 0 if they are unavailable */
+size_t get_thp_size() {
+   static size_t const size = []() -> size_t {
+      char buf[128] = "";
+      FILE* fp = fopen("/sys/kernel/mm/transparent_hugepage/enabled", "r");
+      if(!fp) return 0;
+      bool ok = fgets(buf, sizeof(buf), fp) && !strstr(buf, "[never]");
+      fclose(fp);
+      if(!ok) return 0;
+      size_t sz = 2*1024*1024; // Default if size not reported
+      fp = fopen("/sys/kernel/mm/transparent_hugepage/hpage_pmd_size", "r");
+      if(fp) {
+         unsigned long val;
+         if(fscanf(fp, "%lu", &val) == 1 && val > 0) sz = val;
+         fclose(fp);
+      }
+      return sz;
+   }();
+   return size;
+}
+
+/** Return default size of hugetlbfs pages, or 0 if unknown */
+size_t get_hugetlb_size() {
+   static size_t const size = []() -> size_t {
+      FILE* fp = fopen("/proc/meminfo", "r");
+      if(!fp) return 0;
+      char line[128];
+      unsigned long kb = 0;
+      while(fgets(line, sizeof(line), fp))
+         if(sscanf(line, "Hugepagesize: %lu kB", &kb) == 1) break;
+      fclose(fp);
+      return 1024*size_t(kb);
+   }();
+   return size;
+}
+
+/** Map len bytes of hugetlbfs pages of size page_size, using the given
+ *  page size flag. Returns nullptr on failure. */
+void* map_hugetlb(size_t len, size_t page_size, int size_flag) {
+   void* ptr = mmap(nullptr, round_up(len, page_size), PROT_READ|PROT_WRITE,
+         MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB|size_flag, -1, 0);
+   return (ptr == MAP_FAILED) ? nullptr : ptr;
+}
+#endif /* __linux__ */
+
+} /* anon namespace */
+
+void bind_to_numa_region(void* ptr, std::size_t len, int region) {
+#ifdef HAVE_HWLOC
+   if(region < 0 || !ptr) return;
+
+   // Restrict to whole pages, so no memory outside the area is affected
+   static const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+   uintptr_t start = reinterpret_cast<uintptr_t>(ptr);
+   uintptr_t end = start + len;
+   start = page_size * ((start + page_size - 1) / page_size);
+   end = page_size * (end / page_size);
+   if(end <= start) return;
+
+   // Topology is loaded once, and never modified, so may be shared
+   static const hw_topology::HwlocTopology topology;
+   static const auto numa_nodes = topology.get_numa_nodes();
+   if(region >= static_cast<int>(numa_nodes.size())) return;
+   topology.bind_area(reinterpret_cast<void*>(start), end-start,
+         numa_nodes[region]);
+#endif /* HAVE_HWLOC */
+}
+
+void* SystemMemory::allocate(std::size_t sz, bool zero) {
+   AreaHeader area = { nullptr, sz + HEADER_SIZE, 0, AREA_MALLOC };
+
+#ifdef __linux__
+   // Try the huge page pool (mmap'd memory is always zero)
+   if(huge_pages_ == HugePages::hugetlbfs) {
+#ifdef MAP_HUGE_1GB
+      size_t const gb = size_t(1) << 30;
+      if(area.len >= gb && round_up(area.len, gb) - area.len <= area.len/8) {
+         area.base = map_hugetlb(area.len, gb, MAP_HUGE_1GB);
+         if(area.base) {
+            area.len = round_up(area.len, gb);
+            area.nhuge = area.len / gb;
+         }
+      }
+#endif /* MAP_HUGE_1GB */
+      size_t hsz = get_hugetlb_size();
+      if(!area.base && hsz > 0 && area.len >= hsz) {
+         area.base = map_hugetlb(area.len, hsz, 0);
+         if(area.base) {
+            area.len = round_up(area.len, hsz);
+            area.nhuge = area.len / hsz;
+         }
+      }
+      if(area.base) area.kind = AREA_MMAP;
+   }
+
+   // Otherwise try transparent huge pages
+   size_t hsz = get_thp_size();
+   if(!area.base && huge_pages_ != HugePages::none && hsz > 0 &&
+         area.len >= hsz) {
+      // Over allocate so we can trim to huge page boundaries
+      size_t len = round_up(area.len, hsz);
+      char* ptr = static_cast<char*>(mmap(nullptr, len+hsz,
+               PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0));
+      if(ptr != MAP_FAILED) {
+         char* start = reinterpret_cast<char*>(
+               round_up(reinterpret_cast<uintptr_t>(ptr), hsz));
+         if(start > ptr) munmap(ptr, start-ptr);
+         if(start < ptr+hsz) munmap(start+len, ptr+hsz-start);
+         area.base = start;
+         area.len = len;
+         area.kind = AREA_MMAP;
+         if(!madvise(start, len, MADV_HUGEPAGE)) area.nhuge = len / hsz;
+      }
+   }
+#endif /* __linux__ */
+
+   // Fall back to malloc. NB: calloc obtains large areas untouched, so
+   // that their pages are placed by the binding below when first touched.
+   if(!area.base) {
+      area.base = zero ? calloc(area.len, 1) : malloc(area.len);
+      if(!area.base) throw std::bad_alloc();
+   }
+
+   bind_to_numa_region(area.base, area.len, numa_region_);
+   if(area.nhuge > 0) {
+      int64_t cur = (cur_huge_ += area.nhuge);
+      int64_t peak = peak_huge_.load();
+      while(cur > peak && !peak_huge_.compare_exchange_weak(peak, cur));
+   }
+   memcpy(area.base, &area, sizeof(area));
+   return static_cast<char*>(area.base) + HEADER_SIZE;
+}
+
+void SystemMemory::deallocate(void* ptr) {
+   if(!ptr) return;
+   AreaHeader area;
+   memcpy(&area, static_cast<char*>(ptr) - HEADER_SIZE, sizeof(area));
+   cur_huge_ -= area.nhuge;
+#ifdef __linux__
+   if(area.kind == AREA_MMAP) {
+      munmap(area.base, area.len);
+      return;
+   }
+#endif /* __linux__ */
+   free(area.base);
+}
+
+}}} /* namespaces spral::ssids::cpu */
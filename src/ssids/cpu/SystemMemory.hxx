@@ -0,0 +1,126 @@
+/** \file
+ *  \copyright 2016 The Science and Technology Facilities Council (STFC)
+ *  \licence   BSD licence, see LICENCE file for details
+ *  \author    Jonathan Hogg
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+
+#include "ssids/cpu/cpu_iface.hxx"
+
+namespace spral { namespace ssids { namespace cpu {
+
+/** \brief Bind the pages lying wholly within a memory area to the memory of
+ *         a NUMA region.
+ *
+ * Pages that have not yet been touched are placed in the region when first
+ * touched, and those that have are migrated to it. This is a hint only:
+ * nothing is done if region is negative or the binding fails, or if SPRAL
+ * was built without hwloc.
+ *
+ * \param ptr Start of area.
+ * \param len Length of area in bytes.
+ * \param region Index of NUMA region (counted from 0), in the order found
+ *        by spral_hw_topology_guess().
+ */
+void bind_to_numa_region(void* ptr, std::size_t len, int region);
+
+/** \brief Source of the large memory areas underlying the arenas of a
+ *         subtree (factor pages, pool regions and workspaces).
+ *
+ * Areas are bound to the NUMA region that factorizes the subtree and, if
+ * requested, backed by huge pages:
+ * - HugePages::transparent maps areas of at least one transparent huge page
+ *   aligned to huge page boundaries and advises the kernel to use huge
+ *   pages for them (madvise(MADV_HUGEPAGE)).
+ * - HugePages::hugetlbfs maps them from the preallocated huge page pool
+ *   (mmap(MAP_HUGETLB)), using 1GB pages if this wastes little memory. If
+ *   the pool is exhausted, transparent huge pages are used instead.
+ * Smaller areas, and all areas if huge pages are unavailable, come from
+ * malloc. Memory is returned to the system on deallocation.
+ *
+ * The number of huge pages held is tracked, so that the peak may be
+ * reported to the user. For transparent huge pages this is the number
+ * requested: the kernel may not provide them all.
+ */
+class SystemMemory {
+public:
+   /** \brief Constructor.
+    *  \param numa_region NUMA region to bind memory to, or -1 for no
+    *         preference.
+    *  \param huge_pages Type of huge pages to use. */
+   SystemMemory(int numa_region=-1, HugePages huge_pages=HugePages::none)
+   : numa_region_(numa_region), huge_pages_(huge_pages)
+   {}
+   SystemMemory(SystemMemory const&) =delete;
+   SystemMemory& operator=(SystemMemory const&) =delete;
+
+   /** \brief Allocate an area.
+    *  \param sz Size of area in bytes.
+    *  \param zero If true, the area is zeroed.
+    *  \returns Pointer to area, aligned as for malloc().
+    *  \throws std::bad_alloc on failure. */
+   void* allocate(std::size_t sz, bool zero);
+   /** \brief Free an area returned by allocate(). */
+   void deallocate(void* ptr);
+
+   /** \brief Start a new period for get_peak_huge_pages() */
+   void reset_peak() { peak_huge_ = cur_huge_.load(); }
+   /** \brief Return peak number of huge pages held since reset_peak() */
+   int64_t get_peak_huge_pages() const { return peak_huge_; }
+
+private:
+   int const numa_region_; ///< NUMA region, -1 for no preference
+   HugePages const huge_pages_; ///< Type of huge pages to use
+   std::atomic<int64_t> cur_huge_{0}; ///< Huge pages currently held
+   std::atomic<int64_t> peak_huge_{0}; ///< Peak of cur_huge_
+};
+
+/** \brief Allocator that obtains its memory from a SystemMemory.
+ *
+ * Intended as the underlying allocator of the pool allocators, which make
+ * few, large allocations.
+ *
+ * \tparam T type to allocate.
+ */
+template <typename T>
+class SystemAllocator {
+public:
+   typedef T value_type;
+
+   /** \brief Constructor.
+    *  \param mem Source of memory. Must outlive all allocations. */
+   explicit SystemAllocator(SystemMemory* mem)
+   : mem_(mem)
+   {}
+   /** \brief Rebind a type U SystemAllocator to type T */
+   template <typename U>
+   SystemAllocator(SystemAllocator<U> const& other)
+   : mem_(other.mem_)
+   {}
+
+   T* allocate(std::size_t n) {
+      return static_cast<T*>(mem_->allocate(n*sizeof(T), false));
+   }
+   void deallocate(T* ptr, std::size_t n) {
+      mem_->deallocate(ptr);
+   }
+
+   template <typename U>
+   bool operator==(SystemAllocator<U> const& rhs) const {
+      return mem_ == rhs.mem_;
+   }
+   template <typename U>
+   bool operator!=(SystemAllocator<U> const& rhs) const {
+      return !(*this==rhs);
+   }
+private:
+   SystemMemory* mem_; ///< Source of memory
+   template <typename U> friend class SystemAllocator;
+};
+
+}}} /* namespaces spral::ssids::cpu */
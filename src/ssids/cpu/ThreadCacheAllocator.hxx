@@ -0,0 +1,581 @@
+/** \file
+ *  \copyright 2016 The Science and Technology Facilities Council (STFC)
+ *  \licence   BSD licence, see LICENCE file for details
+ *  \author    Jonathan Hogg
+ */
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <vector>
+#ifdef __linux__
+#include <sys/mman.h>
+#include <unistd.h>
+#endif /* __linux__ */
+
+#include "config.h" // for HAVE_AVX*_KERNELS
+#include "omp.hxx"
+#include "ssids/cpu/MemoryBudget.hxx"
+
+namespace spral { namespace ssids { namespace cpu {
+
+namespace thread_cache_alloc_internal {
+
+#if defined(__AVX512F__) || defined(HAVE_AVX512_KERNELS)
+int const align=64; ///< Underlying alignment of all pointers returned
+#elif defined(__AVX__) || defined(HAVE_AVX2_KERNELS)
+int const align=32; ///< Underlying alignment of all pointers returned
+#else
+int const align=16; ///< Underlying alignment of all pointers returned
+#endif
+int const MIN_CLASS = 7; ///< log2 of smallest block size (incl. header)
+int const MAX_CLASS = 20; ///< log2 of largest block size held in caches
+int const NCLASS = MAX_CLASS-MIN_CLASS+1; ///< Number of size classes
+size_t const CHUNK_SIZE = 1<<18; ///< Size of chunk a Cache takes from Table
+int const LARGE_OWNER = -1; ///< Owner of blocks too big for any class
+
+/**
+ * \brief Header stored in the align bytes preceding every pointer returned.
+ *
+ * Records the size class and owning Cache of the block so deallocation can
+ * find both in O(1). While a block is free, next links it into a free list;
+ * for a block too large for the caches it holds the underlying allocation.
+ */
+struct Header {
+   union {
+      Header* next; ///< Next free block (free blocks only)
+      char* raw; ///< Underlying allocation (large blocks only)
+   };
+   int owner; ///< Index of Cache that carved block, or LARGE_OWNER
+   int cls; ///< Size class of block
+};
+static_assert(sizeof(Header) <= align, "Header must fit in alignment gap");
+
+/** \brief Return pointer handed out for block */
+inline void* block_to_ptr(Header* h) {
+   return reinterpret_cast<char*>(h) + align;
+}
+/** \brief Return block header for pointer handed out */
+inline Header* ptr_to_block(void* ptr) {
+   return reinterpret_cast<Header*>(static_cast<char*>(ptr) - align);
+}
+/** \brief Return size class of block needed for allocation of sz bytes */
+inline int size_to_class(std::size_t sz) {
+   size_t need = sz + align;
+   int cls = MIN_CLASS;
+   while((size_t(1)<<cls) < need) ++cls;
+   return cls;
+}
+/** \brief Return memory drawn from Table by allocation of sz bytes */
+inline size_t footprint(std::size_t sz) {
+   if(sz == 0) return 0;
+   int cls = size_to_class(sz);
+   return (cls > MAX_CLASS) ? sz + 2*align : size_t(1) << cls;
+}
+/** \brief Return index of calling thread in current team */
+inline int thread_num() {
+#ifdef _OPENMP
+   return omp_get_thread_num();
+#else
+   return 0;
+#endif /* _OPENMP */
+}
+
+/**
+ * \brief Per-thread cache of free blocks, one free list per size class.
+ *
+ * A Cache is normally only touched by the thread whose number matches its
+ * index in the Table, so acquiring it is an uncontended atomic operation.
+ * Blocks freed by any other thread are pushed onto remote_ with a lock-free
+ * compare-and-swap, and are only moved to the free lists by the owning
+ * thread when it runs out of blocks of a given class.
+ *
+ * Blocks split from the remainder of a chunk are kept on separate spare
+ * lists until first handed out, so that Table can tell memory that has
+ * been used (and so is resident) from memory that has not. Free blocks
+ * whose pages are given back to the system by release_free() rejoin them.
+ *
+ * \sa Table
+ */
+class Cache {
+public:
+   Cache() {
+      for(int i=0; i<NCLASS; ++i) free_[i] = spare_[i] = nullptr;
+   }
+   // \{
+   Cache(Cache const&) =delete;
+   Cache& operator=(Cache const&) =delete;
+   // \}
+
+   /** \brief Try to take exclusive use of this cache */
+   bool try_acquire() {
+      return !busy_.test_and_set(std::memory_order_acquire);
+   }
+   /** \brief Release exclusive use of this cache */
+   void release() {
+      busy_.clear(std::memory_order_release);
+   }
+
+   /**
+    * \brief Return a free block of given class, or nullptr if none.
+    *
+    * Caller must have acquired the cache.
+    */
+   Header* pop(int cls) {
+      int i = cls-MIN_CLASS;
+      if(!free_[i]) {
+         drain_remote();
+         if(!free_[i]) return nullptr;
+      }
+      Header* h = free_[i];
+      free_[i] = h->next;
+      return h;
+   }
+   /**
+    * \brief Return a spare block of given class, or nullptr if none.
+    *
+    * Caller must have acquired the cache.
+    */
+   Header* pop_spare(int cls) {
+      int i = cls-MIN_CLASS;
+      Header* h = spare_[i];
+      if(h) spare_[i] = h->next;
+      return h;
+   }
+   /** \brief Return block to free lists. Caller must have acquired cache. */
+   void push_local(Header* h) {
+      int i = h->cls-MIN_CLASS;
+      h->next = free_[i];
+      free_[i] = h;
+   }
+   /** \brief Return block freed by another thread. May be called at any time.
+    */
+   void push_remote(Header* h) {
+      Header* head = remote_.load(std::memory_order_relaxed);
+      do {
+         h->next = head;
+      } while(!remote_.compare_exchange_weak(head, h,
+               std::memory_order_release, std::memory_order_relaxed));
+   }
+
+   /**
+    * \brief Carve a new block of given class from the current chunk.
+    *
+    * Returns nullptr if the chunk has insufficient space. Caller must have
+    * acquired the cache.
+    */
+   Header* carve(int cls, int owner) {
+      size_t sz = size_t(1) << cls;
+      if(sz > chunk_left_) return nullptr;
+      Header* h = reinterpret_cast<Header*>(chunk_);
+      h->owner = owner;
+      h->cls = cls;
+      chunk_ += sz;
+      chunk_left_ -= sz;
+      return h;
+   }
+   /**
+    * \brief Start carving from a new chunk.
+    *
+    * Any remainder of the old chunk is split into blocks of the largest
+    * classes that fit and added to the spare lists, so no memory is lost.
+    */
+   void new_chunk(char* chunk, size_t sz, int owner) {
+      for(int cls=MAX_CLASS; cls>=MIN_CLASS; --cls) {
+         while(chunk_left_ >= (size_t(1)<<cls)) {
+            Header* h = carve(cls, owner);
+            h->next = spare_[cls-MIN_CLASS];
+            spare_[cls-MIN_CLASS] = h;
+         }
+      }
+      chunk_ = chunk;
+      chunk_left_ = sz;
+   }
+
+   /**
+    * \brief Give the pages of free blocks back to the system and move the
+    *        blocks to the spare lists.
+    *
+    * Only the whole pages after each block's header are given back, so
+    * blocks smaller than two pages are left alone. Caller must have acquired
+    * the cache.
+    *
+    * \returns Bytes of blocks moved (whole blocks).
+    */
+   size_t release_free() {
+      size_t bytes = 0;
+#ifdef __linux__
+      static const uintptr_t page_size = sysconf(_SC_PAGESIZE);
+      drain_remote();
+      for(int i=0; i<NCLASS; ++i) {
+         size_t sz = size_t(1) << (i+MIN_CLASS);
+         if(sz < 2*page_size) continue;
+         Header** prev = &free_[i];
+         while(*prev) {
+            Header* h = *prev;
+            uintptr_t start = reinterpret_cast<uintptr_t>(h) + align;
+            uintptr_t end = reinterpret_cast<uintptr_t>(h) + sz;
+            start = page_size * ((start + page_size - 1) / page_size);
+            end = page_size * (end / page_size);
+            // May fail, e.g. for hugetlbfs pages: then keep block as it is
+            if(madvise(reinterpret_cast<void*>(start), end-start,
+                     MADV_DONTNEED)) {
+               prev = &h->next;
+               continue;
+            }
+            *prev = h->next;
+            h->next = spare_[i];
+            spare_[i] = h;
+            bytes += sz;
+         }
+      }
+#endif /* __linux__ */
+      return bytes;
+   }
+
+private:
+   /** Move all blocks on remote_ onto the free lists */
+   void drain_remote() {
+      Header* h = remote_.exchange(nullptr, std::memory_order_acquire);
+      while(h) {
+         Header* next = h->next;
+         push_local(h);
+         h = next;
+      }
+   }
+
+   std::atomic_flag busy_ = ATOMIC_FLAG_INIT; ///< Set while in use
+   std::atomic<Header*> remote_{nullptr}; ///< Blocks freed by other threads
+   Header* free_[NCLASS]; ///< Free list for each size class
+   Header* spare_[NCLASS]; ///< Never used blocks of each size class
+   char* chunk_ = nullptr; ///< Unused part of current chunk
+   size_t chunk_left_ = 0; ///< Bytes remaining in chunk_
+   char pad_[64]; ///< Avoid false sharing between caches of adjacent threads
+};
+
+/**
+ * \brief Predicts the memory a single Cache draws from a Table.
+ *
+ * Follows the same steps as Cache and Table for a sequence of allocations
+ * and deallocations by one thread, without touching any memory, so that
+ * the initial region of a Table can be sized to avoid adding another.
+ */
+class CacheSimulator {
+public:
+   CacheSimulator() {
+      for(int i=0; i<NCLASS; ++i) nfree_[i] = 0;
+   }
+   /** \brief Simulate allocation of sz bytes */
+   void allocate(std::size_t sz) {
+      int cls = size_to_class(sz);
+      if(cls > MAX_CLASS) return; // not drawn from Table
+      int i = cls-MIN_CLASS;
+      if(nfree_[i] > 0) { --nfree_[i]; return; }
+      size_t blk = size_t(1) << cls;
+      if(blk > chunk_left_) {
+         // As Cache::new_chunk(): split remainder into free blocks
+         for(int c=MAX_CLASS; c>=MIN_CLASS; --c) {
+            while(chunk_left_ >= (size_t(1)<<c)) {
+               ++nfree_[c-MIN_CLASS];
+               chunk_left_ -= size_t(1)<<c;
+            }
+         }
+         size_t chunk_sz = std::max(CHUNK_SIZE, blk);
+         region_used_ += chunk_sz;
+         chunk_left_ = chunk_sz;
+      }
+      chunk_left_ -= blk;
+   }
+   /** \brief Simulate deallocation of sz bytes */
+   void deallocate(std::size_t sz) {
+      int cls = size_to_class(sz);
+      if(cls <= MAX_CLASS) ++nfree_[cls-MIN_CLASS];
+   }
+   /** \brief Return total size of chunks taken from Table */
+   size_t get_region_used() const { return region_used_; }
+private:
+   int nfree_[NCLASS]; ///< Number of free blocks of each size class
+   size_t chunk_left_ = 0; ///< Bytes remaining in current chunk
+   size_t region_used_ = 0; ///< Bytes taken from Table
+};
+
+/**
+ * \brief Type-agnostic collection of Cache s. Backing for
+ *        ThreadCacheAllocator.
+ *
+ * Memory is obtained in large regions from the underlying allocator, and
+ * handed to each Cache in chunks by atomically bumping an offset into the
+ * current region. Only when a region is exhausted is a lock taken, to add a
+ * new region of twice the size.
+ *
+ * Blocks up to 2^MAX_CLASS bytes are rounded up to a power of two and
+ * recycled through the caches. Larger blocks are passed straight through to
+ * the underlying allocator, which must therefore be thread safe.
+ *
+ * The memory held is that of every block handed out at least once, whether
+ * in use or cached after being freed (the power of two it was rounded up
+ * to), plus the underlying allocation of each large block in use. It falls
+ * as large blocks are freed, and as release_cached() gives the pages of
+ * cached blocks back to the system. It is charged to a MemoryBudget, if
+ * set, as it changes. The rest of each region is not resident, apart from
+ * the page holding the header of each block split from the remainder of a
+ * chunk or given back.
+ *
+ * \sa Cache
+ * \sa ThreadCacheAllocator
+ */
+template <typename CharAllocator>
+class Table {
+   /** Contiguous area of memory from which chunks are handed out */
+   struct Region {
+      char* mem; ///< Underlying allocation
+      char* base; ///< Aligned start
+      size_t size; ///< Usable size from base
+      std::atomic<size_t> used; ///< Bytes handed out so far
+   };
+public:
+   // \{
+   Table(const Table&) =delete;
+   Table& operator=(const Table&) =delete;
+   // \}
+   /**
+    * \brief (Constructor)
+    *
+    * \param sz Size of initial region.
+    * \param alloc Underlying allocator to use.
+    */
+   Table(std::size_t sz, CharAllocator const& alloc=CharAllocator())
+   : alloc_(alloc), ncache_(1)
+   {
+#ifdef _OPENMP
+      ncache_ = omp_get_max_threads();
+#endif /* _OPENMP */
+      caches_.reset(new Cache[ncache_]);
+      current_ = add_region(std::max(sz, CHUNK_SIZE));
+   }
+   ~Table() {
+      if(budget_) budget_->release(held_.load());
+      for(auto region: regions_) {
+         std::allocator_traits<CharAllocator>::deallocate(
+               alloc_, region->mem, region->size+align
+               );
+         delete region;
+      }
+   }
+
+   /** \brief Allocate and return a pointer of the given size. */
+   void* allocate(std::size_t sz) {
+      int cls = size_to_class(sz);
+      if(cls > MAX_CLASS) return allocate_large(sz);
+      // Use our own cache if nobody else is (otherwise try the next one)
+      int idx = thread_num() % ncache_;
+      while(!caches_[idx].try_acquire())
+         idx = (idx+1) % ncache_;
+      Cache& cache = caches_[idx];
+      Header* h = cache.pop(cls);
+      size_t fresh = 0; // bytes of a block never handed out before
+      if(!h) {
+         fresh = size_t(1) << cls;
+         h = cache.pop_spare(cls);
+      }
+      if(!h) h = cache.carve(cls, idx);
+      if(!h) {
+         size_t chunk_sz = std::max(CHUNK_SIZE, size_t(1)<<cls);
+         char* chunk;
+         try {
+            chunk = get_chunk(chunk_sz);
+         } catch(std::bad_alloc const&) {
+            cache.release();
+            throw;
+         }
+         cache.new_chunk(chunk, chunk_sz, idx);
+         h = cache.carve(cls, idx);
+      }
+      cache.release();
+      if(fresh) charge(fresh);
+      return block_to_ptr(h);
+   }
+
+   /** \brief Release memory starting at ptr of size sz back to pool */
+   void deallocate(void* ptr, std::size_t sz) {
+      Header* h = ptr_to_block(ptr);
+      if(h->owner == LARGE_OWNER) {
+         std::allocator_traits<CharAllocator>::deallocate(
+               alloc_, h->raw, sz+2*align
+               );
+         charge(-static_cast<int64_t>(sz+2*align));
+         return;
+      }
+      Cache& cache = caches_[h->owner];
+      if(h->owner == thread_num() % ncache_ && cache.try_acquire()) {
+         cache.push_local(h);
+         cache.release();
+      } else {
+         cache.push_remote(h);
+      }
+   }
+
+   /** \brief Give the pages of cached blocks back to the system (see
+    *         Cache::release_free()). May be called at any time. */
+   void release_cached() {
+      for(int i=0; i<ncache_; ++i) {
+         Cache& cache = caches_[i];
+         while(!cache.try_acquire()); // only ever held briefly
+         size_t bytes = cache.release_free();
+         cache.release();
+         if(bytes) charge(-static_cast<int64_t>(bytes));
+      }
+   }
+
+   /**
+    * \brief Charge memory held to given budget, or to none if nullptr.
+    *
+    * Memory held is moved from any previous budget. Must not be called
+    * concurrently with any other member.
+    */
+   void set_budget(MemoryBudget* budget) {
+      if(budget == budget_) return;
+      int64_t held = held_.load();
+      if(budget_) budget_->release(held);
+      if(budget) budget->allocate(held);
+      budget_ = budget;
+   }
+
+private:
+   /** Add bytes (which may be negative) to memory held */
+   void charge(int64_t bytes) {
+      held_ += bytes;
+      if(!budget_) return;
+      if(bytes > 0) budget_->allocate(bytes);
+      else          budget_->release(-bytes);
+   }
+
+   /** Allocate block directly from underlying allocator */
+   void* allocate_large(std::size_t sz) {
+      char* raw = std::allocator_traits<CharAllocator>::allocate(
+            alloc_, sz+2*align
+            );
+      uintptr_t addr = reinterpret_cast<uintptr_t>(raw) + 2*align;
+      addr -= addr % align;
+      Header* h = ptr_to_block(reinterpret_cast<void*>(addr));
+      h->raw = raw;
+      h->owner = LARGE_OWNER;
+      h->cls = MAX_CLASS+1;
+      charge(sz+2*align);
+      return block_to_ptr(h);
+   }
+
+   /** Return chunk of sz bytes from the current region, adding a new region
+    *  if it is exhausted */
+   char* get_chunk(size_t sz) {
+      while(true) {
+         Region* region = current_.load(std::memory_order_acquire);
+         size_t offset = region->used.fetch_add(sz, std::memory_order_relaxed);
+         if(offset+sz <= region->size) return region->base + offset;
+         // Region exhausted: add a new one, unless another thread already has
+         spral::omp::AcquiredLock scopeLock(lock_);
+         if(current_.load(std::memory_order_relaxed) == region)
+            current_.store(add_region(std::max(2*region->size, sz)),
+                  std::memory_order_release);
+      }
+   }
+
+   /** Allocate a new region of (at least) sz bytes. Caller must hold lock_
+    *  if other threads may be active. */
+   Region* add_region(size_t sz) {
+      sz = align * ((sz-1)/align + 1);
+      std::unique_ptr<Region> region(new Region);
+      region->mem =
+         std::allocator_traits<CharAllocator>::allocate(alloc_, sz+align);
+      uintptr_t addr = reinterpret_cast<uintptr_t>(region->mem) + align - 1;
+      region->base = reinterpret_cast<char*>(addr - addr % align);
+      region->size = sz;
+      region->used = 0;
+      try {
+         regions_.push_back(region.get());
+      } catch(std::bad_alloc const&) {
+         std::allocator_traits<CharAllocator>::deallocate(
+               alloc_, region->mem, sz+align
+               );
+         throw;
+      }
+      return region.release();
+   }
+
+   CharAllocator alloc_; ///< Underlying allocator
+   int ncache_; ///< Number of caches (one per thread)
+   std::unique_ptr<Cache[]> caches_; ///< Per-thread caches
+   std::atomic<Region*> current_; ///< Region chunks are taken from
+   std::vector<Region*> regions_; ///< All regions, for cleanup
+   spral::omp::Lock lock_; ///< Protects addition of regions
+   std::atomic<int64_t> held_{0}; ///< Memory held, see class description
+   MemoryBudget* budget_ = nullptr; ///< Budget held_ is charged to (if any)
+};
+
+} /* namespace thread_cache_alloc_internal */
+
+/**
+ * \brief Scalable pool allocator with a cache of free blocks for each thread.
+ *
+ * Unlike BuddyAllocator, allocation and deallocation by the same thread take
+ * no lock, and the owner of a block is found in O(1) from a header stored
+ * in front of it. Blocks freed by a thread other than their owner are
+ * returned with a single lock-free atomic operation. Free blocks are not
+ * merged, so memory use is higher than that of BuddyAllocator when the mix of
+ * sizes changes over time.
+ *
+ * Actually a type-specific wrapper around the type-agnostic Table.
+ *
+ * \sa thread_cache_alloc_internal::Table
+ * \sa thread_cache_alloc_internal::Cache
+ */
+template <typename T, typename BaseAllocator>
+class ThreadCacheAllocator {
+   typedef typename std::allocator_traits<BaseAllocator>::template rebind_alloc<char> CharAllocator;
+public:
+   typedef T value_type;
+
+   ThreadCacheAllocator(size_t size, BaseAllocator const& base=BaseAllocator())
+   : table_(new thread_cache_alloc_internal::Table<CharAllocator>(size*sizeof(T), base))
+   {}
+   template<typename U, typename UBaseAllocator>
+   ThreadCacheAllocator(ThreadCacheAllocator<U, UBaseAllocator> const& other)
+   : table_(other.table_)
+   {}
+
+   T* allocate(std::size_t n)
+   {
+      return static_cast<T*>(table_.get()->allocate(n*sizeof(T)));
+   }
+
+   void deallocate(T* ptr, std::size_t n)
+   {
+      table_.get()->deallocate(ptr, n*sizeof(T));
+   }
+
+   /** \brief Charge memory held by the pool to budget, or to none if
+    *         nullptr (see thread_cache_alloc_internal::Table). */
+   void set_budget(MemoryBudget* budget) {
+      table_.get()->set_budget(budget);
+   }
+
+   /** \brief Give the pages of blocks cached by the pool back to the
+    *         system. Not worth the cost unless memory is short. */
+   void release_cached() {
+      table_.get()->release_cached();
+   }
+
+   /** \brief Return memory the pool may draw to allocate n elements. */
+   static size_t footprint(std::size_t n) {
+      return thread_cache_alloc_internal::footprint(n*sizeof(T));
+   }
+private:
+   std::shared_ptr<thread_cache_alloc_internal::Table<CharAllocator>> table_;
+   template<typename U, typename UAlloc>
+   friend class ThreadCacheAllocator;
+};
+
+}}} /* namespaces spral::ssids::cpu */
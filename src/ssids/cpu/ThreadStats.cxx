@@ -27,6 +27,10 @@ ThreadStats& ThreadStats::operator+=(ThreadStats const& other) {
    maxsupernode = std::max(maxsupernode, other.maxsupernode);
    not_first_pass += other.not_first_pass;
    not_second_pass += other.not_second_pass;
+   cpu_isa = std::max(cpu_isa, other.cpu_isa);
+   not_refactored += other.not_refactored;
+   num_huge_pages += other.num_huge_pages;
+   backup_peak = std::max(backup_peak, other.backup_peak);
 
    return *this;
 }
@@ -57,6 +57,13 @@ struct ThreadStats {
    int maxsupernode = 0;      ///< Maximum supernode size
    int not_first_pass = 0;    ///< Number of pivots not eliminated in APP
    int not_second_pass = 0;   ///< Number of pivots not eliminated in APP or TPP
+   int cpu_isa = 0;     ///< Instruction set used by kernels (enum cpu_arch)
+   int not_refactored = 0; ///< Number of nodes where refactorization could
+                           ///< not reuse the previous pivot sequence
+   int num_huge_pages = 0; ///< Peak number of huge pages held by factor,
+                           ///< pool and workspace memory
+   int64_t backup_peak = 0; ///< Largest memory (bytes) held by a node for
+                            ///< backups in APP
 
    ThreadStats& operator+=(ThreadStats const& other);
 };
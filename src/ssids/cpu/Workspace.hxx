@@ -8,31 +8,45 @@
 #include <memory>
 
 #include "compat.hxx" // in case std::align not defined
+#include "ssids/cpu/SystemMemory.hxx"
 
 namespace spral { namespace ssids { namespace cpu {
 
 /** A Workspace is a chunk of memory that can be reused. The get_ptr<T>(len)
  * function provides a pointer to it after ensuring it is of at least the
- * given size. */
+ * given size. Memory comes from operator new, or from a SystemMemory if one
+ * is given. */
 class Workspace {
-#if defined(__AVX512F__)
+#if defined(__AVX512F__) || defined(HAVE_AVX512_KERNELS)
   static int const align = 64;
-#elif defined(__AVX__)
+#elif defined(__AVX__) || defined(HAVE_AVX2_KERNELS)
   static int const align = 32;
 #else
   static int const align = 16;
 #endif
 public:
-   Workspace(size_t sz)
+   Workspace(size_t sz, SystemMemory* sys_mem=nullptr)
+   : sys_mem_(sys_mem)
    {
       alloc_and_align(sz);
    }
+   // Not copyable, but may be moved (e.g. on resize of std::vector<Workspace>)
+   Workspace(Workspace const&) =delete;
+   Workspace& operator=(Workspace const&) =delete;
+   Workspace(Workspace&& other) noexcept
+   : sys_mem_(other.sys_mem_), mem_(other.mem_),
+     mem_aligned_(other.mem_aligned_), sz_(other.sz_)
+   {
+      other.mem_ = nullptr;
+      other.mem_aligned_ = nullptr;
+      other.sz_ = 0;
+   }
    ~Workspace() {
-      ::operator delete(mem_);
+      release();
    }
    void alloc_and_align(size_t sz) {
       sz_ = sz+align;
-      mem_ = ::operator new(sz_);
+      mem_ = sys_mem_ ? sys_mem_->allocate(sz_, false) : ::operator new(sz_);
       mem_aligned_ = mem_;
       if(!std::align(align, sz, mem_aligned_, sz_)) throw std::bad_alloc();
    }
@@ -40,12 +54,18 @@ public:
    T* get_ptr(size_t len) {
       if(sz_ < len*sizeof(T)) {
          // Need to resize
-         ::operator delete(mem_);
+         release();
          alloc_and_align(len*sizeof(T));
       }
       return static_cast<T*>(mem_aligned_);
    }
 private:
+   void release() {
+      if(sys_mem_) sys_mem_->deallocate(mem_);
+      else ::operator delete(mem_);
+   }
+
+   SystemMemory* sys_mem_; ///< Source of mem_, or null for operator new
    void* mem_;
    void* mem_aligned_;
    size_t sz_;
@@ -0,0 +1,56 @@
+/** \file
+ *  \copyright 2016 The Science and Technology Facilities Council (STFC)
+ *  \licence   BSD licence, see LICENCE file for details
+ *  \author    Jonathan Hogg
+ */
+#include "ssids/cpu/block_size.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <unistd.h>
+
+namespace spral { namespace ssids { namespace cpu {
+
+namespace {
+
+int const BLOCK_ALIGN = 32; ///< Block sizes are multiples of this
+int const MIN_BLOCK_SIZE = 64; ///< Smallest block size chosen
+int const MAX_BLOCK_SIZE = 512; ///< Largest block size chosen
+int const MIN_TASKS = 16; ///< Tasks sought from first block column
+std::size_t const DEFAULT_CACHE_SIZE = 256*1024; ///< If cache size unknown
+
+/** Return largest block size for which an update fits in cache */
+int get_cache_block_size() {
+   static int const block_size = []() {
+      double nentry = get_core_cache_size() / (3.0*sizeof(double));
+      int bs = BLOCK_ALIGN * int(std::sqrt(nentry) / BLOCK_ALIGN);
+      return std::max(MIN_BLOCK_SIZE, std::min(bs, MAX_BLOCK_SIZE));
+   }();
+   return block_size;
+}
+
+} /* anon namespace */
+
+std::size_t get_core_cache_size() {
+#ifdef _SC_LEVEL2_CACHE_SIZE
+   long sz = sysconf(_SC_LEVEL2_CACHE_SIZE);
+   if(sz > 0) return sz;
+#endif /* _SC_LEVEL2_CACHE_SIZE */
+   return DEFAULT_CACHE_SIZE;
+}
+
+int get_block_size(int m, struct cpu_factor_options const& options) {
+   if(options.cpu_block_size > 0) return options.cpu_block_size;
+
+   int block_size = get_cache_block_size();
+   for(; block_size > MIN_BLOCK_SIZE; block_size -= BLOCK_ALIGN) {
+      // The first block column gives a task for each block in it (factor
+      // or apply), and an update for each block of the trailing matrix
+      int64_t mblk = (m-1) / block_size + 1;
+      if(mblk*(mblk+1)/2 >= MIN_TASKS) break;
+   }
+   return block_size;
+}
+
+}}} /* namespaces spral::ssids::cpu */
@@ -0,0 +1,42 @@
+/** \file
+ *  \copyright 2016 The Science and Technology Facilities Council (STFC)
+ *  \licence   BSD licence, see LICENCE file for details
+ *  \author    Jonathan Hogg
+ *
+ *  \brief
+ *  Choice of block size for task generation on large nodes
+ */
+#pragma once
+
+#include <cstddef>
+
+#include "ssids/cpu/cpu_iface.hxx"
+
+namespace spral { namespace ssids { namespace cpu {
+
+/** \brief Return the block size used to generate tasks on a node by
+ *         cholesky_factor() and ldlt_app_factor().
+ *
+ * If options.cpu_block_size is positive (the default), it is used for every
+ * node. Otherwise the block size is chosen by a simple cost model. Blocks
+ * are as large as possible, up to the size at which the three blocks
+ * involved in an update fit in the cache private to each core. They are
+ * then shrunk, in steps of 32 (the inner block size of APP), while the
+ * first block column of the node would give fewer than 16 tasks, but never
+ * below 64, as smaller tasks do too little work to hide the overhead of
+ * creating and scheduling them.
+ *
+ * As block boundaries affect which pivots APP accepts, the choice must not
+ * depend on the number of threads, or results would vary with it. They
+ * may still differ between machines with different cache sizes.
+ *
+ * \param m number of rows in node
+ * \param options user-supplied options
+ */
+int get_block_size(int m, struct cpu_factor_options const& options);
+
+/** \brief Return the size in bytes of the cache private to each core, as
+ *         used by get_block_size() */
+std::size_t get_core_cache_size();
+
+}}} /* namespaces spral::ssids::cpu */
@@ -26,8 +26,13 @@ module spral_ssids_cpu_iface
       real(C_DOUBLE) :: multiplier
       integer(C_INT64_T) :: small_subtree_threshold
       integer(C_INT) :: cpu_block_size
+      integer(C_INT) :: cpu_lookahead
       integer(C_INT) :: pivot_method
       integer(C_INT) :: failed_pivot_method
+      logical(C_BOOL) :: store_relidx
+      integer(C_INT) :: huge_pages
+      logical(C_BOOL) :: refactor
+      logical(C_BOOL) :: compress_factors
    end type cpu_factor_options
 
    !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
@@ -48,6 +53,10 @@ module spral_ssids_cpu_iface
       integer(C_INT) :: maxsupernode
       integer(C_INT) :: not_first_pass
       integer(C_INT) :: not_second_pass
+      integer(C_INT) :: cpu_isa
+      integer(C_INT) :: not_refactored
+      integer(C_INT) :: num_huge_pages
+      integer(C_INT64_T) :: backup_peak
    end type cpu_factor_stats
 
 contains
@@ -65,8 +74,13 @@ subroutine cpu_copy_options_in(foptions, coptions)
    coptions%multiplier     = foptions%multiplier
    coptions%small_subtree_threshold = foptions%small_subtree_threshold
    coptions%cpu_block_size = foptions%cpu_block_size
+   coptions%cpu_lookahead  = foptions%cpu_lookahead
    coptions%pivot_method   = min(3, max(1, foptions%pivot_method))
    coptions%failed_pivot_method = min(2, max(1, foptions%failed_pivot_method))
+   coptions%store_relidx   = foptions%store_relidx
+   coptions%huge_pages     = min(2, max(0, foptions%huge_pages))
+   coptions%refactor       = foptions%refactor
+   coptions%compress_factors = foptions%compress_factors
 end subroutine cpu_copy_options_in
 
 !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
@@ -91,6 +105,10 @@ subroutine cpu_copy_stats_out(cstats, finform)
    finform%not_first_pass = finform%not_first_pass + cstats%not_first_pass
    finform%not_second_pass = finform%not_second_pass + cstats%not_second_pass
    finform%matrix_rank  = finform%matrix_rank - cstats%num_zero
+   finform%cpu_isa      = max(finform%cpu_isa, cstats%cpu_isa)
+   finform%not_refactored = finform%not_refactored + cstats%not_refactored
+   finform%num_huge_pages = finform%num_huge_pages + cstats%num_huge_pages
+   finform%backup_peak  = max(finform%backup_peak, cstats%backup_peak)
 end subroutine cpu_copy_stats_out
 
 
@@ -172,4 +190,49 @@ bind(C)
    call dgemv(trans, m, n, alpha, a, lda, x, incx, beta, y, incy)
 end subroutine spral_c_dgemv
 
+subroutine spral_c_sgemm(ta, tb, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc) &
+bind(C)
+   use spral_blas_iface, only : sgemm
+   character(C_CHAR), intent(in) :: ta, tb
+   integer(C_INT), intent(in) :: m, n, k
+   integer(C_INT), intent(in) :: lda, ldb, ldc
+   real(C_FLOAT), intent(in) :: alpha, beta
+   real(C_FLOAT), intent(in   ), dimension(lda, *) :: a
+   real(C_FLOAT), intent(in   ), dimension(ldb, *) :: b
+   real(C_FLOAT), intent(inout), dimension(ldc, *) :: c
+   call sgemm(ta, tb, m, n, k, alpha, a, lda, b, ldb, beta, c, ldc)
+end subroutine spral_c_sgemm
+
+subroutine spral_c_strsm(side, uplo, transa, diag, m, n, alpha, a, lda, b, &
+                         ldb) bind(C)
+   use spral_blas_iface, only : strsm
+   character(C_CHAR), intent(in) :: side, uplo, transa, diag
+   integer(C_INT), intent(in) :: m, n, lda, ldb
+   real(C_FLOAT), intent(in   ) :: alpha
+   real(C_FLOAT), intent(in   ) :: a(lda, *)
+   real(C_FLOAT), intent(inout) :: b(ldb, n)
+   call strsm(side, uplo, transa, diag, m, n, alpha, a, lda, b, ldb)
+end subroutine spral_c_strsm
+
+subroutine spral_c_strsv(uplo, trans, diag, n, a, lda, x, incx) bind(C)
+   use spral_blas_iface, only : strsv
+   character(C_CHAR), intent(in) :: uplo, trans, diag
+   integer(C_INT), intent(in) :: n, lda, incx
+   real(C_FLOAT), intent(in   ), dimension(lda, n) :: a
+   real(C_FLOAT), intent(inout), dimension(*) :: x
+   call strsv(uplo, trans, diag, n, a, lda, x, incx)
+end subroutine spral_c_strsv
+
+subroutine spral_c_sgemv(trans, m, n, alpha, a, lda, x, incx, beta, y, incy) &
+bind(C)
+   use spral_blas_iface, only : sgemv
+   character(C_CHAR), intent(in) :: trans
+   integer(C_INT), intent(in) :: m, n, lda, incx, incy
+   real(C_FLOAT), intent(in) :: alpha, beta
+   real(C_FLOAT), intent(in   ), dimension(lda, n) :: a
+   real(C_FLOAT), intent(in   ), dimension(*) :: x
+   real(C_FLOAT), intent(inout), dimension(*) :: y
+   call sgemv(trans, m, n, alpha, a, lda, x, incx, beta, y, incy)
+end subroutine spral_c_sgemv
+
 end module spral_ssids_cpu_iface
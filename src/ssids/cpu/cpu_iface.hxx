@@ -8,6 +8,8 @@
 #include <cstddef>
 #include <cstdint>
 
+#include "config.h" // for HAVE_AVX*_KERNELS
+
 namespace spral { namespace ssids { namespace cpu {
 
 enum struct PivotMethod : int {
@@ -21,6 +23,12 @@ enum struct FailedPivotMethod : int {
    pass           = 2
 };
 
+enum struct HugePages : int {
+   none           = 0,
+   transparent    = 1,
+   hugetlbfs      = 2
+};
+
 struct cpu_factor_options {
    int print_level;
    bool action;
@@ -29,16 +37,21 @@ struct cpu_factor_options {
    double multiplier;
    int64_t small_subtree_threshold;
    int cpu_block_size;
+   int cpu_lookahead;
    PivotMethod pivot_method;
    FailedPivotMethod failed_pivot_method;
+   bool store_relidx;
+   HugePages huge_pages;
+   bool refactor;
+   bool compress_factors;
 };
 
 /** Return nearest value greater than supplied lda that is multiple of alignment */
 template<typename T>
 size_t align_lda(size_t lda) {
-#if defined(__AVX512F__)
+#if defined(__AVX512F__) || defined(HAVE_AVX512_KERNELS)
   int const align = 64;
-#elif defined(__AVX__)
+#elif defined(__AVX__) || defined(HAVE_AVX2_KERNELS)
   int const align = 32;
 #else
   int const align = 16;
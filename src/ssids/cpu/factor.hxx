@@ -6,9 +6,14 @@
 #pragma once
 
 /* Standard headers */
+#include <algorithm>
 #include <cmath>
 #include <cstddef>
 #include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <memory>
 #include <sstream>
 #include <stdexcept>
 
@@ -18,21 +23,54 @@
 
 /* SPRAL headers */
 #include "ssids/profile.hxx"
+#include "ssids/cpu/block_size.hxx"
 #include "ssids/cpu/cpu_iface.hxx"
 #include "ssids/cpu/SymbolicNode.hxx"
 #include "ssids/cpu/ThreadStats.hxx"
 #include "ssids/cpu/Workspace.hxx"
 #include "ssids/cpu/kernels/assemble.hxx"
-#include "ssids/cpu/kernels/calc_ld.hxx"
 #include "ssids/cpu/kernels/cholesky.hxx"
 #include "ssids/cpu/kernels/ldlt_app.hxx"
+#include "ssids/cpu/kernels/ldlt_refactor.hxx"
 #include "ssids/cpu/kernels/ldlt_tpp.hxx"
+#include "ssids/cpu/kernels/simd_kernels.hxx"
 #include "ssids/cpu/kernels/wrappers.hxx"
 
 //#include "ssids/cpu/kernels/verify.hxx" // FIXME: remove debug
 
 namespace spral { namespace ssids { namespace cpu {
 
+/* Record statistics for a factorized node (indef) and mark its contribution
+ * block as empty if nothing was eliminated */
+template <typename T, typename PoolAlloc>
+void finish_node_indef(
+      SymbolicNode const& snode,
+      NumericNode<T, PoolAlloc> &node,
+      ThreadStats& stats
+      ) {
+   int m = snode.nrow + node.ndelay_in;
+   int n = snode.ncol + node.ndelay_in;
+
+   /* Record information */
+   node.ndelay_out = n - node.nelim;
+   stats.num_delay += node.ndelay_out;
+   for (int64_t j = m; j >= m-(node.nelim)+1; --j) {
+      stats.num_factor += j;
+      stats.num_flops += j*j;
+   }
+
+   /* Mark as no contribution if we make no contribution */
+   if(node.nelim==0 && !node.first_child && snode.contrib.size()==0) {
+      // FIXME: Actually loop over children and check one exists with contrib
+      //        rather than current approach of just looking for children.
+      node.free_contrib();
+   } else if(node.nelim==0 && !node.contrib_inplace) {
+      // FIXME: If we fix the above, we don't need this explict zeroing
+      for(int j=0; j<m-n; ++j)
+         memset(&node.contrib[j*node.ldcontrib], 0, (m-n)*sizeof(T));
+   }
+}
+
 /* Factorize a node (indef) */
 template <typename T, typename PoolAlloc>
 void factor_node_indef(
@@ -42,7 +80,8 @@ void factor_node_indef(
       struct cpu_factor_options const& options,
       ThreadStats& stats,
       std::vector<Workspace>& work,
-      PoolAlloc& pool_alloc
+      PoolAlloc& pool_alloc,
+      size_t max_backup // memory available for APP's backups
       ) {
    /* Extract useful information about node */
    int m = snode.nrow + node.ndelay_in;
@@ -52,15 +91,19 @@ void factor_node_indef(
    T *d = &node.lcol[ n*ldl ];
    int *perm = node.perm;
    T *contrib = node.contrib;
+   T beta = (node.contrib_inplace) ? 1.0 : 0.0; // contrib already assembled?
 
    /* Perform factorization */
    //Verify<T> verifier(m, n, perm, lcol, ldl);
    if(options.pivot_method != PivotMethod::tpp) {
       // Use an APP based pivot method
+      size_t backup_mem;
       node.nelim = ldlt_app_factor(
-            m, n, perm, lcol, ldl, d, 0.0, contrib, m-n, options, work,
-            pool_alloc
+            m, n, perm, lcol, ldl, d, beta, contrib, node.ldcontrib, options,
+            work, pool_alloc, max_backup, backup_mem
             );
+      stats.backup_peak =
+         std::max(stats.backup_peak, static_cast<int64_t>(backup_mem));
       if(node.nelim < 0) {
          stats.flag = static_cast<Flag>(node.nelim);
          return;
@@ -83,23 +126,25 @@ void factor_node_indef(
 #ifdef PROFILE
          Profile::Task task_tpp("TA_LDLT_TPP");
 #endif
-         T *ld = work[omp_get_thread_num()].get_ptr<T>(2*(m-nelim));
-         node.nelim += ldlt_tpp_factor(
+         T *ld = work[omp_get_thread_num()].get_ptr<T>(
+               TPP_BLOCK_SIZE*(m-nelim)
+               );
+         node.nelim += ldlt_tpp_factor_blocked(
                m-nelim, n-nelim, &perm[nelim], &lcol[nelim*(ldl+1)], ldl,
-               &d[2*nelim], ld, m-nelim, options.action, options.u,
-               options.small, nelim, &lcol[nelim], ldl
+               &d[2*nelim], ld, m-nelim, TPP_BLOCK_SIZE, options.action,
+               options.u, options.small, nelim, &lcol[nelim], ldl
                );
          if(m-n>0 && node.nelim>nelim) {
             int nelim2 = node.nelim - nelim;
             int ldld = align_lda<T>(m-n);
             T *ld = work[omp_get_thread_num()].get_ptr<T>(nelim2*ldld);
-            calcLD<OP_N>(
+            get_simd_kernels<T>().calcLD_N(
                   m-n, nelim2, &lcol[nelim*ldl+n], ldl, &d[2*nelim], ld, ldld
                   );
-            T rbeta = (nelim==0) ? 0.0 : 1.0;
+            T rbeta = (nelim==0) ? beta : 1.0;
             host_gemm<T>(OP_N, OP_T, m-n, m-n, nelim2,
                   -1.0, &lcol[nelim*ldl+n], ldl, ld, ldld,
-                  rbeta, node.contrib, m-n);
+                  rbeta, node.contrib, node.ldcontrib);
          }
          if(options.pivot_method==PivotMethod::tpp) {
             stats.not_first_pass += n - node.nelim;
@@ -115,24 +160,94 @@ void factor_node_indef(
 #ifdef PROFILE
       Profile::setState("TA_MISC1");
 #endif
-   /* Record information */
-   node.ndelay_out = n - node.nelim;
-   stats.num_delay += node.ndelay_out;
-   for (int64_t j = m; j >= m-(node.nelim)+1; --j) {
-      stats.num_factor += j;
-      stats.num_flops += j*j;
+   finish_node_indef(snode, node, stats);
+}
+
+/* Attempt to factorize a node (indef) using the pivot sequence of a previous
+ * factorization. Returns false, with the node left as it was on entry, if
+ * the node's fully summed variables differ from those of the previous
+ * factorization or any of the previous pivots fails the threshold test. */
+template <typename T, typename PoolAlloc>
+bool refactor_node_indef(
+      SymbolicNode const& snode,
+      NumericNode<T, PoolAlloc> &node,
+      int prev_n, // Number of fully summed variables in previous factors
+      int prev_nelim, // Number of pivots in previous factors
+      int const* prev_perm, // Previous order, 2x2 pivots as negative entries
+      struct cpu_factor_options const& options,
+      ThreadStats& stats,
+      std::vector<Workspace>& work,
+      PoolAlloc& pool_alloc
+      ) {
+   typedef std::allocator_traits<PoolAlloc> PATraits;
+
+   /* Extract useful information about node */
+   int m = snode.nrow + node.ndelay_in;
+   int n = snode.ncol + node.ndelay_in;
+   size_t ldl = align_lda<T>(m);
+   T *lcol = node.lcol;
+   T *d = &node.lcol[ n*ldl ];
+   int *perm = node.perm;
+   if(n != prev_n || prev_nelim == 0) return false;
+
+   /* Find position in the current front of each previous pivot, q[] */
+   Workspace& thread_work = work[omp_get_thread_num()];
+   int* q = thread_work.get_ptr<int>(3*n);
+   int* cur = &q[n];
+   int* prev = &q[2*n];
+   for(int i=0; i<n; ++i) cur[i] = prev[i] = i;
+   std::sort(cur, cur+n,
+         [perm](int i, int j) { return perm[i] < perm[j]; });
+   std::sort(prev, prev+n,
+         [prev_perm](int i, int j) {
+            return std::abs(prev_perm[i]) < std::abs(prev_perm[j]);
+         });
+   for(int i=0; i<n; ++i) {
+      if(perm[cur[i]] != std::abs(prev_perm[prev[i]])) return false;
+      q[prev[i]] = cur[i];
    }
 
-   /* Mark as no contribution if we make no contribution */
-   if(node.nelim==0 && !node.first_child && snode.contrib.size()==0) {
-      // FIXME: Actually loop over children and check one exists with contrib
-      //        rather than current approach of just looking for children.
-      node.free_contrib();
-   } else if(node.nelim==0) {
-      // FIXME: If we fix the above, we don't need this explict zeroing
-      int64_t contrib_size = m-n;
-      memset(node.contrib, 0, contrib_size*contrib_size*sizeof(T));
+   /* Keep a copy of the front so we can fall back, and permute it
+    * symmetrically into the previous pivot order */
+   size_t backup_len = ldl*n;
+   size_t len = backup_len + (n*sizeof(int) + sizeof(T)-1) / sizeof(T);
+   T* backup = PATraits::allocate(pool_alloc, len);
+   int* perm_backup = reinterpret_cast<int*>(&backup[backup_len]);
+   memcpy(backup, lcol, backup_len*sizeof(T));
+   memcpy(perm_backup, perm, n*sizeof(int));
+   for(int k=0; k<n; ++k) {
+      int s = q[k];
+      T* dest = &lcol[k*ldl];
+      for(int r=k; r<n; ++r) {
+         int t = q[r];
+         dest[r] = (t >= s) ? backup[s*ldl+t] : backup[t*ldl+s];
+      }
+      for(int r=n; r<m; ++r)
+         dest[r] = backup[s*ldl+r];
+      perm[k] = perm_backup[s];
    }
+   for(int i=0; i+1<prev_nelim; ++i)
+      if(prev_perm[i] < 0) {
+         d[2*i+2] = std::numeric_limits<T>::infinity();
+         ++i;
+      }
+
+   /* Factorize using previous pivots */
+   bool ok = ldlt_refactor_factor(
+         m, n, prev_nelim, lcol, ldl, d, options.u, options.small,
+         node.contrib, node.ldcontrib, thread_work
+         );
+   if(ok) {
+      node.nelim = prev_nelim;
+      finish_node_indef(snode, node, stats);
+   } else {
+      /* Restore front for factorization from scratch */
+      memcpy(lcol, backup, backup_len*sizeof(T));
+      memset(d, 0, 2*n*sizeof(T));
+      memcpy(perm, perm_backup, n*sizeof(int));
+   }
+   PATraits::deallocate(pool_alloc, backup, len);
+   return ok;
 }
 /* Factorize a node (posdef) */
 template <typename T, typename PoolAlloc>
@@ -151,9 +266,14 @@ void factor_node_posdef(
    T *contrib = node.contrib;
 
    /* Perform factorization */
+   int blksz = get_block_size(m, options);
+#ifdef PROFILE
+   Profile::addBlockSizeEvent(m, n, blksz);
+#endif
    int flag;
    cholesky_factor(
-         m, n, lcol, ldl, beta, contrib, m-n, options.cpu_block_size, &flag
+         m, n, lcol, ldl, beta, contrib, node.ldcontrib, blksz, &flag,
+         options.cpu_lookahead
          );
    if(flag!=-1) {
       node.nelim = flag+1;
@@ -178,10 +298,15 @@ void factor_node(
       struct cpu_factor_options const& options,
       ThreadStats& stats,
       std::vector<Workspace>& work,
-      PoolAlloc& pool_alloc
+      PoolAlloc& pool_alloc,
+      size_t max_backup
       ) {
-   if(posdef) factor_node_posdef(0.0, snode, node, options, stats);
-   else       factor_node_indef(ni, snode, node, options, stats, work, pool_alloc);
+   if(posdef) {
+      T beta = (node.contrib_inplace) ? 1.0 : 0.0;
+      factor_node_posdef(beta, snode, node, options, stats);
+   }
+   else       factor_node_indef(ni, snode, node, options, stats, work, pool_alloc,
+                                max_backup);
 }
 
 }}} /* end of namespace spral::ssids::cpu */
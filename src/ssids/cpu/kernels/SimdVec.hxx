@@ -6,18 +6,32 @@
 #pragma once
 
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <limits>
 
-#if defined(__AVX2__) || defined(__AVX__)
+#include "ssids/cpu/kernels/common.hxx"
+
+#if defined(__AVX512F__) || defined(__AVX2__) || defined(__AVX__)
 #include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
 #endif
 
 namespace spral { namespace ssids { namespace cpu {
+inline namespace SPRAL_CPU_ARCH_NS {
 
 /** \brief The SimdVec class isolates use of AVX/whatever intrinsics in a
  *  single place for ease of upgrading to future instruction sets.
  *
+ *  Supported instruction sets are (in order of preference) AVX-512F (8-wide),
+ *  AVX2/AVX (4-wide) and aarch64 NEON (2-wide), otherwise scalar code is
+ *  used. Masks (as returned by comparisons) are stored as vectors with all
+ *  bits of true lanes set, so they can be manipulated like any other value.
+ *
+ *  NB: SVE is not directly supported as its sizeless vector types cannot be
+ *  class members; SVE hardware uses the NEON implementation.
+ *
  *  Support is only added as required, so don't expect all intrinsics to be
  *  wrapped yet! */
 template <typename T>
@@ -30,11 +44,21 @@ public:
     * Properties of the type
     *******************************************/
 
-#if defined(__AVX2__) || defined(__AVX__)
+#if defined(__AVX512F__)
+   /// Length of underlying vector type
+   static const int vector_length = 8;
+   /// Typedef for underlying vector type containing doubles
+   typedef __m512d simd_double_type;
+#elif defined(__AVX2__) || defined(__AVX__)
    /// Length of underlying vector type
    static const int vector_length = 4;
    /// Typedef for underlying vector type containing doubles
    typedef __m256d simd_double_type;
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+   /// Length of underlying vector type
+   static const int vector_length = 2;
+   /// Typedef for underlying vector type containing doubles
+   typedef float64x2_t simd_double_type;
 #else
    /// Length of underlying vector type
    static const int vector_length = 1;
@@ -52,13 +76,18 @@ public:
    /// Initialize all entries in vector to given scalar value
    SimdVec(const double initial_value)
    {
-#if defined(__AVX2__) || defined(__AVX__)
+#if defined(__AVX512F__)
+      val = _mm512_set1_pd(initial_value);
+#elif defined(__AVX2__) || defined(__AVX__)
       val = _mm256_set1_pd(initial_value);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+      val = vdupq_n_f64(initial_value);
 #else
       val = initial_value;
 #endif
    }
-#if defined(__AVX2__) || defined(__AVX__)
+#if defined(__AVX512F__) || defined(__AVX2__) || defined(__AVX__) || \
+    (defined(__ARM_NEON) && defined(__aarch64__))
    /// Initialize with underlying vector type
    SimdVec(const simd_double_type &initial_value) {
       val = initial_value;
@@ -68,8 +97,8 @@ public:
    SimdVec(const SimdVec<double> &initial_value) {
       val = initial_value.val;
    }
-#if defined(__AVX2__) || defined(__AVX__)
-   /// Initialize as a vector by specifying all entries (no version for non-avx)
+#if (defined(__AVX2__) || defined(__AVX__)) && !defined(__AVX512F__)
+   /// Initialize as a vector by specifying all entries (AVX only)
    SimdVec(double x1, double x2, double x3, double x4) {
       val = _mm256_set_pd(x4, x3, x2, x1); // Reversed order expected
    }
@@ -82,8 +111,12 @@ public:
    /// Load from suitably aligned memory
    static
    const SimdVec load_aligned(const double *src) {
-#if defined(__AVX2__) || defined(__AVX__)
+#if defined(__AVX512F__)
+      return SimdVec( _mm512_load_pd(src) );
+#elif defined(__AVX2__) || defined(__AVX__)
       return SimdVec( _mm256_load_pd(src) );
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+      return SimdVec( vld1q_f64(src) );
 #else
       return SimdVec( src[0] );
 #endif
@@ -92,8 +125,12 @@ public:
    /// Load from unaligned memory
    static
    const SimdVec load_unaligned(const double *src) {
-#if defined(__AVX2__) || defined(__AVX__)
+#if defined(__AVX512F__)
+      return SimdVec( _mm512_loadu_pd(src) );
+#elif defined(__AVX2__) || defined(__AVX__)
       return SimdVec( _mm256_loadu_pd(src) );
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+      return SimdVec( vld1q_f64(src) );
 #else
       return SimdVec( src[0] );
 #endif
@@ -101,8 +138,12 @@ public:
 
    /// Extract value as array
    void store_aligned(double *dest) const {
-#if defined(__AVX2__) || defined(__AVX__)
+#if defined(__AVX512F__)
+      _mm512_store_pd(dest, val);
+#elif defined(__AVX2__) || defined(__AVX__)
       _mm256_store_pd(dest, val);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+      vst1q_f64(dest, val);
 #else
       dest[0] = val;
 #endif
@@ -110,8 +151,12 @@ public:
 
    /// Extract value as array
    void store_unaligned(double *dest) const {
-#if defined(__AVX2__) || defined(__AVX__)
+#if defined(__AVX512F__)
+      _mm512_storeu_pd(dest, val);
+#elif defined(__AVX2__) || defined(__AVX__)
       _mm256_storeu_pd(dest, val);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+      vst1q_f64(dest, val);
 #else
       dest[0] = val;
 #endif
@@ -124,8 +169,17 @@ public:
    /// Blend operation: returns (mask) ? x2 : x1
    friend
    SimdVec blend(const SimdVec &x1, const SimdVec &x2, const SimdVec &mask) {
-#if defined(__AVX2__) || defined(__AVX__)
+#if defined(__AVX512F__)
+      __m512i imask = _mm512_castpd_si512(mask.val);
+      return SimdVec( _mm512_mask_blend_pd(
+               _mm512_test_epi64_mask(imask, imask), x1.val, x2.val
+               ) );
+#elif defined(__AVX2__) || defined(__AVX__)
       return SimdVec( _mm256_blendv_pd(x1.val, x2.val, mask.val) );
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+      return SimdVec(
+            vbslq_f64(vreinterpretq_u64_f64(mask.val), x2.val, x1.val)
+         );
 #else
       return SimdVec( (mask.val) ? x2 : x1 );
 #endif
@@ -134,10 +188,14 @@ public:
    /// Returns absolute values
    friend
    SimdVec fabs(const SimdVec &x) {
-#if defined(__AVX2__) || defined(__AVX__)
+#if defined(__AVX512F__)
+      return SimdVec( _mm512_abs_pd(x.val) );
+#elif defined(__AVX2__) || defined(__AVX__)
       return SimdVec(
             _mm256_andnot_pd(_mm256_set1_pd(-0.0), x)
          );
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+      return SimdVec( vabsq_f64(x.val) );
 #else
       return SimdVec( fabs(x.val) );
 #endif
@@ -146,10 +204,18 @@ public:
    /// Return a = b * c + a
    friend
    SimdVec fmadd(const SimdVec &a, const SimdVec &b, const SimdVec &c) {
-#if defined(__AVX2__)
+#if defined(__AVX512F__)
+      return SimdVec(
+            _mm512_fmadd_pd(b.val, c.val, a.val)
+         );
+#elif defined(__AVX2__)
       return SimdVec(
             _mm256_fmadd_pd(b.val, c.val, a.val)
          );
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+      return SimdVec(
+            vfmaq_f64(a.val, b.val, c.val)
+         );
 #else
       return b*c + a;
 #endif
@@ -183,8 +249,14 @@ public:
    /// Vector valued GT comparison
    friend
    SimdVec operator>(const SimdVec &lhs, const SimdVec &rhs) {
-#if defined(__AVX2__) || defined(__AVX__)
+#if defined(__AVX512F__)
+      return mask_to_vec(
+            _mm512_cmp_pd_mask(lhs.val, rhs.val, _CMP_GT_OQ)
+         );
+#elif defined(__AVX2__) || defined(__AVX__)
       return SimdVec( _mm256_cmp_pd(lhs.val, rhs.val, _CMP_GT_OQ) );
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+      return SimdVec( vreinterpretq_f64_u64(vcgtq_f64(lhs.val, rhs.val)) );
 #else
       return SimdVec( lhs.val > rhs.val );
 #endif
@@ -193,8 +265,17 @@ public:
    /// Bitwise and
    friend
    SimdVec operator&(const SimdVec &lhs, const SimdVec &rhs) {
-#if defined(__AVX2__) || defined(__AVX__)
+#if defined(__AVX512F__)
+      // NB: _mm512_and_pd() requires AVX512DQ, so use integer version
+      return SimdVec( _mm512_castsi512_pd( _mm512_and_si512(
+               _mm512_castpd_si512(lhs.val), _mm512_castpd_si512(rhs.val)
+               ) ) );
+#elif defined(__AVX2__) || defined(__AVX__)
       return SimdVec( _mm256_and_pd(lhs.val, rhs.val) );
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+      return SimdVec( vreinterpretq_f64_u64( vandq_u64(
+               vreinterpretq_u64_f64(lhs.val), vreinterpretq_u64_f64(rhs.val)
+               ) ) );
 #else
       return SimdVec( lhs.val && rhs.val );
 #endif
@@ -202,11 +283,21 @@ public:
 
    /// Multiply
    // NB: don't override builtin operator*(double,double) in scalar case
-#if defined(__AVX2__) || defined(__AVX__)
+#if defined(__AVX512F__)
+   friend
+   SimdVec operator*(const SimdVec &lhs, const SimdVec &rhs) {
+      return SimdVec( _mm512_mul_pd(lhs.val, rhs.val) );
+   }
+#elif defined(__AVX2__) || defined(__AVX__)
    friend
    SimdVec operator*(const SimdVec &lhs, const SimdVec &rhs) {
       return SimdVec( _mm256_mul_pd(lhs.val, rhs.val) );
    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+   friend
+   SimdVec operator*(const SimdVec &lhs, const SimdVec &rhs) {
+      return SimdVec( vmulq_f64(lhs.val, rhs.val) );
+   }
 #endif
 
    SimdVec& operator*=(const SimdVec &rhs) {
@@ -216,11 +307,21 @@ public:
 
    /// Add
    // NB: don't override builtin operator*(double,double) in scalar case
-#if defined(__AVX2__) || defined(__AVX__)
+#if defined(__AVX512F__)
+   friend
+   SimdVec operator+(const SimdVec &lhs, const SimdVec &rhs) {
+      return SimdVec( _mm512_add_pd(lhs.val, rhs.val) );
+   }
+#elif defined(__AVX2__) || defined(__AVX__)
    friend
    SimdVec operator+(const SimdVec &lhs, const SimdVec &rhs) {
       return SimdVec( _mm256_add_pd(lhs.val, rhs.val) );
    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+   friend
+   SimdVec operator+(const SimdVec &lhs, const SimdVec &rhs) {
+      return SimdVec( vaddq_f64(lhs.val, rhs.val) );
+   }
 #endif
 
    /*******************************************
@@ -230,8 +331,12 @@ public:
    /// Returns an instance initialized to zero using custom instructions
    static
    SimdVec zero() {
-#if defined(__AVX2__) || defined(__AVX__)
+#if defined(__AVX512F__)
+      return SimdVec(_mm512_setzero_pd());
+#elif defined(__AVX2__) || defined(__AVX__)
       return SimdVec(_mm256_setzero_pd());
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+      return SimdVec(vdupq_n_f64(0.0));
 #else
       return SimdVec(0.0);
 #endif
@@ -241,7 +346,10 @@ public:
    /// false.
    static
    SimdVec gt_mask(int idx) {
-#if defined(__AVX2__) || defined(__AVX__)
+#if defined(__AVX512F__)
+      return (idx < vector_length) ? mask_to_vec( 0xFF << idx )
+                                   : SimdVec::zero();
+#elif defined(__AVX2__) || defined(__AVX__)
       const double avx_true  = -std::numeric_limits<double>::quiet_NaN();
       const double avx_false = 0.0;
       switch(idx) {
@@ -251,6 +359,12 @@ public:
          case 3:  return SimdVec(avx_false, avx_false, avx_false,  avx_true);
          default: return SimdVec(avx_false, avx_false, avx_false, avx_false);
       }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+      const uint64_t lanes[2] = {
+         (idx <= 0) ? ~UINT64_C(0) : UINT64_C(0),
+         (idx <= 1) ? ~UINT64_C(0) : UINT64_C(0)
+      };
+      return SimdVec( vreinterpretq_f64_u64(vld1q_u64(lanes)) );
 #else
       return (idx>0) ? SimdVec(false) : SimdVec(true);
 #endif
@@ -266,8 +380,234 @@ public:
    }
 
 private:
+#if defined(__AVX512F__)
+   /// Convert AVX-512 mask register to vector with all bits set in true lanes
+   static
+   SimdVec mask_to_vec(__mmask8 mask) {
+      return SimdVec( _mm512_castsi512_pd(
+               _mm512_maskz_set1_epi64(mask, -1)
+               ) );
+   }
+#endif
+
    /// Underlying vector that this type wraps
    simd_double_type val;
 };
 
+/** \brief Single precision counterpart of SimdVec<double>, with only the
+ *  operations needed by the solve kernels (see small_solve.hxx). */
+template <>
+class SimdVec<float> {
+public:
+   /*******************************************
+    * Properties of the type
+    *******************************************/
+
+#if defined(__AVX512F__)
+   /// Length of underlying vector type
+   static const int vector_length = 16;
+   /// Typedef for underlying vector type containing floats
+   typedef __m512 simd_float_type;
+#elif defined(__AVX2__) || defined(__AVX__)
+   /// Length of underlying vector type
+   static const int vector_length = 8;
+   /// Typedef for underlying vector type containing floats
+   typedef __m256 simd_float_type;
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+   /// Length of underlying vector type
+   static const int vector_length = 4;
+   /// Typedef for underlying vector type containing floats
+   typedef float32x4_t simd_float_type;
+#else
+   /// Length of underlying vector type
+   static const int vector_length = 1;
+   /// Typedef for underlying vector type containing floats
+   typedef float simd_float_type;
+#endif
+
+   /*******************************************
+    * Constructors
+    *******************************************/
+
+   /// Uninitialized value constructor
+   SimdVec()
+   {}
+   /// Initialize all entries in vector to given scalar value
+   SimdVec(const float initial_value)
+   {
+#if defined(__AVX512F__)
+      val = _mm512_set1_ps(initial_value);
+#elif defined(__AVX2__) || defined(__AVX__)
+      val = _mm256_set1_ps(initial_value);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+      val = vdupq_n_f32(initial_value);
+#else
+      val = initial_value;
+#endif
+   }
+#if defined(__AVX512F__) || defined(__AVX2__) || defined(__AVX__) || \
+    (defined(__ARM_NEON) && defined(__aarch64__))
+   /// Initialize with underlying vector type
+   SimdVec(const simd_float_type &initial_value) {
+      val = initial_value;
+   }
+#endif
+   /// Initialize with another SimdVec
+   SimdVec(const SimdVec<float> &initial_value) {
+      val = initial_value.val;
+   }
+
+   /*******************************************
+    * Memory load/store
+    *******************************************/
+
+   /// Load from suitably aligned memory
+   static
+   const SimdVec load_aligned(const float *src) {
+#if defined(__AVX512F__)
+      return SimdVec( _mm512_load_ps(src) );
+#elif defined(__AVX2__) || defined(__AVX__)
+      return SimdVec( _mm256_load_ps(src) );
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+      return SimdVec( vld1q_f32(src) );
+#else
+      return SimdVec( src[0] );
+#endif
+   }
+
+   /// Load from unaligned memory
+   static
+   const SimdVec load_unaligned(const float *src) {
+#if defined(__AVX512F__)
+      return SimdVec( _mm512_loadu_ps(src) );
+#elif defined(__AVX2__) || defined(__AVX__)
+      return SimdVec( _mm256_loadu_ps(src) );
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+      return SimdVec( vld1q_f32(src) );
+#else
+      return SimdVec( src[0] );
+#endif
+   }
+
+   /// Extract value as array
+   void store_aligned(float *dest) const {
+#if defined(__AVX512F__)
+      _mm512_store_ps(dest, val);
+#elif defined(__AVX2__) || defined(__AVX__)
+      _mm256_store_ps(dest, val);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+      vst1q_f32(dest, val);
+#else
+      dest[0] = val;
+#endif
+   }
+
+   /// Extract value as array
+   void store_unaligned(float *dest) const {
+#if defined(__AVX512F__)
+      _mm512_storeu_ps(dest, val);
+#elif defined(__AVX2__) || defined(__AVX__)
+      _mm256_storeu_ps(dest, val);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+      vst1q_f32(dest, val);
+#else
+      dest[0] = val;
+#endif
+   }
+
+   /*******************************************
+    * Named operations
+    *******************************************/
+
+   /// Return a = b * c + a
+   friend
+   SimdVec fmadd(const SimdVec &a, const SimdVec &b, const SimdVec &c) {
+#if defined(__AVX512F__)
+      return SimdVec(
+            _mm512_fmadd_ps(b.val, c.val, a.val)
+         );
+#elif defined(__AVX2__)
+      return SimdVec(
+            _mm256_fmadd_ps(b.val, c.val, a.val)
+         );
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+      return SimdVec(
+            vfmaq_f32(a.val, b.val, c.val)
+         );
+#else
+      return b*c + a;
+#endif
+   }
+
+   /*******************************************
+    * Operators
+    *******************************************/
+
+   /// Conversion to underlying type
+   operator simd_float_type() const {
+      return val;
+   }
+
+   /// Multiply
+   // NB: don't override builtin operator*(float,float) in scalar case
+#if defined(__AVX512F__)
+   friend
+   SimdVec operator*(const SimdVec &lhs, const SimdVec &rhs) {
+      return SimdVec( _mm512_mul_ps(lhs.val, rhs.val) );
+   }
+#elif defined(__AVX2__) || defined(__AVX__)
+   friend
+   SimdVec operator*(const SimdVec &lhs, const SimdVec &rhs) {
+      return SimdVec( _mm256_mul_ps(lhs.val, rhs.val) );
+   }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+   friend
+   SimdVec operator*(const SimdVec &lhs, const SimdVec &rhs) {
+      return SimdVec( vmulq_f32(lhs.val, rhs.val) );
+   }
+#endif
+
+   /// Add
+   // NB: don't override builtin operator+(float,float) in scalar case
+#if defined(__AVX512F__)
+   friend
+   SimdVec operator+(const SimdVec &lhs, const SimdVec &rhs) {
+      return SimdVec( _mm512_add_ps(lhs.val, rhs.val) );
+   }
+#elif defined(__AVX2__) || defined(__AVX__)
+   friend
+   SimdVec operator+(const SimdVec &lhs, const SimdVec &rhs) {
+      return SimdVec( _mm256_add_ps(lhs.val, rhs.val) );
+   }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+   friend
+   SimdVec operator+(const SimdVec &lhs, const SimdVec &rhs) {
+      return SimdVec( vaddq_f32(lhs.val, rhs.val) );
+   }
+#endif
+
+   /*******************************************
+    * Factory functions for special cases
+    *******************************************/
+
+   /// Returns an instance initialized to zero using custom instructions
+   static
+   SimdVec zero() {
+#if defined(__AVX512F__)
+      return SimdVec(_mm512_setzero_ps());
+#elif defined(__AVX2__) || defined(__AVX__)
+      return SimdVec(_mm256_setzero_ps());
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+      return SimdVec(vdupq_n_f32(0.0f));
+#else
+      return SimdVec(0.0f);
+#endif
+   }
+
+private:
+   /// Underlying vector that this type wraps
+   simd_float_type val;
+};
+
+} /* inline namespace SPRAL_CPU_ARCH_NS */
 }}} /* namespaces spral::ssids::cpu */
@@ -0,0 +1,135 @@
+/** \file
+ *  \copyright 2016 The Science and Technology Facilities Council (STFC)
+ *  \licence   BSD licence, see LICENCE file for details
+ *  \author    Jonathan Hogg
+ *
+ *  \brief Application of a diagonal block's pivots to an off-diagonal block,
+ *  and the associated a posteori threshold test, as used by ldlt_app.
+ */
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "ssids/cpu/kernels/common.hxx"
+#include "ssids/cpu/kernels/wrappers.hxx"
+
+namespace spral { namespace ssids { namespace cpu {
+inline namespace SPRAL_CPU_ARCH_NS {
+
+/** Check if a block satisifies pivot threshold (colwise version) */
+template <enum operation op, typename T>
+int check_threshold(int rfrom, int rto, int cfrom, int cto, T u, T* aval, int lda) {
+   // Perform threshold test for each uneliminated row/column
+   int least_fail = (op==OP_N) ? cto : rto;
+   for(int j=cfrom; j<cto; j++)
+   for(int i=rfrom; i<rto; i++)
+      if(fabs(aval[j*lda+i]) > 1.0/u) {
+         if(op==OP_N) {
+            // must be least failed col
+            return j;
+         } else {
+            // may be an earlier failed row
+            least_fail = std::min(least_fail, i);
+            break;
+         }
+      }
+   // If we get this far, everything is good
+   return least_fail;
+}
+
+/** Performs solve with diagonal block \f$L_{21} = A_{21} L_{11}^{-T} D_1^{-1}\f$. Designed for below diagonal. */
+/* NB: d stores (inverted) pivots as follows:
+ * 2x2 ( a b ) stored as d = [ a b Inf c ]
+ *     ( b c )
+ * 1x1  ( a )  stored as d = [ a 0.0 ]
+ * 1x1  ( 0 ) stored as d = [ 0.0 0.0 ]
+ */
+template <enum operation op, typename T>
+void apply_pivot(int m, int n, int from, const T *diag, const T *d, const T small, T* aval, int lda) {
+   if(op==OP_N && from > m) return; // no-op
+   if(op==OP_T && from > n) return; // no-op
+
+   if(op==OP_N) {
+      // Perform solve L_11^-T
+      host_trsm<T>(SIDE_RIGHT, FILL_MODE_LWR, OP_T, DIAG_UNIT,
+            m, n, 1.0, diag, lda, aval, lda);
+      // Perform solve L_21 D^-1
+      for(int i=0; i<n; ) {
+         if(i+1==n || std::isfinite(d[2*i+2])) {
+            // 1x1 pivot
+            T d11 = d[2*i];
+            if(d11 == 0.0) {
+               // Handle zero pivots carefully
+               for(int j=0; j<m; j++) {
+                  T v = aval[i*lda+j];
+                  aval[i*lda+j] =
+                     (fabs(v)<small) ? 0.0
+                                     : std::numeric_limits<T>::infinity()*v;
+                  // NB: *v above handles NaNs correctly
+               }
+            } else {
+               // Non-zero pivot, apply in normal fashion
+               for(int j=0; j<m; j++)
+                  aval[i*lda+j] *= d11;
+            }
+            i++;
+         } else {
+            // 2x2 pivot
+            T d11 = d[2*i];
+            T d21 = d[2*i+1];
+            T d22 = d[2*i+3];
+            for(int j=0; j<m; j++) {
+               T a1 = aval[i*lda+j];
+               T a2 = aval[(i+1)*lda+j];
+               aval[i*lda+j]     = d11*a1 + d21*a2;
+               aval[(i+1)*lda+j] = d21*a1 + d22*a2;
+            }
+            i += 2;
+         }
+      }
+   } else { /* op==OP_T */
+      // Perform solve L_11^-1
+      host_trsm<T>(SIDE_LEFT, FILL_MODE_LWR, OP_N, DIAG_UNIT,
+            m, n-from, 1.0, diag, lda, &aval[from*lda], lda);
+      // Perform solve D^-T L_21^T
+      for(int i=0; i<m; ) {
+         if(i+1==m || std::isfinite(d[2*i+2])) {
+            // 1x1 pivot
+            T d11 = d[2*i];
+            if(d11 == 0.0) {
+               // Handle zero pivots carefully
+               for(int j=from; j<n; j++) {
+                  T v = aval[j*lda+i];
+                  aval[j*lda+i] =
+                     (fabs(v)<small) ? 0.0 // *v handles NaNs
+                                     : std::numeric_limits<T>::infinity()*v;
+                  // NB: *v above handles NaNs correctly
+               }
+            } else {
+               // Non-zero pivot, apply in normal fashion
+               for(int j=from; j<n; j++) {
+                  aval[j*lda+i] *= d11;
+               }
+            }
+            i++;
+         } else {
+            // 2x2 pivot
+            T d11 = d[2*i];
+            T d21 = d[2*i+1];
+            T d22 = d[2*i+3];
+            for(int j=from; j<n; j++) {
+               T a1 = aval[j*lda+i];
+               T a2 = aval[j*lda+(i+1)];
+               aval[j*lda+i]     = d11*a1 + d21*a2;
+               aval[j*lda+(i+1)] = d21*a1 + d22*a2;
+            }
+            i += 2;
+         }
+      }
+   }
+}
+
+} /* inline namespace SPRAL_CPU_ARCH_NS */
+}}} /* namespaces spral::ssids::cpu */
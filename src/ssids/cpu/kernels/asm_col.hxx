@@ -0,0 +1,98 @@
+/** \file
+ *  \copyright 2016 The Science and Technology Facilities Council (STFC)
+ *  \licence   BSD licence, see LICENCE file for details
+ *  \author    Jonathan Hogg
+ */
+#pragma once
+
+#include "ssids/cpu/kernels/common.hxx"
+#include "ssids/cpu/kernels/SimdVec.hxx"
+
+namespace spral { namespace ssids { namespace cpu {
+inline namespace SPRAL_CPU_ARCH_NS {
+
+/** Assemble a column with arbitrary indices.
+ *
+ * Performs the operation dest( idx(:) ) += src(:)
+ */
+template <typename T>
+inline
+void asm_col_indexed(int n, int const* idx, T const* src, T* dest) {
+   int const nunroll = 4;
+   int n2 = nunroll*(n/nunroll);
+   for(int j=0; j<n2; j+=nunroll) {
+      dest[ idx[j+0] ] += src[j+0];
+      dest[ idx[j+1] ] += src[j+1];
+      dest[ idx[j+2] ] += src[j+2];
+      dest[ idx[j+3] ] += src[j+3];
+   }
+   for(int j=n2; j<n; j++)
+      dest[ idx[j] ] += src[j];
+}
+
+#if defined(__AVX512F__)
+/** Assemble a column with arbitrary indices using AVX-512 gather/scatter.
+ *
+ * NB: Relies on idx(:) being distinct, as is true of any row list.
+ */
+inline
+void asm_col_indexed(int n, int const* idx, double const* src, double* dest) {
+   int n2 = 8*(n/8);
+   for(int j=0; j<n2; j+=8) {
+      __m256i vidx = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(&idx[j]));
+      // Masked form with zeroed source, as GCC's _mm512_i32gather_pd()
+      // leaves its pass-through operand uninitialized (-Wmaybe-uninitialized)
+      __m512d d = _mm512_mask_i32gather_pd(_mm512_setzero_pd(), 0xFF, vidx,
+            dest, sizeof(double));
+      d = _mm512_add_pd(d, _mm512_loadu_pd(&src[j]));
+      _mm512_i32scatter_pd(dest, vidx, d, sizeof(double));
+   }
+   for(int j=n2; j<n; j++)
+      dest[ idx[j] ] += src[j];
+}
+#endif /* __AVX512F__ */
+
+/** Assemble a contiguous run.
+ *
+ * Performs the operation dest(0:n-1) += src(0:n-1)
+ */
+template <typename T>
+inline
+void asm_col_contig(int n, T const* src, T* dest) {
+   typedef SimdVec<T> SimdVecT;
+   int const vlen = SimdVecT::vector_length;
+   int n2 = vlen*(n/vlen);
+   for(int j=0; j<n2; j+=vlen) {
+      SimdVecT d = SimdVecT::load_unaligned(&dest[j])
+         + SimdVecT::load_unaligned(&src[j]);
+      d.store_unaligned(&dest[j]);
+   }
+   for(int j=n2; j<n; j++)
+      dest[j] += src[j];
+}
+
+/** Assemble a column.
+ *
+ * Performs the operation dest( idx(:) ) += src(:)
+ *
+ * run(:) describes the runs of consecutive indices in idx(:), as set by
+ * find_runs() in assemble.hxx. Long runs are added directly with vector
+ * loads and stores, and the entries between them with asm_col_indexed().
+ */
+template <typename T>
+inline
+void asm_col(int n, int const* idx, int const* run, T const* src, T* dest) {
+   for(int j=0; j<n; ) {
+      int len = run[j];
+      if(len > 0) {
+         asm_col_contig(len, &src[j], &dest[ idx[j] ]);
+      } else {
+         len = -len;
+         asm_col_indexed(len, &idx[j], &src[j], dest);
+      }
+      j += len;
+   }
+}
+
+} /* inline namespace SPRAL_CPU_ARCH_NS */
+}}} /* namespaces spral::ssids::cpu */
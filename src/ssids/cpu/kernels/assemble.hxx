@@ -15,28 +15,10 @@
 #include "ssids/cpu/NumericNode.hxx"
 #include "ssids/cpu/SymbolicNode.hxx"
 #include "ssids/cpu/Workspace.hxx"
+#include "ssids/cpu/kernels/simd_kernels.hxx"
 
 namespace spral { namespace ssids { namespace cpu {
 
-/** Assemble a column.
- *
- * Performs the operation dest( idx(:) ) += src(:)
- */
-template <typename T>
-inline
-void asm_col(int n, int const* idx, T const* src, T* dest) {
-   int const nunroll = 4;
-   int n2 = nunroll*(n/nunroll);
-   for(int j=0; j<n2; j+=nunroll) {
-      dest[ idx[j+0] ] += src[j+0];
-      dest[ idx[j+1] ] += src[j+1];
-      dest[ idx[j+2] ] += src[j+2];
-      dest[ idx[j+3] ] += src[j+3];
-   }
-   for(int j=n2; j<n; j++)
-      dest[ idx[j] ] += src[j];
-}
-
 /**
    * \brief Add \f$A\f$ to a given block column of a node.
    *
@@ -79,6 +61,43 @@ void add_a_block(int from, int to, NumericNode& node, T const* aval,
    }
 }
 
+/**
+ * \brief Return position in node of row j (j >= csnode.ncol) of its child
+ *        csnode.
+ *
+ * Uses the relative indices stored during analyse if there are any, and
+ * otherwise a lookup in the global-to-local map.
+ *
+ * \param csnode Child node.
+ * \param j Row of child.
+ * \param snode Node.
+ * \param ndelay_in Number of delays into node.
+ * \param map Map of node's entries (may be null if csnode.relidx is set).
+ */
+template <typename MapVector>
+inline int child_row_pos(SymbolicNode const& csnode, int j,
+      SymbolicNode const& snode, int ndelay_in, MapVector const& map) {
+   if(!csnode.relidx) return map[ csnode.rlist[j] ];
+   int r = csnode.relidx[j-csnode.ncol];
+   return (r < snode.ncol) ? r : r + ndelay_in;
+}
+
+/**
+ * \brief Find runs of consecutive entries of idx(from:n-1) for asm_col().
+ *
+ * On exit, if idx(j) starts a run of at least ASM_COL_MIN_RUN consecutive
+ * indices then run(j) is its length. Otherwise run(j) is minus the number
+ * of entries before the next such run (or the end of idx).
+ */
+inline void find_runs(int from, int n, int const* idx, int* run) {
+   int len = 0;
+   for(int j=n-1; j>=from; --j) {
+      len = (j+1<n && idx[j+1] == idx[j]+1) ? len+1 : 1;
+      if(len >= ASM_COL_MIN_RUN) run[j] = len;
+      else run[j] = (j+1<n && run[j+1] < 0) ? run[j+1]-1 : -1;
+   }
+}
+
 /**
  * \brief Assemble expected entries (i.e. not delays) into block column of
  *        the factors \f$L\f$
@@ -87,23 +106,27 @@ void add_a_block(int from, int to, NumericNode& node, T const* aval,
  * \param node Node to assemble into.
  * \param cnode Node to assemble from.
  * \param map Map of node's entries.
- * \param cache Length cm lookup vector.
+ * \param cache Length 2*cm lookup vector.
  */
 template <typename T, typename PoolAlloc, typename MapVector>
 void assemble_expected(int from, int to, NumericNode<T,PoolAlloc>& node, NumericNode<T,PoolAlloc> const& cnode, MapVector const& map, int* cache) {
    SymbolicNode const& csnode = cnode.symb;
    int cm = csnode.nrow - csnode.ncol;
    for(int j=from; j<cm; ++j)
-      cache[j] = map[ csnode.rlist[csnode.ncol+j] ];
+      cache[j] = child_row_pos(csnode, csnode.ncol+j, node.symb,
+            node.ndelay_in, map);
+   int* run = &cache[cm];
+   find_runs(from, cm, cache, run);
    for(int i=from; i<to; i++) {
       int c = cache[i];
-      T *src = &cnode.contrib[i*cm];
+      T *src = &cnode.contrib[i*cnode.ldcontrib];
       // NB: we handle contribution to contrib in assemble_post()
       if(c < node.symb.ncol) {
          // Contribution added to lcol
          int ldd = node.get_ldl();
          T *dest = &node.lcol[c*ldd];
-         asm_col(cm-i, &cache[i], &src[i], dest);
+         get_simd_kernels<T>().asm_col(cm-i, &cache[i], &run[i], &src[i],
+               dest);
       }
    }
 }
@@ -115,7 +138,7 @@ void assemble_expected(int from, int to, NumericNode<T,PoolAlloc>& node, Numeric
  * \param node Node to assemble into.
  * \param cnode Node to assemble from.
  * \param map Map of node's entries.
- * \param cache Length cm lookup vector.
+ * \param cache Length 2*cm lookup vector.
  */
 template <typename T, typename PoolAlloc, typename MapVector>
 void assemble_expected_contrib(int from, int to, NumericNode<T,PoolAlloc>& node, NumericNode<T,PoolAlloc> const& cnode, MapVector const& map, int* cache) {
@@ -123,31 +146,91 @@ void assemble_expected_contrib(int from, int to, NumericNode<T,PoolAlloc>& node,
    int cm = csnode.nrow - csnode.ncol;
    int ncol = node.symb.ncol + node.ndelay_in;
    for(int j=from; j<cm; ++j)
-      cache[j] = map[ csnode.rlist[csnode.ncol+j] ] - ncol;
+      cache[j] = child_row_pos(csnode, csnode.ncol+j, node.symb,
+            node.ndelay_in, map) - ncol;
+   int* run = &cache[cm];
+   find_runs(from, cm, cache, run);
    for(int i=from; i<to; i++) {
       int c = cache[i]+ncol;
-      T *src = &cnode.contrib[i*cm];
+      T *src = &cnode.contrib[i*cnode.ldcontrib];
       // NB: only interested in contribution to generated element
       if(c >= node.symb.ncol) {
          // Contribution added to contrib
-         int ldd = node.symb.nrow - node.symb.ncol;
-         T *dest = &node.contrib[(c-ncol)*ldd];
-         asm_col(cm-i, &cache[i], &src[i], dest);
+         T *dest = &node.contrib[(c-ncol)*node.ldcontrib];
+         get_simd_kernels<T>().asm_col(cm-i, &cache[i], &run[i], &src[i],
+               dest);
       }
    }
 }
 
+/**
+ * \brief Return the calling thread's map from global to local row indices.
+ *
+ * The map has length n+1 and is held in the thread's entry of map_work for
+ * the whole factorization, rather than being allocated for every node.
+ * It is never reset: each node overwrites the entries for its own rows
+ * before use, and only looks up rows of its children, which are a subset
+ * of these. Tasks spawned by the node may read it from other threads, but
+ * the owning (tied) task can only run its own descendants while they are
+ * outstanding, so the map is not overwritten until the node is done with
+ * it.
+ */
+inline int* get_map(int n, std::vector<Workspace>& map_work) {
+   return map_work[omp_get_thread_num()].get_ptr<int>(n+1);
+}
+
+/**
+ * \brief Return true if assembly of node needs the global-to-local map.
+ *
+ * It does not if analyse stored relative indices for all its children and
+ * it has no contributions from other subtrees (whose rows are only known at
+ * factorization time).
+ */
+template <typename NumericNode>
+bool needs_map(SymbolicNode const& snode, NumericNode const& node) {
+   if(snode.contrib.size() > 0) return true;
+   for(auto* child=node.first_child; child!=NULL; child=child->next_child)
+      if(!child->symb.relidx) return true;
+   return false;
+}
+
+/**
+ * \brief Return node's only child if we can adopt its contribution block in
+ *        place (see NumericNode::adopt_contrib()), or nullptr otherwise.
+ *
+ * Which nodes may do so is determined during analyse (see
+ * SymbolicSubtree::plan_inplace_contrib()), but the child must also still
+ * have a contribution block, allocated with room for us.
+ */
+template <typename NumericNode>
+NumericNode* find_inplace_child(SymbolicNode const& snode, NumericNode& node) {
+   if(snode.inplace_offset < 0) return nullptr;
+   auto* child = node.first_child;
+   if(!child->contrib || child->ldcontrib != snode.contrib_ld) return nullptr;
+   return child;
+}
+
+/**
+ * \brief Assemble node prior to its factorization: allocate it, add
+ *        \f$A\f$ and any delays, and add children's contributions to the
+ *        fully summed columns.
+ *
+ * If inplace is true and find_inplace_child() finds a suitable child,
+ * node adopts the child's contribution block rather than allocating its
+ * own, and the factorization must add to it.
+ */
 template <typename T,
           typename FactorAlloc,
           typename PoolAlloc>
 void assemble_pre(
       bool posdef,
+      bool inplace,
       int n,
       SymbolicNode const& snode,
       void** child_contrib,
       NumericNode<T,PoolAlloc>& node,
       FactorAlloc& factor_alloc,
-      PoolAlloc& pool_alloc,
+      std::vector<Workspace>& map_work,
       std::vector<Workspace>& work,
       T const* aval,
       T const* scaling
@@ -160,8 +243,6 @@ void assemble_pre(
    typename FADoubleTraits::allocator_type factor_alloc_double(factor_alloc);
    typedef typename std::allocator_traits<FactorAlloc>::template rebind_traits<int> FAIntTraits;
    typename FAIntTraits::allocator_type factor_alloc_int(factor_alloc);
-   typedef typename std::allocator_traits<PoolAlloc>::template rebind_traits<int> PAIntTraits;
-   typename PAIntTraits::allocator_type pool_alloc_int(pool_alloc);
 
    /* Count incoming delays and determine size of node */
    node.ndelay_in = 0;
@@ -190,8 +271,11 @@ void assemble_pre(
    //memset(node.lcol, 0, len*sizeof(T)); NOT REQUIRED as PoolAlloc is
    // required to ensure it is zero for us (i.e. uses calloc)
 
-   /* Get space for contribution block + (explicitly do not zero it!) */
-   node.alloc_contrib();
+   /* Get space for contribution block + (explicitly do not zero it!),
+    * unless we will take over our only child's in place */
+   NumericNode<T,PoolAlloc>* inplace_child =
+      (inplace) ? find_inplace_child(snode, node) : nullptr;
+   if(!inplace_child) node.alloc_contrib(inplace);
 
    /* Alloc + set perm for expected eliminations at this node (delays are set
     * when they are imported from children) */
@@ -226,18 +310,18 @@ void assemble_pre(
     */
    int delay_col = snode.ncol;
 
-   /* Build lookup vector, allowing for insertion of delayed vars */
+   /* Build lookup vector, allowing for insertion of delayed vars, unless
+    * analyse stored relative indices for all contributions */
    /* Note that while rlist[] is 1-indexed this is fine so long as lookup
     * is also 1-indexed (which it is as it is another node's rlist[] */
-   const auto map_deleter = [&pool_alloc_int, n](int* p) {
-      PAIntTraits::deallocate(pool_alloc_int, p, n+1);
-   };
-   auto map = std::unique_ptr<int[], decltype(map_deleter)>(
-         PAIntTraits::allocate(pool_alloc_int, n+1), map_deleter);
-   for(int i=0; i<snode.ncol; i++)
-      map[ snode.rlist[i] ] = i;
-   for(int i=snode.ncol; i<snode.nrow; i++)
-      map[ snode.rlist[i] ] = i + node.ndelay_in;
+   int* map = nullptr;
+   if(needs_map(snode, node)) {
+      map = get_map(n, map_work);
+      for(int i=0; i<snode.ncol; i++)
+         map[ snode.rlist[i] ] = i;
+      for(int i=snode.ncol; i<snode.nrow; i++)
+         map[ snode.rlist[i] ] = i + node.ndelay_in;
+   }
    /* Loop over children adding contributions */
 #ifdef PROFILE
    task_asm_pre.done();
@@ -262,7 +346,7 @@ void assemble_pre(
          dest = node.lcol;
          src = &child->lcol[child->nelim*lds + child->ndelay_in +i*lds];
          for(int j=csnode.ncol; j<csnode.nrow; j++) {
-            int r = map[ csnode.rlist[j] ];
+            int r = child_row_pos(csnode, j, snode, node.ndelay_in, map);
             if(r < ncol) dest[r*ldl+delay_col] = src[j];
             else         dest[delay_col*ldl+r] = src[j];
          }
@@ -275,25 +359,28 @@ void assemble_pre(
       /* Handle expected contributions (only if something there) */
       if(child->contrib) {
          int cm = csnode.nrow - csnode.ncol;
+         // Columns of an in place child beyond this are all node's contrib
+         int cmcol = (child == inplace_child) ? snode.inplace_offset : cm;
          int const block_size = 256; // FIXME: make configurable?
-         if(cm < block_size) {
+         if(cmcol < block_size) {
             // Single block
-            int* cache = work[omp_get_thread_num()].get_ptr<int>(cm);
-            assemble_expected(0, cm, node, *child, map, cache);
+            int* cache = work[omp_get_thread_num()].get_ptr<int>(2*cm);
+            assemble_expected(0, cmcol, node, *child, map, cache);
          } else {
             // Multiple blocks
             #pragma omp taskgroup
-            for(int iblk=0; iblk<cm; iblk+=block_size) {
+            for(int iblk=0; iblk<cmcol; iblk+=block_size) {
                #pragma omp task \
                   firstprivate(iblk) \
-                  shared(map, child, snode, node, csnode, cm, nrow, work)
+                  shared(map, child, snode, node, csnode, cm, cmcol, nrow, \
+                         work)
                {
 #ifdef PROFILE
                   Profile::Task task_asm_pre("TA_ASM_PRE");
 #endif
-                  int* cache = work[omp_get_thread_num()].get_ptr<int>(cm);
-                  assemble_expected(iblk, std::min(iblk+block_size,cm), node,
-                        *child, map, cache);
+                  int* cache = work[omp_get_thread_num()].get_ptr<int>(2*cm);
+                  assemble_expected(iblk, std::min(iblk+block_size,cmcol),
+                        node, *child, map, cache);
 #ifdef PROFILE
                   task_asm_pre.done();
 #endif
@@ -302,6 +389,7 @@ void assemble_pre(
          }
       }
    }
+   if(inplace_child) node.adopt_contrib(*inplace_child);
    /* Add any contribution block from other subtrees */
    for(int contrib_idx : snode.contrib) {
       int cn, ldcontrib, ndelay, lddelay;
@@ -311,9 +399,11 @@ void assemble_pre(
             child_contrib[contrib_idx], &cn, &cval, &ldcontrib, &crlist,
             &ndelay, &delay_perm, &delay_val, &lddelay
             );
-      int* cache = work[omp_get_thread_num()].get_ptr<int>(cn);
+      int* cache = work[omp_get_thread_num()].get_ptr<int>(2*cn);
       for(int j=0; j<cn; ++j)
          cache[j] = map[ crlist[j] ];
+      int* run = &cache[cn];
+      find_runs(0, cn, cache, run);
       /* Handle delays - go to back of node
        * (i.e. become the last rows as in lower triangular format) */
       for(int i=0; i<ndelay; i++) {
@@ -344,7 +434,8 @@ void assemble_pre(
             // Contribution added to lcol
             int ldd = align_lda<T>(nrow);
             T *dest = &node.lcol[c*ldd];
-            asm_col(cn-i, &cache[i], &src[i], dest);
+            get_simd_kernels<T>().asm_col(cn-i, &cache[i], &run[i], &src[i],
+                  dest);
          }
       }
    }
@@ -358,13 +449,9 @@ void assemble_post(
       SymbolicNode const& snode,
       void** child_contrib,
       NumericNode<T,PoolAlloc>& node,
-      PoolAlloc& pool_alloc,
+      std::vector<Workspace>& map_work,
       std::vector<Workspace>& work
       ) {
-   /* Rebind allocators */
-   typedef typename std::allocator_traits<PoolAlloc>::template rebind_traits<int> PAIntTraits;
-   typename PAIntTraits::allocator_type pool_alloc_int(pool_alloc);
-
    /* Initialise variables */
    int ncol = snode.ncol + node.ndelay_in;
 
@@ -374,12 +461,14 @@ void assemble_post(
       /* Build lookup vector, allowing for insertion of delayed vars */
       /* Note that while rlist[] is 1-indexed this is fine so long as lookup
        * is also 1-indexed (which it is as it is another node's rlist[] */
-      if(!map) map = PAIntTraits::allocate(pool_alloc_int, n+1);
-      // FIXME: probably don't need to worry about first ncol?
-      for(int i=0; i<snode.ncol; i++)
-         map[ snode.rlist[i] ] = i;
-      for(int i=snode.ncol; i<snode.nrow; i++)
-         map[ snode.rlist[i] ] = i + node.ndelay_in;
+      if(needs_map(snode, node)) {
+         map = get_map(n, map_work);
+         // FIXME: probably don't need to worry about first ncol?
+         for(int i=0; i<snode.ncol; i++)
+            map[ snode.rlist[i] ] = i;
+         for(int i=snode.ncol; i<snode.nrow; i++)
+            map[ snode.rlist[i] ] = i + node.ndelay_in;
+      }
       /* Loop over children adding contributions */
       for(auto* child=node.first_child; child!=NULL; child=child->next_child) {
          SymbolicNode const& csnode = child->symb;
@@ -387,7 +476,7 @@ void assemble_post(
          int cm = csnode.nrow - csnode.ncol;
          int const block_size = 256;
          if(cm < block_size) {
-            int* cache = work[omp_get_thread_num()].get_ptr<int>(cm);
+            int* cache = work[omp_get_thread_num()].get_ptr<int>(2*cm);
             assemble_expected_contrib(0, cm, node, *child, map, cache);
          } else {
             #pragma omp taskgroup
@@ -399,7 +488,7 @@ void assemble_post(
 #ifdef PROFILE
                   Profile::Task task_asm("TA_ASM_POST");
 #endif
-                  int* cache = work[omp_get_thread_num()].get_ptr<int>(cm);
+                  int* cache = work[omp_get_thread_num()].get_ptr<int>(2*cm);
                   assemble_expected_contrib(iblk, std::min(iblk+block_size,cm),
                         node, *child, map, cache);
 #ifdef PROFILE
@@ -422,24 +511,25 @@ void assemble_post(
             &ndelay, &delay_perm, &delay_val, &lddelay
             );
       if(!cval) continue; // child was all delays, nothing to do
-      int* cache = work[omp_get_thread_num()].get_ptr<int>(cn);
+      int* cache = work[omp_get_thread_num()].get_ptr<int>(2*cn);
       for(int j=0; j<cn; ++j)
          cache[j] = map[ crlist[j] ] - ncol;
+      int* run = &cache[cn];
+      find_runs(0, cn, cache, run);
       for(int i=0; i<cn; ++i) {
          int c = cache[i]+ncol;
          T const* src = &cval[i*ldcontrib];
          // NB: only interested in contribution to generated element
          if(c >= snode.ncol) {
             // Contribution added to contrib
-            int ldd = snode.nrow - snode.ncol;
-            T *dest = &node.contrib[(c-ncol)*ldd];
-            asm_col(cn-i, &cache[i], &src[i], dest);
+            T *dest = &node.contrib[(c-ncol)*node.ldcontrib];
+            get_simd_kernels<T>().asm_col(cn-i, &cache[i], &run[i], &src[i],
+                  dest);
          }
       }
       /* Free memory from child contribution block */
       spral_ssids_contrib_free_dbl(child_contrib[contrib_idx]);
    }
-   if(map) PAIntTraits::deallocate(pool_alloc_int, map, n+1);
 }
 
 }}} /* namespaces spral::ssids::cpu */
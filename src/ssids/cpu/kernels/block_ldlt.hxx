@@ -12,6 +12,7 @@
 #include "ssids/cpu/kernels/SimdVec.hxx"
 
 namespace spral { namespace ssids { namespace cpu {
+inline namespace SPRAL_CPU_ARCH_NS {
 namespace block_ldlt_internal {
 
 /** Swaps two columns of A */
@@ -412,4 +413,5 @@ void block_ldlt(int from, int *perm, T *a, int lda, T *d, T *ldwork,
       p += pivsiz;
    }
 }
+} /* inline namespace SPRAL_CPU_ARCH_NS */
 }}} /* namespaces spral::ssids::cpu */
@@ -12,6 +12,7 @@
 #include "ssids/cpu/kernels/SimdVec.hxx"
 
 namespace spral { namespace ssids { namespace cpu {
+inline namespace SPRAL_CPU_ARCH_NS {
 
 /** Return number of elements to skip at beginning to get an aligned element,
  *  or max int if alignment is not (trivally) possible.
@@ -117,4 +118,5 @@ void calcLD(int m, int n, T const* l, int ldl, T const* d, T* ld, int ldld) {
    }
 }
 
+} /* inline namespace SPRAL_CPU_ARCH_NS */
 }}} /* namespaces spral::ssids::cpu */
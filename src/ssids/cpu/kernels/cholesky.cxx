@@ -10,6 +10,8 @@
 #include <cstdio> // FIXME: remove as only used for debug
 
 #include "ssids/profile.hxx"
+#include "ssids/cpu/kernels/common.hxx"
+#include "ssids/cpu/kernels/small_solve.hxx"
 #include "ssids/cpu/kernels/wrappers.hxx"
 
 namespace spral { namespace ssids { namespace cpu {
@@ -29,8 +31,11 @@ namespace spral { namespace ssids { namespace cpu {
  *    contain at most blksz**2 entries.
  * \param info is initialized to -1, and will be changed to the index of any
  *    column where a non-zero column is encountered.
+ * \param lookahead the number of block columns after the current one whose
+ *    updates are given priority (see TaskPriority). If negative, all tasks
+ *    have the same priority.
  */
-void cholesky_factor(int m, int n, double* a, int lda, double beta, double* upd, int ldupd, int blksz, int *info) {
+void cholesky_factor(int m, int n, double* a, int lda, double beta, double* upd, int ldupd, int blksz, int *info, int lookahead) {
    if(n < blksz) {
       // Adjust so blocks have blksz**2 entries
       blksz = int((int64_t(blksz)*blksz) / n);
@@ -39,8 +44,10 @@ void cholesky_factor(int m, int n, double* a, int lda, double beta, double* upd,
    #pragma omp atomic write
    *info = -1;
 
-   /* FIXME: Would this be better row-wise to ensure critical path, rather than
-    * its current col-wise implementation ensuring maximum work available??? */
+   /* Tasks are generated col-wise, ensuring maximum work available, while
+    * their priorities favour the critical path */
+   int const diag_priority = task_priority(TASK_PRIORITY_DIAG, lookahead);
+   int const panel_priority = task_priority(TASK_PRIORITY_PANEL, lookahead);
    #pragma omp taskgroup
    for(int j = 0; j < n; j += blksz) {
      int blkn = std::min(blksz, n-j);
@@ -48,7 +55,8 @@ void cholesky_factor(int m, int n, double* a, int lda, double beta, double* upd,
      #pragma omp task default(none)                      \
         firstprivate(j, blkn)                            \
         shared(m, a, lda, blksz, info, beta, upd, ldupd) \
-        depend(inout: a[j*(lda+1):1])
+        depend(inout: a[j*(lda+1):1])                    \
+        priority(diag_priority)
      {
        int my_info;
        #pragma omp atomic read
@@ -86,7 +94,8 @@ void cholesky_factor(int m, int n, double* a, int lda, double beta, double* upd,
          firstprivate(i, j, blkn, blkm)                      \
          shared(a, lda, info, beta, upd, ldupd, blksz, n)    \
          depend(in: a[j*(lda+1):1])                          \
-         depend(inout: a[j*lda + i:1])
+         depend(inout: a[j*lda + i:1])                       \
+         priority(panel_priority)
        {
          int my_info;
          #pragma omp atomic read
@@ -112,13 +121,15 @@ void cholesky_factor(int m, int n, double* a, int lda, double beta, double* upd,
      /* Schur Update Tasks: mostly internal */
      for (int k = j+blksz; k < n; k += blksz) {
        int blkk = std::min(blksz, n-k);
+       int upd_priority = update_priority(j/blksz, k/blksz, lookahead);
        for (int i = k; i < m; i += blksz) {
          #pragma omp task default(none)                            \
            firstprivate(i, j, k, blkn, blkk)                       \
            shared(m, a, lda, blksz, info, beta, upd, ldupd, n)     \
            depend(in: a[j*lda+k:1])                                \
            depend(in: a[j*lda+i:1])                                \
-           depend(inout: a[k*lda+i:1])
+           depend(inout: a[k*lda+i:1])                             \
+           priority(upd_priority)
          {
            int my_info;
            #pragma omp atomic read
@@ -187,29 +198,41 @@ void cholesky_factor(int m, int n, double* a, int lda, double beta, double* upd,
 }
 
 /* Forwards solve corresponding to cholesky_factor() */
-void cholesky_solve_fwd(int m, int n, double const* a, int lda, int nrhs, double* x, int ldx) {
-   if(nrhs==1) {
-      host_trsv(FILL_MODE_LWR, OP_N, DIAG_NON_UNIT, n, a, lda, x, 1);
+template <typename T>
+void cholesky_solve_fwd(int m, int n, T const* a, int lda, int nrhs, T* x, int ldx) {
+   if(use_small_solve(m, n, nrhs)) {
+      // Avoid BLAS call overhead for small problems
+      small_solve_fwd<T, false>(m, n, a, lda, nrhs, x, ldx);
+   } else if(nrhs==1) {
+      host_trsv<T>(FILL_MODE_LWR, OP_N, DIAG_NON_UNIT, n, a, lda, x, 1);
       if(m > n)
-         gemv(OP_N, m-n, n, -1.0, &a[n], lda, x, 1, 1.0, &x[n], 1);
+         gemv<T>(OP_N, m-n, n, -1.0, &a[n], lda, x, 1, 1.0, &x[n], 1);
    } else {
-      host_trsm(SIDE_LEFT, FILL_MODE_LWR, OP_N, DIAG_NON_UNIT, n, nrhs, 1.0, a, lda, x, ldx);
+      host_trsm<T>(SIDE_LEFT, FILL_MODE_LWR, OP_N, DIAG_NON_UNIT, n, nrhs, 1.0, a, lda, x, ldx);
       if(m > n)
-         host_gemm(OP_N, OP_N, m-n, nrhs, n, -1.0, &a[n], lda, x, ldx, 1.0, &x[n], ldx);
+         host_gemm<T>(OP_N, OP_N, m-n, nrhs, n, -1.0, &a[n], lda, x, ldx, 1.0, &x[n], ldx);
    }
 }
+template void cholesky_solve_fwd<double>(int, int, double const*, int, int, double*, int);
+template void cholesky_solve_fwd<float>(int, int, float const*, int, int, float*, int);
 
 /* Backwards solve corresponding to cholesky_factor() */
-void cholesky_solve_bwd(int m, int n, double const* a, int lda, int nrhs, double* x, int ldx) {
-   if(nrhs==1) {
+template <typename T>
+void cholesky_solve_bwd(int m, int n, T const* a, int lda, int nrhs, T* x, int ldx) {
+   if(use_small_solve(m, n, nrhs)) {
+      // Avoid BLAS call overhead for small problems
+      small_solve_bwd<T, false>(m, n, a, lda, nrhs, x, ldx);
+   } else if(nrhs==1) {
       if(m > n)
-         gemv(OP_T, m-n, n, -1.0, &a[n], lda, &x[n], 1, 1.0, x, 1);
-      host_trsv(FILL_MODE_LWR, OP_T, DIAG_NON_UNIT, n, a, lda, x, 1);
+         gemv<T>(OP_T, m-n, n, -1.0, &a[n], lda, &x[n], 1, 1.0, x, 1);
+      host_trsv<T>(FILL_MODE_LWR, OP_T, DIAG_NON_UNIT, n, a, lda, x, 1);
    } else {
       if(m > n)
-         host_gemm(OP_T, OP_N, n, nrhs, m-n, -1.0, &a[n], lda, &x[n], ldx, 1.0, x, ldx);
-      host_trsm(SIDE_LEFT, FILL_MODE_LWR, OP_T, DIAG_NON_UNIT, n, nrhs, 1.0, a, lda, x, ldx);
+         host_gemm<T>(OP_T, OP_N, n, nrhs, m-n, -1.0, &a[n], lda, &x[n], ldx, 1.0, x, ldx);
+      host_trsm<T>(SIDE_LEFT, FILL_MODE_LWR, OP_T, DIAG_NON_UNIT, n, nrhs, 1.0, a, lda, x, ldx);
    }
 }
+template void cholesky_solve_bwd<double>(int, int, double const*, int, int, double*, int);
+template void cholesky_solve_bwd<float>(int, int, float const*, int, int, float*, int);
 
 }}} /* namespaces spral::ssids::cpu */
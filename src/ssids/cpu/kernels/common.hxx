@@ -7,22 +7,47 @@
 
 namespace spral { namespace ssids { namespace cpu {
 
-/** \brief Supported CPU architectures that can be targeted */
+/** \brief Supported CPU architectures that can be targeted.
+ *
+ *  Values are reported to the user as inform%cpu_isa, so must not change. */
 enum cpu_arch {
-   CPU_ARCH_GENERIC, // No explicit vectorization
-   CPU_ARCH_AVX,     // Allow AVX optimized kernel (Sandy-/Ivy-Bridge)
-   CPU_ARCH_AVX2     // Allow use of AVX2 (FMA3)
+   CPU_ARCH_GENERIC = 0, // No explicit vectorization
+   CPU_ARCH_AVX     = 1, // Allow AVX optimized kernel (Sandy-/Ivy-Bridge)
+   CPU_ARCH_AVX2    = 2, // Allow use of AVX2 (FMA3)
+   CPU_ARCH_AVX512  = 3, // Allow use of AVX-512F
+   CPU_ARCH_NEON    = 4  // Allow use of aarch64 NEON
 };
 
 /** \brief CPU_BEST_ARCH is set to a value of enum cpu_arch that represents the best supported instruction set supported by current compiler and compiler flags */
-#ifdef __AVX2__
+#if defined(__AVX512F__)
+const enum cpu_arch CPU_BEST_ARCH = CPU_ARCH_AVX512;
+#elif defined(__AVX2__)
 const enum cpu_arch CPU_BEST_ARCH = CPU_ARCH_AVX2;
-#else
-# ifdef __AVX__
+#elif defined(__AVX__)
 const enum cpu_arch CPU_BEST_ARCH = CPU_ARCH_AVX;
-# else
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+const enum cpu_arch CPU_BEST_ARCH = CPU_ARCH_NEON;
+#else
 const enum cpu_arch CPU_BEST_ARCH = CPU_ARCH_GENERIC;
-# endif
+#endif
+
+/** \brief SPRAL_CPU_ARCH_NS names an inline namespace for code whose
+ *  generated instructions depend on CPU_BEST_ARCH (SimdVec and the kernels
+ *  built on it).
+ *
+ *  The same templates are compiled several times with different instruction
+ *  set flags for runtime dispatch (see simd_kernels.hxx); placing them in a
+ *  distinct namespace for each stops the linker merging the copies. */
+#if defined(__AVX512F__)
+# define SPRAL_CPU_ARCH_NS arch_avx512
+#elif defined(__AVX2__)
+# define SPRAL_CPU_ARCH_NS arch_avx2
+#elif defined(__AVX__)
+# define SPRAL_CPU_ARCH_NS arch_avx
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+# define SPRAL_CPU_ARCH_NS arch_neon
+#else
+# define SPRAL_CPU_ARCH_NS arch_generic
 #endif
 
 
@@ -123,6 +148,40 @@ enum PotrfAlgorithm {
    POTRF_SHMEM
 };
 
+/**
+ * \brief Priorities of the tasks of blocked factorizations on the CPU.
+ *
+ * The critical path of a blocked factorization runs through the
+ * factorization of each diagonal block, the application of it to the rest
+ * of its block column, and the updates of the next block column. Giving
+ * these tasks priority stops the next diagonal block waiting behind updates
+ * that will not be needed for some time. Updates of the block columns
+ * within a lookahead window of the current one are favoured over the rest.
+ *
+ * \note Priorities have no effect unless the environment variable
+ *       OMP_MAX_TASK_PRIORITY is at least TASK_PRIORITY_MAX.
+ */
+enum TaskPriority {
+   TASK_PRIORITY_UPDATE = 0, ///< Other updates, incl. contribution block
+   TASK_PRIORITY_LOOKAHEAD = 1, ///< Updates within the lookahead window
+   TASK_PRIORITY_PANEL = 2, ///< Application of diagonal block to its column
+   TASK_PRIORITY_DIAG = 3, ///< Factorization of diagonal block
+   TASK_PRIORITY_MAX = TASK_PRIORITY_DIAG
+};
+
+/** \brief Return priority of a task of the given type, or
+ *         TASK_PRIORITY_UPDATE for all tasks if lookahead is negative. */
+inline int task_priority(TaskPriority type, int lookahead) {
+   return (lookahead < 0) ? TASK_PRIORITY_UPDATE : type;
+}
+
+/** \brief Return priority of an update by block column blk of block column
+ *         (or row) jblk, with the given lookahead window. */
+inline int update_priority(int blk, int jblk, int lookahead) {
+   return (jblk > blk && jblk-blk <= lookahead) ? TASK_PRIORITY_LOOKAHEAD
+                                               : TASK_PRIORITY_UPDATE;
+}
+
 namespace util {
 #ifdef __CUDACC__
    template <typename T>
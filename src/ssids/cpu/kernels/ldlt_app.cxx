@@ -6,6 +6,7 @@
 #include "ssids/cpu/kernels/ldlt_app.hxx"
 
 #include <algorithm>
+#include <atomic>
 #include <climits>
 #include <cmath>
 #include <cstdio>
@@ -24,21 +25,26 @@
 
 #include "compat.hxx"
 #include "ssids/profile.hxx"
+#include "ssids/cpu/block_size.hxx"
 #include "ssids/cpu/BlockPool.hxx"
 #include "ssids/cpu/BuddyAllocator.hxx"
 #include "ssids/cpu/cpu_iface.hxx"
+#include "ssids/cpu/SystemMemory.hxx"
+#include "ssids/cpu/ThreadCacheAllocator.hxx"
+#include "ssids/cpu/ThreadStats.hxx"
 #include "ssids/cpu/Workspace.hxx"
 #include "ssids/cpu/kernels/block_ldlt.hxx"
-#include "ssids/cpu/kernels/calc_ld.hxx"
 #include "ssids/cpu/kernels/ldlt_tpp.hxx"
 #include "ssids/cpu/kernels/common.hxx"
+#include "ssids/cpu/kernels/simd_kernels.hxx"
+#include "ssids/cpu/kernels/small_solve.hxx"
 #include "ssids/cpu/kernels/wrappers.hxx"
 
 namespace spral { namespace ssids { namespace cpu {
 
 namespace ldlt_app_internal {
 
-static const int INNER_BLOCK_SIZE = 32;
+static const int INNER_BLOCK_SIZE = LDLT_APP_INNER_BLOCK_SIZE;
 
 /** \return number of blocks for given n */
 inline int calc_nblk(int n, int block_size) {
@@ -241,9 +247,9 @@ private:
 
 /** Returns true if ptr is suitably aligned for AVX, false if not */
 bool is_aligned(void* ptr) {
-#if defined(__AVX512F__)
+#if defined(__AVX512F__) || defined(HAVE_AVX512_KERNELS)
   const int align = 64;
-#elif defined(__AVX__)
+#elif defined(__AVX__) || defined(HAVE_AVX2_KERNELS)
   const int align = 32;
 #else
   const int align = 16;
@@ -292,6 +298,19 @@ void copy_failed_diag(int m, int n, Column const& idata, Column const& jdata, T*
       dout[jout*ldout+iout] = aval[j*lda+i];
 }
 
+/** Calls block_ldlt(), using the runtime selected SimdKernels if they
+ *  support BLOCK_SIZE */
+template <typename T, int BLOCK_SIZE>
+void dispatch_block_ldlt(int from, int *perm, T *a, int lda, T *d, T *ldwork,
+      bool action, const T u, const T small, int *lperm) {
+   if(BLOCK_SIZE == SIMD_KERNELS_BLOCK_SIZE)
+      get_simd_kernels<T>().block_ldlt(from, perm, a, lda, d, ldwork, action,
+            u, small, lperm);
+   else
+      block_ldlt<T, BLOCK_SIZE>(from, perm, a, lda, d, ldwork, action, u,
+            small, lperm);
+}
+
 /** Copies failed columns to specified location */
 template<typename T, typename Column>
 void copy_failed_rect(int m, int n, int rfrom, Column const& jdata, T* cout, int ldout, T const* aval, int lda) {
@@ -300,119 +319,6 @@ void copy_failed_rect(int m, int n, int rfrom, Column const& jdata, T* cout, int
          cout[jout*ldout+i] = aval[j*lda+i];
 }
 
-/** Check if a block satisifies pivot threshold (colwise version) */
-template <enum operation op, typename T>
-int check_threshold(int rfrom, int rto, int cfrom, int cto, T u, T* aval, int lda) {
-   // Perform threshold test for each uneliminated row/column
-   int least_fail = (op==OP_N) ? cto : rto;
-   for(int j=cfrom; j<cto; j++)
-   for(int i=rfrom; i<rto; i++)
-      if(fabs(aval[j*lda+i]) > 1.0/u) {
-         if(op==OP_N) {
-            // must be least failed col
-            return j;
-         } else {
-            // may be an earlier failed row
-            least_fail = std::min(least_fail, i);
-            break;
-         }
-      }
-   // If we get this far, everything is good
-   return least_fail;
-}
-
-/** Performs solve with diagonal block \f$L_{21} = A_{21} L_{11}^{-T} D_1^{-1}\f$. Designed for below diagonal. */
-/* NB: d stores (inverted) pivots as follows:
- * 2x2 ( a b ) stored as d = [ a b Inf c ]
- *     ( b c )
- * 1x1  ( a )  stored as d = [ a 0.0 ]
- * 1x1  ( 0 ) stored as d = [ 0.0 0.0 ]
- */
-template <enum operation op, typename T>
-void apply_pivot(int m, int n, int from, const T *diag, const T *d, const T small, T* aval, int lda) {
-   if(op==OP_N && from > m) return; // no-op
-   if(op==OP_T && from > n) return; // no-op
-
-   if(op==OP_N) {
-      // Perform solve L_11^-T
-      host_trsm<T>(SIDE_RIGHT, FILL_MODE_LWR, OP_T, DIAG_UNIT,
-            m, n, 1.0, diag, lda, aval, lda);
-      // Perform solve L_21 D^-1
-      for(int i=0; i<n; ) {
-         if(i+1==n || std::isfinite(d[2*i+2])) {
-            // 1x1 pivot
-            T d11 = d[2*i];
-            if(d11 == 0.0) {
-               // Handle zero pivots carefully
-               for(int j=0; j<m; j++) {
-                  T v = aval[i*lda+j];
-                  aval[i*lda+j] =
-                     (fabs(v)<small) ? 0.0
-                                     : std::numeric_limits<T>::infinity()*v;
-                  // NB: *v above handles NaNs correctly
-               }
-            } else {
-               // Non-zero pivot, apply in normal fashion
-               for(int j=0; j<m; j++)
-                  aval[i*lda+j] *= d11;
-            }
-            i++;
-         } else {
-            // 2x2 pivot
-            T d11 = d[2*i];
-            T d21 = d[2*i+1];
-            T d22 = d[2*i+3];
-            for(int j=0; j<m; j++) {
-               T a1 = aval[i*lda+j];
-               T a2 = aval[(i+1)*lda+j];
-               aval[i*lda+j]     = d11*a1 + d21*a2;
-               aval[(i+1)*lda+j] = d21*a1 + d22*a2;
-            }
-            i += 2;
-         }
-      }
-   } else { /* op==OP_T */
-      // Perform solve L_11^-1
-      host_trsm<T>(SIDE_LEFT, FILL_MODE_LWR, OP_N, DIAG_UNIT,
-            m, n-from, 1.0, diag, lda, &aval[from*lda], lda);
-      // Perform solve D^-T L_21^T
-      for(int i=0; i<m; ) {
-         if(i+1==m || std::isfinite(d[2*i+2])) {
-            // 1x1 pivot
-            T d11 = d[2*i];
-            if(d11 == 0.0) {
-               // Handle zero pivots carefully
-               for(int j=from; j<n; j++) {
-                  T v = aval[j*lda+i];
-                  aval[j*lda+i] =
-                     (fabs(v)<small) ? 0.0 // *v handles NaNs
-                                     : std::numeric_limits<T>::infinity()*v;
-                  // NB: *v above handles NaNs correctly
-               }
-            } else {
-               // Non-zero pivot, apply in normal fashion
-               for(int j=from; j<n; j++) {
-                  aval[j*lda+i] *= d11;
-               }
-            }
-            i++;
-         } else {
-            // 2x2 pivot
-            T d11 = d[2*i];
-            T d21 = d[2*i+1];
-            T d22 = d[2*i+3];
-            for(int j=from; j<n; j++) {
-               T a1 = aval[j*lda+i];
-               T a2 = aval[j*lda+(i+1)];
-               aval[j*lda+i]     = d11*a1 + d21*a2;
-               aval[j*lda+(i+1)] = d21*a1 + d22*a2;
-            }
-            i += 2;
-         }
-      }
-   }
-}
-
 /** \brief Stores backups of matrix blocks using a complete copy of matrix.
  *  \details Note that whilst a complete copy of matrix is allocated, copies
  *           of blocks are still stored individually to facilitate cache
@@ -460,6 +366,11 @@ public:
       }
    }
 
+   /** \brief Return peak memory in bytes held for backups */
+   size_t get_peak_mem() const {
+      return n_*ldcopy_*sizeof(T);
+   }
+
    /** \brief Release memory associated with backup of given block.
     *  \details Provided for compatability with PoolBackup, this
     *           routine is a no-op for CopyBackup.
@@ -597,9 +508,11 @@ private:
 };
 
 /** \brief Stores backups of matrix blocks using a pool of memory.
- *  \details The pool is not necessarily as large as the full matrix, so in
- *  some cases allocation will have to wait until a block is released by
- *  another task. In this case, OpenMP taskyield is used.
+ *  \details Only the blocks touched by passes still in progress are stored,
+ *  and each is released as soon as it has been restored (or found not to
+ *  need restoring). If the pool is exhausted, further blocks are allocated
+ *  individually and freed on release, so the pool may be of any size: with
+ *  no pool at all, every block is allocated lazily.
  *  \tparam T underlying data type, e.g. double
  *  \tparam Allocator allocator to use when allocating memory
  */
@@ -607,28 +520,61 @@ template <typename T, typename Allocator=std::allocator<T*>>
 class PoolBackup {
    //! \{
    typedef typename std::allocator_traits<Allocator>::template rebind_alloc<T*> TptrAlloc;
+   typedef typename std::allocator_traits<Allocator>::template rebind_traits<T> TTraits;
    //! \}
 public:
+   // \{
+   PoolBackup(PoolBackup const&) =delete;
+   PoolBackup& operator=(PoolBackup const&) =delete;
+   // \}
    /** \brief Constructor
     *  \param m number of rows in matrix
     *  \param n number of blocks in matrix
     *  \param block_size dimension of a block in rows or columns
     *  \param alloc allocator instance to use when allocating memory
+    *  \param pool_blocks number of blocks in pool, or -1 for the default
+    *         of enough for two passes (each of which stores a block row and
+    *         column of the matrix, mblk blocks in all).
     */
-   // FIXME: reduce pool size
-   PoolBackup(int m, int n, int block_size, Allocator const& alloc=Allocator())
+   PoolBackup(int m, int n, int block_size, Allocator const& alloc=Allocator(), int pool_blocks=-1)
    : m_(m), n_(n), block_size_(block_size), mblk_(calc_nblk(m,block_size)),
-     pool_(calc_nblk(n,block_size)*((calc_nblk(n,block_size)+1)/2+mblk_), block_size, alloc),
+     alloc_(alloc),
+     pool_((pool_blocks<0) ? default_pool_blocks(m, n, block_size)
+                           : pool_blocks, block_size, alloc),
      ptr_(mblk_*calc_nblk(n,block_size), alloc)
    {}
+   ~PoolBackup() {
+      // Free any blocks not released due to an error
+      for(size_t k=0; k<ptr_.size(); ++k)
+         if(ptr_[k]) free_block(k%mblk_, k/mblk_, ptr_[k]);
+   }
+
+   /** \brief Return number of blocks in a pool of default size */
+   static int default_pool_blocks(int m, int n, int block_size) {
+      int mblk = calc_nblk(m, block_size);
+      return std::min(2*mblk, mblk*calc_nblk(n, block_size));
+   }
+
+   /** \brief Release all associated memory.
+    *  \details Provided for compatability with CopyBackup, this routine is
+    *           a no-op for PoolBackup: blocks are returned as they are
+    *           released, and the pool is freed on destruction.
+    */
+   void release_all_memory() { /* no-op */ }
+
+   /** \brief Return peak memory in bytes held for backups */
+   size_t get_peak_mem() const {
+      return pool_.get_mem() + peak_extra_;
+   }
 
    /** \brief Release memory associated with backup of given block.
     *  \param iblk row index of block.
     *  \param jblk column index of block.
     */
    void release(int iblk, int jblk) {
-      pool_.release(ptr_[jblk*mblk_+iblk]);
-      ptr_[jblk*mblk_+iblk] = nullptr;
+      T*& lwork = ptr_[jblk*mblk_+iblk];
+      if(lwork) free_block(iblk, jblk, lwork);
+      lwork = nullptr;
    }
 
    /** \brief Create a restore point for the given block.
@@ -639,10 +585,11 @@ public:
     */
    void create_restore_point(int iblk, int jblk, T const* aval, int lda) {
       T*& lwork = ptr_[jblk*mblk_+iblk];
-      lwork = pool_.get_wait();
+      lwork = get_block(iblk, jblk);
+      int ld = get_ld(iblk, lwork);
       for(int j=0; j<get_ncol(jblk); j++)
       for(int i=0; i<get_nrow(iblk); i++)
-         lwork[j*block_size_+i] = aval[j*lda+i];
+         lwork[j*ld+i] = aval[j*lda+i];
    }
 
    /** \brief Apply row permutation to block and create a restore point.
@@ -659,19 +606,20 @@ public:
    void create_restore_point_with_row_perm(int iblk, int jblk, int nperm,
          int const* perm, T* aval, int lda) {
       T*& lwork = ptr_[jblk*mblk_+iblk];
-      lwork = pool_.get_wait();
+      lwork = get_block(iblk, jblk);
+      int ld = get_ld(iblk, lwork);
       for(int j=0; j<get_ncol(jblk); j++) {
          for(int i=0; i<nperm; i++) {
             int r = perm[i];
-            lwork[j*block_size_+i] = aval[j*lda+r];
+            lwork[j*ld+i] = aval[j*lda+r];
          }
          for(int i=nperm; i<get_nrow(iblk); i++) {
-            lwork[j*block_size_+i] = aval[j*lda+i];
+            lwork[j*ld+i] = aval[j*lda+i];
          }
       }
       for(int j=0; j<get_ncol(jblk); j++)
       for(int i=0; i<nperm; i++)
-         aval[j*lda+i] = lwork[j*block_size_+i];
+         aval[j*lda+i] = lwork[j*ld+i];
    }
 
    /** \brief Apply column permutation to block and create a restore point.
@@ -687,15 +635,16 @@ public:
    void create_restore_point_with_col_perm(int iblk, int jblk,
          int const* perm, T* aval, int lda) {
       T*& lwork = ptr_[jblk*mblk_+iblk];
-      lwork = pool_.get_wait();
+      lwork = get_block(iblk, jblk);
+      int ld = get_ld(iblk, lwork);
       for(int j=0; j<get_ncol(jblk); j++) {
          int c = perm[j];
          for(int i=0; i<get_nrow(iblk); i++)
-            lwork[j*block_size_+i] = aval[c*lda+i];
+            lwork[j*ld+i] = aval[c*lda+i];
       }
       for(int j=0; j<get_ncol(jblk); j++)
       for(int i=0; i<get_nrow(iblk); i++)
-         aval[j*lda+i] = lwork[j*block_size_+i];
+         aval[j*lda+i] = lwork[j*ld+i];
    }
 
    /** \brief Restore submatrix (rfrom:, cfrom:) of block from backup.
@@ -708,9 +657,10 @@ public:
     */
    void restore_part(int iblk, int jblk, int rfrom, int cfrom, T* aval, int lda) {
       T*& lwork = ptr_[jblk*mblk_+iblk];
+      int ld = get_ld(iblk, lwork);
       for(int j=cfrom; j<get_ncol(jblk); j++)
       for(int i=rfrom; i<get_nrow(iblk); i++)
-         aval[j*lda+i] = lwork[j*block_size_+i];
+         aval[j*lda+i] = lwork[j*ld+i];
    }
 
    /** \brief Restore submatrix (from:, from:) from a symmetric permutation of
@@ -729,25 +679,53 @@ public:
    void restore_part_with_sym_perm(int iblk, int jblk, int from,
          int const* perm, T* aval, int lda) {
       T*& lwork = ptr_[jblk*mblk_+iblk];
+      int ld = get_ld(iblk, lwork);
       for(int j=from; j<get_ncol(jblk); j++) {
          int c = perm[j];
          for(int i=from; i<get_ncol(jblk); i++) {
             int r = perm[i];
-            aval[j*lda+i] = (r>c) ? lwork[c*block_size_+r]
-                                  : lwork[r*block_size_+c];
+            aval[j*lda+i] = (r>c) ? lwork[c*ld+r]
+                                  : lwork[r*ld+c];
          }
          for(int i=get_ncol(jblk); i<get_nrow(iblk); i++)
-            aval[j*lda+i] = lwork[c*block_size_+i];
+            aval[j*lda+i] = lwork[c*ld+i];
       }
    }
 
 private:
+   /** \brief return storage for backup of given block from the pool, or
+    *         allocate it if the pool is empty */
+   T* get_block(int iblk, int jblk) {
+      T* ptr = pool_.get_nowait();
+      if(ptr) return ptr;
+      size_t sz = get_nrow(iblk)*get_ncol(jblk);
+      ptr = TTraits::allocate(alloc_, sz);
+      size_t extra = (cur_extra_ += sz*sizeof(T));
+      size_t peak = peak_extra_.load();
+      while(extra > peak && !peak_extra_.compare_exchange_weak(peak, extra));
+      return ptr;
+   }
+   /** \brief return storage from get_block() to the pool, or free it if it
+    *         was allocated */
+   void free_block(int iblk, int jblk, T* ptr) {
+      if(pool_.owns(ptr)) {
+         pool_.release(ptr);
+      } else {
+         size_t sz = get_nrow(iblk)*get_ncol(jblk);
+         TTraits::deallocate(alloc_, ptr, sz);
+         cur_extra_ -= sz*sizeof(T);
+      }
+   }
+   /** \brief return leading dimension of storage from get_block() */
+   inline int get_ld(int iblk, T const* ptr) const {
+      return (pool_.owns(ptr)) ? block_size_ : get_nrow(iblk);
+   }
    /** \brief return number of columns in given block column */
-   inline int get_ncol(int blk) {
+   inline int get_ncol(int blk) const {
       return calc_blkn(blk, n_, block_size_);
    }
    /** \brief return number of rows in given block row */
-   inline int get_nrow(int blk) {
+   inline int get_nrow(int blk) const {
       return calc_blkn(blk, m_, block_size_);
    }
 
@@ -755,8 +733,11 @@ private:
    int const n_; ///< number of columns in main matrix
    int const block_size_; ///< block size of main matrix
    int const mblk_; ///< number of block rows in main matrix
+   typename TTraits::allocator_type alloc_; ///< allocator for extra blocks
    BlockPool<T, Allocator> pool_; ///< pool of blocks
    std::vector<T*, TptrAlloc> ptr_; ///< map from pointer matrix entry to block
+   std::atomic<size_t> cur_extra_{0}; ///< bytes of blocks outside pool
+   std::atomic<size_t> peak_extra_{0}; ///< peak of cur_extra_
 };
 
 template<typename T,
@@ -1012,7 +993,7 @@ public:
             T* ld = work[omp_get_thread_num()].get_ptr<T>(
                   INNER_BLOCK_SIZE*INNER_BLOCK_SIZE
                   );
-            block_ldlt<T, INNER_BLOCK_SIZE>(
+            dispatch_block_ldlt<T, INNER_BLOCK_SIZE>(
                   0, blkperm, aval_, lda_, cdata_[i_].d, ld, options.action,
                   options.u, options.small, lperm
                   );
@@ -1043,19 +1024,19 @@ public:
       if(i_ == j_)
          throw std::runtime_error("apply_pivot called on diagonal block!");
       if(i_ == dblk.i_) { // Apply within row (ApplyT)
-         apply_pivot<OP_T>(
+         get_simd_kernels<T>().apply_pivot_T(
                cdata_[i_].nelim, ncol(), cdata_[j_].nelim, dblk.aval_,
                cdata_[i_].d, small, aval_, lda_
                );
-         return check_threshold<OP_T>(
+         return get_simd_kernels<T>().check_threshold_T(
                0, cdata_[i_].nelim, cdata_[j_].nelim, ncol(), u, aval_, lda_
                );
       } else if(j_ == dblk.j_) { // Apply within column (ApplyN)
-         apply_pivot<OP_N>(
+         get_simd_kernels<T>().apply_pivot_N(
                nrow(), cdata_[j_].nelim, 0, dblk.aval_,
                cdata_[j_].d, small, aval_, lda_
                );
-         return check_threshold<OP_N>(
+         return get_simd_kernels<T>().check_threshold_N(
                0, nrow(), 0, cdata_[j_].nelim, u, aval_, lda_
                );
       } else {
@@ -1090,7 +1071,7 @@ public:
          int ldld = align_lda<T>(block_size_);
          T* ld = work.get_ptr<T>(block_size_*ldld);
          // NB: we use ld[rfrom] below so alignment matches that of aval[rfrom]
-         calcLD<OP_N>(
+         get_simd_kernels<T>().calcLD_N(
                nrow()-rfrom, cdata_[elim_col].nelim, &isrc.aval_[rfrom],
                lda_, cdata_[elim_col].d, &ld[rfrom], ldld
                );
@@ -1132,13 +1113,13 @@ public:
          T* ld = work.get_ptr<T>(block_size_*ldld);
          // NB: we use ld[rfrom] below so alignment matches that of aval[rfrom]
          if(isrc.j_==elim_col) {
-            calcLD<OP_N>(
+            get_simd_kernels<T>().calcLD_N(
                   nrow()-rfrom, cdata_[elim_col].nelim,
                   &isrc.aval_[rfrom], lda_,
                   cdata_[elim_col].d, &ld[rfrom], ldld
                   );
          } else {
-            calcLD<OP_T>(
+            get_simd_kernels<T>().calcLD_T(
                   nrow()-rfrom, cdata_[elim_col].nelim, &
                   isrc.aval_[rfrom*lda_], lda_,
                   cdata_[elim_col].d, &ld[rfrom], ldld
@@ -1171,7 +1152,7 @@ public:
       int elim_col = isrc.j_;
       int ldld = align_lda<T>(block_size_);
       T* ld = work.get_ptr<T>(block_size_*ldld);
-      calcLD<OP_N>(
+      get_simd_kernels<T>().calcLD_N(
             nrow(), cdata_[elim_col].nelim, isrc.aval_, lda_,
             cdata_[elim_col].d, ld, ldld
             );
@@ -1280,6 +1261,10 @@ private:
       int const nblk = calc_nblk(n, block_size);
       int const mblk = calc_nblk(m, block_size);
       //printf("ENTRY PIV %d %d vis %d %d %d\n", m, n, mblk, nblk, block_size);
+      int const diag_priority =
+         task_priority(TASK_PRIORITY_DIAG, options.cpu_lookahead);
+      int const panel_priority =
+         task_priority(TASK_PRIORITY_PANEL, options.cpu_lookahead);
 
       /* Setup */
       int next_elim = from_blk*block_size;
@@ -1305,7 +1290,8 @@ private:
             shared(a, abort, perm, backup, cdata, next_elim, d,   \
                    options, work, alloc, flag)                    \
             depend(inout: a[blk*block_size*lda+blk*block_size:1]) \
-            depend(inout: perm[blk*block_size:1])
+            depend(inout: perm[blk*block_size:1])                 \
+            priority(diag_priority)
          {
            bool my_abort;
            #pragma omp atomic read
@@ -1366,10 +1352,11 @@ private:
          for(int jblk = 0; jblk < blk; jblk++) {
             #pragma omp task                                          \
                firstprivate(blk, jblk)                                \
-               shared(a, abort, backup, cdata, options)               \
+               shared(a, abort, backup, cdata, options, flag)         \
                depend(in: a[blk*block_size*lda+blk*block_size:1])     \
                depend(inout: a[jblk*block_size*lda+blk*block_size:1]) \
-               depend(in: perm[blk*block_size:1])
+               depend(in: perm[blk*block_size:1])                     \
+               priority(panel_priority)
             {
               bool my_abort;
               #pragma omp atomic read
@@ -1380,17 +1367,29 @@ private:
                 Profile::Task task("TA_LDLT_APPLY");
 #endif
                 if (debug) printf("ApplyT(%d,%d)\n", blk, jblk);
-                BlockSpec dblk(blk, blk, m, n, cdata, a, lda, block_size);
-                BlockSpec cblk(blk, jblk, m, n, cdata, a, lda, block_size);
-                // Apply row permutation from factorization of dblk and in
-                // the process, store a (permuted) copy for recovery in case of
-                // a failed column
-                cblk.apply_rperm_and_backup(backup);
-                // Perform elimination and determine number of rows in block
-                // passing a posteori threshold pivot test
-                int blkpass = cblk.apply_pivot_app(dblk, options.u, options.small);
-                // Update column's passed pivot count
-                cdata[blk].update_passed(blkpass);
+                try {
+                  BlockSpec dblk(blk, blk, m, n, cdata, a, lda, block_size);
+                  BlockSpec cblk(blk, jblk, m, n, cdata, a, lda, block_size);
+                  // Apply row permutation from factorization of dblk and
+                  // in the process, store a (permuted) copy for recovery in
+                  // case of a failed column
+                  cblk.apply_rperm_and_backup(backup);
+                  // Perform elimination and determine number of rows in block
+                  // passing a posteori threshold pivot test
+                  int blkpass = cblk.apply_pivot_app(dblk, options.u, options.small);
+                  // Update column's passed pivot count
+                  cdata[blk].update_passed(blkpass);
+                } catch(std::bad_alloc const&) {
+                  #pragma omp atomic write
+                  flag = Flag::ERROR_ALLOCATION;
+#ifdef _OPENMP
+                  #pragma omp atomic write
+                  abort = true;
+                  #pragma omp cancel taskgroup
+#else
+                  return flag;
+#endif /* _OPENMP */
+                }
 #ifdef PROFILE
                 task.done();
 #endif
@@ -1399,10 +1398,11 @@ private:
          for (int iblk = blk + 1; iblk < mblk; iblk++) {
             #pragma omp task                                          \
                firstprivate(blk, iblk)                                \
-               shared(a, abort, backup, cdata, options)               \
+               shared(a, abort, backup, cdata, options, flag)         \
                depend(in: a[blk*block_size*lda+blk*block_size:1])     \
                depend(inout: a[blk*block_size*lda+iblk*block_size:1]) \
-               depend(in: perm[blk*block_size:1])
+               depend(in: perm[blk*block_size:1])                     \
+               priority(panel_priority)
             {
               bool my_abort;
               #pragma omp atomic read
@@ -1413,17 +1413,29 @@ private:
                 Profile::Task task("TA_LDLT_APPLY");
 #endif
                 if (debug) printf("ApplyN(%d,%d)\n", iblk, blk);
-                BlockSpec dblk(blk, blk, m, n, cdata, a, lda, block_size);
-                BlockSpec rblk(iblk, blk, m, n, cdata, a, lda, block_size);
-                // Apply column permutation from factorization of dblk and in
-                // the process, store a (permuted) copy for recovery in case of
-                // a failed column
-                rblk.apply_cperm_and_backup(backup);
-                // Perform elimination and determine number of rows in block
-                // passing a posteori threshold pivot test
-                int blkpass = rblk.apply_pivot_app(dblk, options.u, options.small);
-                // Update column's passed pivot count
-                cdata[blk].update_passed(blkpass);
+                try {
+                  BlockSpec dblk(blk, blk, m, n, cdata, a, lda, block_size);
+                  BlockSpec rblk(iblk, blk, m, n, cdata, a, lda, block_size);
+                  // Apply column permutation from factorization of dblk and
+                  // in the process, store a (permuted) copy for recovery in
+                  // case of a failed column
+                  rblk.apply_cperm_and_backup(backup);
+                  // Perform elimination and determine number of rows in block
+                  // passing a posteori threshold pivot test
+                  int blkpass = rblk.apply_pivot_app(dblk, options.u, options.small);
+                  // Update column's passed pivot count
+                  cdata[blk].update_passed(blkpass);
+                } catch(std::bad_alloc const&) {
+                  #pragma omp atomic write
+                  flag = Flag::ERROR_ALLOCATION;
+#ifdef _OPENMP
+                  #pragma omp atomic write
+                  abort = true;
+                  #pragma omp cancel taskgroup
+#else
+                  return flag;
+#endif /* _OPENMP */
+                }
 #ifdef PROFILE
                 task.done();
 #endif
@@ -1435,7 +1447,8 @@ private:
          #pragma omp task default(none)           \
             firstprivate(blk)                     \
             shared(abort, cdata, next_elim)       \
-            depend(inout: perm[blk*block_size:1])
+            depend(inout: perm[blk*block_size:1]) \
+            priority(panel_priority)
          {
            bool my_abort;
            #pragma omp atomic read
@@ -1465,7 +1478,8 @@ private:
                   depend(inout: a[jblk*block_size*lda+iblk*block_size:1]) \
                   depend(in: perm[blk*block_size:1])                      \
                   depend(in: a[jblk*block_size*lda+blk*block_size:1])     \
-                  depend(in: a[adep_idx:1])
+                  depend(in: a[adep_idx:1])                               \
+                  priority(update_priority(blk, iblk, options.cpu_lookahead))
                {
                  bool my_abort;
                  #pragma omp atomic read
@@ -1502,7 +1516,8 @@ private:
                   depend(inout: a[jblk*block_size*lda+iblk*block_size:1]) \
                   depend(in: perm[blk*block_size:1])                      \
                   depend(in: a[blk*block_size*lda+iblk*block_size:1])     \
-                  depend(in: a[blk*block_size*lda+jblk*block_size:1])
+                  depend(in: a[blk*block_size*lda+jblk*block_size:1])     \
+                  priority(update_priority(blk, jblk, options.cpu_lookahead))
                {
                  bool my_abort;
                  #pragma omp atomic read
@@ -1738,6 +1753,10 @@ private:
       int const nblk = calc_nblk(n, block_size);
       int const mblk = calc_nblk(m, block_size);
       //printf("ENTRY %d %d vis %d %d %d\n", m, n, mblk, nblk, block_size);
+      int const diag_priority =
+         task_priority(TASK_PRIORITY_DIAG, options.cpu_lookahead);
+      int const panel_priority =
+         task_priority(TASK_PRIORITY_PANEL, options.cpu_lookahead);
 
       /* Setup */
       int next_elim = 0;
@@ -1757,11 +1776,12 @@ private:
          }*/
 
          // Factor diagonal
-         #pragma omp task                                       \
-            firstprivate(blk)                                   \
-            shared(a, abort, perm, backup, cdata, next_elim, d, \
-                   options, work, alloc, up_to_date, flag)      \
-            depend(inout: a[blk*block_size*lda+blk*block_size:1])
+         #pragma omp task                                         \
+            firstprivate(blk)                                     \
+            shared(a, abort, perm, backup, cdata, next_elim, d,   \
+                   options, work, alloc, up_to_date, flag)        \
+            depend(inout: a[blk*block_size*lda+blk*block_size:1]) \
+            priority(diag_priority)
          {
            bool my_abort;
            #pragma omp atomic read
@@ -1826,7 +1846,8 @@ private:
                firstprivate(blk, jblk)                                    \
                shared(a, abort, backup, cdata, options, work, up_to_date) \
                depend(in: a[blk*block_size*lda+blk*block_size:1])         \
-               depend(inout: a[jblk*block_size*lda+blk*block_size:1])
+               depend(inout: a[jblk*block_size*lda+blk*block_size:1])     \
+               priority(panel_priority)
             {
               bool my_abort;
               #pragma omp atomic read
@@ -1856,7 +1877,8 @@ private:
                firstprivate(blk, iblk)                                    \
                shared(a, abort, backup, cdata, options, work, up_to_date) \
                depend(in: a[blk*block_size*lda+blk*block_size:1])         \
-               depend(inout: a[blk*block_size*lda+iblk*block_size:1])
+               depend(inout: a[blk*block_size*lda+iblk*block_size:1])     \
+               priority(panel_priority)
             {
               bool my_abort;
               #pragma omp atomic read
@@ -1905,7 +1927,8 @@ private:
                   shared(a, abort, cdata, backup, work, upd, up_to_date)  \
                   depend(inout: a[jblk*block_size*lda+iblk*block_size:1]) \
                   depend(in: a[blk*block_size*lda+iblk*block_size:1])     \
-                  depend(in: a[blk*block_size*lda+jblk*block_size:1])
+                  depend(in: a[blk*block_size*lda+jblk*block_size:1])     \
+                  priority(update_priority(blk, jblk, options.cpu_lookahead))
                {
                  bool my_abort;
                  #pragma omp atomic read
@@ -2492,9 +2515,9 @@ using namespace spral::ssids::cpu::ldlt_app_internal;
 
 template<typename T>
 size_t ldlt_app_factor_mem_required(int m, int n, int block_size) {
-#if defined(__AVX512F__)
+#if defined(__AVX512F__) || defined(HAVE_AVX512_KERNELS)
   int const align = 64;
-#elif defined(__AVX__)
+#elif defined(__AVX__) || defined(HAVE_AVX2_KERNELS)
   int const align = 32;
 #else
   int const align = 16;
@@ -2502,51 +2525,143 @@ size_t ldlt_app_factor_mem_required(int m, int n, int block_size) {
    return align_lda<T>(m) * n * sizeof(T) + align; // CopyBackup
 }
 
-template<typename T, typename Allocator>
-int ldlt_app_factor(int m, int n, int* perm, T* a, int lda, T* d, T beta, T* upd, int ldupd, struct cpu_factor_options const& options, std::vector<Workspace>& work, Allocator const& alloc) {
-   // If we've got a tall and narrow node, adjust block size so each block
-   // has roughly blksz**2 entries
-   // FIXME: Decide if this reshape is actually useful, given it will generate
-   //        a lot more update tasks instead?
-   int outer_block_size = options.cpu_block_size;
-   /*if(n < outer_block_size) {
-       outer_block_size = int((int64_t(outer_block_size)*outer_block_size) / n);
-   }*/
+/** \brief Choose how ldlt_app_factor() backs up blocks.
+ *  \details A full copy (CopyBackup) is simplest, but doubles the memory
+ *  and memory traffic of the front, while only the block row and column of
+ *  the passes in progress need be held. So, unless the pivot method needs
+ *  every block backed up (app_aggressive), a pool of blocks (PoolBackup) is
+ *  used once the front is so wide that the copy would be more than twice the
+ *  size of the pool. If even the pool does not fit in the memory available,
+ *  blocks are allocated lazily, as they are backed up.
+ *  \param m number of rows in matrix
+ *  \param n number of columns in matrix
+ *  \param block_size outer block size
+ *  \param pivot_method pivot method to be used
+ *  \param max_mem memory in bytes available for backups
+ */
+BackupMethod ldlt_app_backup_method(int m, int n, int block_size,
+      PivotMethod pivot_method, size_t max_mem) {
+   if(pivot_method == PivotMethod::app_aggressive)
+      return BackupMethod::copy; // Any block may need to be restored
+   size_t copy_mem = ldlt_app_backup_mem(BackupMethod::copy, m, n, block_size);
+   size_t pool_mem = ldlt_app_backup_mem(BackupMethod::pool, m, n, block_size);
+   if(copy_mem <= max_mem && copy_mem <= 2*pool_mem)
+      return BackupMethod::copy;
+   if(pool_mem <= max_mem)
+      return BackupMethod::pool;
+   return BackupMethod::lazy;
+}
 
-#ifdef PROFILE
-   Profile::setState("TA_MISC1");
-#endif
+/** \brief Return memory in bytes allocated up front for backups by given
+ *         method (lazy backups allocate each block as required) */
+size_t ldlt_app_backup_mem(BackupMethod method, int m, int n, int block_size) {
+   switch(method) {
+   case BackupMethod::copy:
+      return align_lda<double>(m) * n * sizeof(double);
+   case BackupMethod::pool:
+      return PoolBackup<double>::default_pool_blocks(m, n, block_size)
+         * block_size * block_size * sizeof(double);
+   default:
+      return 0;
+   }
+}
 
-   // Template parameters and workspaces
-   bool const debug = false;
-   //PoolBackup<T, Allocator> backup(m, n, outer_block_size, alloc);
-   CopyBackup<T, Allocator> backup(m, n, outer_block_size, alloc);
+/** \brief Return bytes per block column of the column data allocated by
+ *         ldlt_app_factor(), in addition to a block of the local
+ *         permutation */
+template <typename T>
+size_t ldlt_app_column_data_bytes() {
+   return sizeof(Column<T>);
+}
+template size_t ldlt_app_column_data_bytes<double>();
 
-   // Actual call
+namespace {
+
+/** \brief Perform factorization using given type of backup */
+template<typename T, typename Backup, typename Allocator>
+int ldlt_app_factor_backup(int m, int n, int* perm, T* a, int lda, T* d,
+      T beta, T* upd, int ldupd, struct cpu_factor_options const& options,
+      std::vector<Workspace>& work, Allocator const& alloc,
+      int outer_block_size, Backup& backup, size_t& backup_mem) {
+   bool const debug = false;
    bool const use_tasks = true;
-   return LDLT
-      <T, INNER_BLOCK_SIZE, CopyBackup<T,Allocator>, use_tasks, debug,
-       Allocator>
+   int nelim = LDLT
+      <T, INNER_BLOCK_SIZE, Backup, use_tasks, debug, Allocator>
       ::factor(
             m, n, perm, a, lda, d, backup, options, options.pivot_method,
             outer_block_size, beta, upd, ldupd, work, alloc
             );
+   backup_mem = backup.get_peak_mem();
+   return nelim;
+}
+
+} /* anon namespace */
+
+template<typename T, typename Allocator>
+int ldlt_app_factor(int m, int n, int* perm, T* a, int lda, T* d, T beta, T* upd, int ldupd, struct cpu_factor_options const& options, std::vector<Workspace>& work, Allocator const& alloc, size_t max_backup, size_t& backup_mem) {
+   // NB: blocks are square, so there is no reshaping of tall and narrow
+   // nodes as in cholesky_factor(): it would only generate more update tasks
+   int outer_block_size = get_block_size(m, options);
+
+#ifdef PROFILE
+   Profile::setState("TA_MISC1");
+   Profile::addBlockSizeEvent(m, n, outer_block_size);
+#endif
+
+   // Choose backup and perform actual call
+   BackupMethod method = ldlt_app_backup_method(m, n, outer_block_size,
+         options.pivot_method, max_backup);
+   int nelim;
+   switch(method) {
+   case BackupMethod::copy: {
+      CopyBackup<T, Allocator> backup(m, n, outer_block_size, alloc);
+      nelim = ldlt_app_factor_backup(m, n, perm, a, lda, d, beta, upd, ldupd,
+            options, work, alloc, outer_block_size, backup, backup_mem);
+      break;
+   }
+   case BackupMethod::pool: {
+      PoolBackup<T, Allocator> backup(m, n, outer_block_size, alloc);
+      nelim = ldlt_app_factor_backup(m, n, perm, a, lda, d, beta, upd, ldupd,
+            options, work, alloc, outer_block_size, backup, backup_mem);
+      break;
+   }
+   default: { // BackupMethod::lazy
+      PoolBackup<T, Allocator> backup(m, n, outer_block_size, alloc, 0);
+      nelim = ldlt_app_factor_backup(m, n, perm, a, lda, d, beta, upd, ldupd,
+            options, work, alloc, outer_block_size, backup, backup_mem);
+      break;
+   }
+   }
+
+#ifdef PROFILE
+   char const* method_name[] = { "copy", "pool", "lazy" };
+   Profile::addBackupEvent(m, n, method_name[static_cast<int>(method)],
+         backup_mem);
+#endif
+
+   return nelim;
 }
-template int ldlt_app_factor<double, BuddyAllocator<double,std::allocator<double>>>(int, int, int*, double*, int, double*, double, double*, int, struct cpu_factor_options const&, std::vector<Workspace>&, BuddyAllocator<double,std::allocator<double>> const& alloc);
+template int ldlt_app_factor<double, BuddyAllocator<double,std::allocator<double>>>(int, int, int*, double*, int, double*, double, double*, int, struct cpu_factor_options const&, std::vector<Workspace>&, BuddyAllocator<double,std::allocator<double>> const& alloc, size_t, size_t&);
+template int ldlt_app_factor<double, ThreadCacheAllocator<double,std::allocator<double>>>(int, int, int*, double*, int, double*, double, double*, int, struct cpu_factor_options const&, std::vector<Workspace>&, ThreadCacheAllocator<double,std::allocator<double>> const& alloc, size_t, size_t&);
+template int ldlt_app_factor<double, ThreadCacheAllocator<double,SystemAllocator<double>>>(int, int, int*, double*, int, double*, double, double*, int, struct cpu_factor_options const&, std::vector<Workspace>&, ThreadCacheAllocator<double,SystemAllocator<double>> const& alloc, size_t, size_t&);
 
 template <typename T>
 void ldlt_app_solve_fwd(int m, int n, T const* l, int ldl, int nrhs, T* x, int ldx) {
-   if(nrhs==1) {
-      host_trsv(FILL_MODE_LWR, OP_N, DIAG_UNIT, n, l, ldl, x, 1);
+   if(use_small_solve(m, n, nrhs)) {
+      // Avoid BLAS call overhead for small problems
+      small_solve_fwd<T, true>(m, n, l, ldl, nrhs, x, ldx);
+   } else if(nrhs==1) {
+      host_trsv<T>(FILL_MODE_LWR, OP_N, DIAG_UNIT, n, l, ldl, x, 1);
       if(m > n)
-         gemv(OP_N, m-n, n, -1.0, &l[n], ldl, x, 1, 1.0, &x[n], 1);
+         gemv<T>(OP_N, m-n, n, -1.0, &l[n], ldl, x, 1, 1.0, &x[n], 1);
    } else {
-      host_trsm(SIDE_LEFT, FILL_MODE_LWR, OP_N, DIAG_UNIT, n, nrhs, 1.0, l, ldl, x, ldx);
+      host_trsm<T>(SIDE_LEFT, FILL_MODE_LWR, OP_N, DIAG_UNIT, n, nrhs, 1.0, l, ldl, x, ldx);
       if(m > n)
-         host_gemm(OP_N, OP_N, m-n, nrhs, n, -1.0, &l[n], ldl, x, ldx, 1.0, &x[n], ldx);
+         host_gemm<T>(OP_N, OP_N, m-n, nrhs, n, -1.0, &l[n], ldl, x, ldx, 1.0, &x[n], ldx);
    }
 }
 template void ldlt_app_solve_fwd<double>(int, int, double const*, int, int, double*, int);
+template void ldlt_app_solve_fwd<float>(int, int, float const*, int, int, float*, int);
 
 template <typename T>
 void ldlt_app_solve_diag(int n, T const* d, int nrhs, T* x, int ldx) {
@@ -2573,19 +2688,24 @@ void ldlt_app_solve_diag(int n, T const* d, int nrhs, T* x, int ldx) {
    }
 }
 template void ldlt_app_solve_diag<double>(int, double const*, int, double*, int);
+template void ldlt_app_solve_diag<float>(int, float const*, int, float*, int);
 
 template <typename T>
 void ldlt_app_solve_bwd(int m, int n, T const* l, int ldl, int nrhs, T* x, int ldx) {
-   if(nrhs==1) {
+   if(use_small_solve(m, n, nrhs)) {
+      // Avoid BLAS call overhead for small problems
+      small_solve_bwd<T, true>(m, n, l, ldl, nrhs, x, ldx);
+   } else if(nrhs==1) {
       if(m > n)
-         gemv(OP_T, m-n, n, -1.0, &l[n], ldl, &x[n], 1, 1.0, x, 1);
-      host_trsv(FILL_MODE_LWR, OP_T, DIAG_UNIT, n, l, ldl, x, 1);
+         gemv<T>(OP_T, m-n, n, -1.0, &l[n], ldl, &x[n], 1, 1.0, x, 1);
+      host_trsv<T>(FILL_MODE_LWR, OP_T, DIAG_UNIT, n, l, ldl, x, 1);
    } else {
       if(m > n)
-         host_gemm(OP_T, OP_N, n, nrhs, m-n, -1.0, &l[n], ldl, &x[n], ldx, 1.0, x, ldx);
-      host_trsm(SIDE_LEFT, FILL_MODE_LWR, OP_T, DIAG_UNIT, n, nrhs, 1.0, l, ldl, x, ldx);
+         host_gemm<T>(OP_T, OP_N, n, nrhs, m-n, -1.0, &l[n], ldl, &x[n], ldx, 1.0, x, ldx);
+      host_trsm<T>(SIDE_LEFT, FILL_MODE_LWR, OP_T, DIAG_UNIT, n, nrhs, 1.0, l, ldl, x, ldx);
    }
 }
 template void ldlt_app_solve_bwd<double>(int, int, double const*, int, int, double*, int);
+template void ldlt_app_solve_bwd<float>(int, int, float const*, int, int, float*, int);
 
 }}} /* namespaces spral::ssids::cpu */
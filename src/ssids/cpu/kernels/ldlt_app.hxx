@@ -5,14 +5,34 @@
  */
 #pragma once
 
+#include <cstddef>
 #include <vector>
 
+#include "ssids/cpu/cpu_iface.hxx"
 #include "ssids/cpu/Workspace.hxx"
 
 namespace spral { namespace ssids { namespace cpu {
 
+/** Inner block size of ldlt_app_factor(), to which each diagonal block of
+ *  the outer block size is recursively factorized */
+const int LDLT_APP_INNER_BLOCK_SIZE = 32;
+
+/** \brief How ldlt_app_factor() backs up blocks so that they can be restored
+ *         if their pivots fail. */
+enum struct BackupMethod : int {
+   copy, ///< Copy of whole matrix, allocated up front
+   pool, ///< Pool of blocks sized for two passes, extended on demand
+   lazy  ///< Each block allocated when backed up and freed once done with
+};
+
+BackupMethod ldlt_app_backup_method(int m, int n, int block_size,
+      PivotMethod pivot_method, size_t max_mem);
+size_t ldlt_app_backup_mem(BackupMethod method, int m, int n, int block_size);
+template <typename T>
+size_t ldlt_app_column_data_bytes();
+
 template<typename T, typename Allocator>
-int ldlt_app_factor(int m, int n, int *perm, T *a, int lda, T *d, T beta, T* upd, int ldupd, struct cpu_factor_options const& options, std::vector<Workspace>& work, Allocator const& alloc);
+int ldlt_app_factor(int m, int n, int *perm, T *a, int lda, T *d, T beta, T* upd, int ldupd, struct cpu_factor_options const& options, std::vector<Workspace>& work, Allocator const& alloc, size_t max_backup, size_t& backup_mem);
 
 template <typename T>
 void ldlt_app_solve_fwd(int m, int n, T const* l, int ldl, int nrhs, T* x, int ldx);
@@ -0,0 +1,182 @@
+/** \file
+ *  \copyright 2016 The Science and Technology Facilities Council (STFC)
+ *  \licence   BSD licence, see LICENCE file for details
+ *  \author    Jonathan Hogg
+ */
+#include "ssids/cpu/kernels/ldlt_refactor.hxx"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "ssids/cpu/cpu_iface.hxx"
+#include "ssids/cpu/kernels/common.hxx"
+#include "ssids/cpu/kernels/simd_kernels.hxx"
+#include "ssids/cpu/kernels/wrappers.hxx"
+
+namespace spral { namespace ssids { namespace cpu {
+
+namespace {
+
+/** Number of columns factorized before the trailing matrix is updated */
+const int REFACTOR_BLOCK_SIZE = 32;
+
+/** Applies the 1x1 pivot in column j to the rest of the block column
+ *  [j, kend), preserving the original column in ld.
+ *  Returns false if the pivot is small or fails the threshold test. */
+bool apply_1x1(int j, int kend, int m, double* a, int lda, double* d,
+      double* ld, double maxl, double small) {
+   double* a1 = &a[j*lda];
+   double a11 = a1[j];
+   if(!(fabs(a11) >= small)) return false;
+   double d11 = 1/a11;
+   d[2*j] = d11;
+   d[2*j+1] = 0.0;
+   a1[j] = 1.0;
+   for(int r=j+1; r<m; ++r) {
+      ld[r] = a1[r];
+      a1[r] *= d11;
+      if(!(fabs(a1[r]) <= maxl)) return false;
+   }
+   for(int c=j+1; c<kend; ++c) {
+      double* ac = &a[c*lda];
+      double f = ld[c];
+      for(int r=c; r<m; ++r)
+         ac[r] -= a1[r]*f;
+   }
+   return true;
+}
+
+/** Applies the 2x2 pivot in columns (j,j+1) to the rest of the block column
+ *  [j, kend), preserving the original columns in ld.
+ *  Returns false if the pivot is (near) singular or fails the threshold
+ *  test. The singularity tests match those of ldlt_tpp_factor(). */
+bool apply_2x2(int j, int kend, int m, double* a, int lda, double* d,
+      double* ld, int ldld, double maxl, double small) {
+   double* a1 = &a[j*lda];
+   double* a2 = &a[(j+1)*lda];
+   double a11 = a1[j];
+   double a21 = a1[j+1];
+   double a22 = a2[j+1];
+   double maxpiv = std::max(fabs(a11), std::max(fabs(a21), fabs(a22)));
+   if(!(maxpiv >= small)) return false;
+   double detscale = 1/maxpiv;
+   double detpiv0 = (a11*detscale)*a22;
+   double detpiv1 = (a21*detscale)*a21;
+   double detpiv = detpiv0 - detpiv1;
+   if(!(fabs(detpiv) >=
+            std::max(small, std::max(fabs(detpiv0/2), fabs(detpiv1/2)))))
+      return false;
+   double d11 = (a22*detscale)/detpiv;
+   double d21 = (-a21*detscale)/detpiv;
+   double d22 = (a11*detscale)/detpiv;
+   d[2*j] = d11;
+   d[2*j+1] = d21;
+   d[2*j+2] = std::numeric_limits<double>::infinity();
+   d[2*j+3] = d22;
+   a1[j] = 1.0;
+   a1[j+1] = 0.0;
+   a2[j+1] = 1.0;
+   double* ld1 = ld;
+   double* ld2 = &ld[ldld];
+   for(int r=j+2; r<m; ++r) {
+      ld1[r] = a1[r]; ld2[r] = a2[r];
+      a1[r] = d11*ld1[r] + d21*ld2[r];
+      a2[r] = d21*ld1[r] + d22*ld2[r];
+      if(!(std::max(fabs(a1[r]), fabs(a2[r])) <= maxl)) return false;
+   }
+   for(int c=j+2; c<kend; ++c) {
+      double* ac = &a[c*lda];
+      double f1 = ld1[c];
+      double f2 = ld2[c];
+      for(int r=c; r<m; ++r)
+         ac[r] -= a1[r]*f1 + a2[r]*f2;
+   }
+   return true;
+}
+
+} /* anon namespace */
+
+/** \brief LDL^T factorization using a known pivot sequence.
+ *
+ *  Eliminates the first nelim columns of the m x n lower trapezoidal matrix
+ *  a in order, without any pivot search, using the 1x1 and 2x2 pivot
+ *  structure described by d. This is intended for refactorization of a
+ *  matrix whose values have changed only slightly since a factorization
+ *  that determined the pivot sequence (and that has been symmetrically
+ *  permuted into that order). Every entry of L is checked against the
+ *  threshold 1/u, so that the result is as stable as that of the original
+ *  threshold pivoting.
+ *
+ *  On success, a and d hold the factors in the same format as
+ *  ldlt_tpp_factor(), columns nelim to n-1 hold their Schur complement and
+ *  upd is overwritten with \f$ -L_{21} D L_{21}^T \f$, where \f$ L_{21} \f$
+ *  is rows n to m-1 of the eliminated columns. On failure a, d and upd are
+ *  left in an undefined state and the caller must restore them before
+ *  trying an alternative.
+ *
+ *  \param m Number of rows in a.
+ *  \param n Number of columns in a.
+ *  \param nelim Number of columns to eliminate, nelim <= n.
+ *  \param a Matrix to factorize, lower triangle only.
+ *  \param lda Leading dimension of a.
+ *  \param d Array of length 2*n. On entry d[2*i+2] must be infinite if
+ *         columns i and i+1 (i < nelim-1) form a 2x2 pivot, and finite
+ *         otherwise. On exit holds \f$ D^{-1} \f$.
+ *  \param u Pivot threshold.
+ *  \param small Pivots smaller than this in absolute value are rejected.
+ *  \param upd Contribution block of size (m-n) x (m-n).
+ *  \param ldupd Leading dimension of upd.
+ *  \param work Workspace.
+ *  \returns true if all pivots were accepted, false otherwise.
+ */
+bool ldlt_refactor_factor(int m, int n, int nelim, double* a, int lda,
+      double* d, double u, double small, double* upd, int ldupd,
+      Workspace& work) {
+   int const nb = REFACTOR_BLOCK_SIZE;
+   int ldld = align_lda<double>(m);
+   double* ld = work.get_ptr<double>(ldld*(nb+1));
+   double maxl = 1.0/u;
+   for(int k=0; k<nelim; ) {
+      /* Determine block column, without splitting a 2x2 pivot */
+      int kend = std::min(k+nb, nelim);
+      if(kend<nelim && std::isinf(d[2*kend])) kend++;
+
+      /* Factorize block column */
+      for(int j=k; j<kend; ) {
+         if(j+1<kend && std::isinf(d[2*j+2])) {
+            if(!apply_2x2(j, kend, m, a, lda, d, ld, ldld, maxl, small))
+               return false;
+            j += 2;
+         } else {
+            if(!apply_1x1(j, kend, m, a, lda, d, ld, maxl, small))
+               return false;
+            j += 1;
+         }
+      }
+
+      /* Update trailing columns of a and the contribution block */
+      int p = kend - k;
+      if(m > kend) {
+         get_simd_kernels<double>().calcLD_N(
+               m-kend, p, &a[k*lda+kend], lda, &d[2*k], ld, ldld
+               );
+         for(int c=kend; c<n; c+=nb) {
+            int cend = std::min(c+nb, n);
+            host_gemm<double>(OP_N, OP_T, m-c, cend-c, p,
+                  -1.0, &ld[c-kend], ldld, &a[k*lda+c], lda,
+                  1.0, &a[c*lda+c], lda);
+         }
+         if(m > n) {
+            double rbeta = (k==0) ? 0.0 : 1.0;
+            host_gemm<double>(OP_N, OP_T, m-n, m-n, p,
+                  -1.0, &ld[n-kend], ldld, &a[k*lda+n], lda,
+                  rbeta, upd, ldupd);
+         }
+      }
+      k = kend;
+   }
+   return true;
+}
+
+}}} /* end of namespace spral::ssids::cpu */
@@ -0,0 +1,16 @@
+/** \file
+ *  \copyright 2016 The Science and Technology Facilities Council (STFC)
+ *  \licence   BSD licence, see LICENCE file for details
+ *  \author    Jonathan Hogg
+ */
+#pragma once
+
+#include "ssids/cpu/Workspace.hxx"
+
+namespace spral { namespace ssids { namespace cpu {
+
+bool ldlt_refactor_factor(int m, int n, int nelim, double* a, int lda,
+      double* d, double u, double small, double* upd, int ldupd,
+      Workspace& work);
+
+}}} /* end of namespace spral::ssids::cpu */
@@ -159,6 +159,30 @@ void zero_col(int col, int m, double* a, int lda) {
    }
 }
 
+/** Tile size of the tasks applying a panel's pivots to the trailing matrix */
+int const TASK_BLOCK_SIZE = 256;
+
+/** Applies pivots kb:nelim-1 to columns from:n-1 of the trailing matrix.
+ *  Column k-kb of ld holds L*D for pivot k, indexed by row of a. The update
+ *  is split into tiles that are performed as OpenMP tasks. */
+void update_trailing(int m, int n, int from, int kb, int nelim, double* a,
+      int lda, double const* ld, int ldld) {
+   int npiv = nelim - kb;
+   if(npiv==0 || from>=n) return;
+   #pragma omp taskgroup
+   for(int j=from; j<n; j+=TASK_BLOCK_SIZE) {
+      int blkn = std::min(TASK_BLOCK_SIZE, n-j);
+      for(int i=j; i<m; i+=TASK_BLOCK_SIZE) {
+         int blkm = std::min(TASK_BLOCK_SIZE, m-i);
+         #pragma omp task default(none) \
+            firstprivate(i, j, blkm, blkn) \
+            shared(a, lda, ld, ldld, kb, npiv)
+         host_gemm(OP_N, OP_T, blkm, blkn, npiv, -1.0, &a[kb*lda+i], lda,
+               &ld[j], ldld, 1.0, &a[j*lda+i], lda);
+      }
+   }
+}
+
 } /* anon namespace */
 
 /** Simple LDL^T with threshold partial pivoting.
@@ -269,6 +293,136 @@ int ldlt_tpp_factor(int m, int n, int* perm, double* a, int lda, double* d,
    return nelim;
 }
 
+/** Blocked LDL^T with threshold partial pivoting.
+ *
+ * Performs the same pivot search as ldlt_tpp_factor(), but only keeps a
+ * panel of (at least) nb columns up to date. Each pivot is applied
+ * immediately to the panel only: as the full row/col of each candidate
+ * pivot lies within the panel, the pivot tests see the values they would in
+ * the unblocked code, up to rounding in columns updated while outside the
+ * panel. The same pivots are hence chosen unless a test is decided by
+ * rounding, as on the dependent columns of a singular matrix. Once nb-1
+ * pivots have been found, or the panel has been eliminated, they are
+ * applied to the trailing matrix by BLAS3 updates performed as OpenMP
+ * tasks. If the pivot search reaches the end of the panel without success,
+ * the panel is widened by nb columns and the search continues.
+ *
+ * Arguments are as ldlt_tpp_factor(), except ld must have space for nb
+ * columns of length ldld (nb>=2). Small matrices (n<=nb) are passed
+ * straight to ldlt_tpp_factor().
+ */
+int ldlt_tpp_factor_blocked(int m, int n, int* perm, double* a, int lda,
+      double* d, double* ld, int ldld, int nb, bool action, double u,
+      double small, int nleft, double* aleft, int ldleft) {
+   if(n <= nb)
+      return ldlt_tpp_factor(m, n, perm, a, lda, d, ld, ldld, action, u,
+            small, nleft, aleft, ldleft);
+
+   int nelim = 0; // Number of eliminated variables
+   int kb = 0; // First pivot not yet applied to trailing matrix
+   int blkend = nb; // Columns nelim:blkend-1 form the up to date panel
+   while(nelim<n) {
+      double* ldk = &ld[(nelim-kb)*ldld]; // L*D for next pivot
+      // Need to check if col nelim is zero now or it gets missed
+      if(check_col_small(nelim, nelim, m, a, lda, small)) {
+         // Record zero pivot
+         if(!action) throw SingularError(nelim);
+         zero_col(nelim, m, a, lda);
+         for(int r=nelim; r<m; ++r) ldk[r] = 0.0;
+         d[2*nelim] = 0.0;
+         d[2*nelim+1] = 0.0;
+         nelim++;
+      } else {
+         bool found = false;
+         int p = nelim+1; // Index of current candidate pivot
+         while(true) {
+            for(; p<blkend; ++p) {
+               // Check if column p is effectively zero
+               if(check_col_small(p, nelim, m, a, lda, small)) {
+                  // Record zero pivot
+                  if(!action) throw SingularError(nelim);
+                  swap_cols(p, nelim, m, n, perm, a, lda, nleft, aleft, ldleft);
+                  zero_col(nelim, m, a, lda);
+                  for(int r=nelim; r<m; ++r) ldk[r] = 0.0;
+                  d[2*nelim] = 0.0;
+                  d[2*nelim+1] = 0.0;
+                  nelim++;
+                  found = true;
+                  break;
+               }
+
+               // Find column index of largest entry in |a(p, nelim+1:p-1)|
+               int t = find_row_abs_max(nelim, p, &a[p], lda);
+
+               // Try (t,p) as 2x2 pivot
+               double maxt = find_rc_abs_max_exclude(t, nelim, m, a, lda, p);
+               double maxp = find_rc_abs_max_exclude(p, nelim, m, a, lda, t);
+               if( test_2x2(t, p, maxt, maxp, a, lda, u, small, &d[2*nelim]) ) {
+                  swap_cols(t, nelim, m, n, perm, a, lda, nleft, aleft, ldleft);
+                  swap_cols(p, nelim+1, m, n, perm, a, lda, nleft, aleft, ldleft);
+                  apply_2x2(nelim, m, a, lda, ldk, ldld, d);
+                  host_gemm(OP_N, OP_T, m-nelim-2, blkend-nelim-2, 2, -1.0,
+                        &a[nelim*lda+nelim+2], lda, &ldk[nelim+2], ldld,
+                        1.0, &a[(nelim+2)*lda+nelim+2], lda); // update panel
+                  nelim += 2;
+                  found = true;
+                  break;
+               }
+
+               // Try p as 1x1 pivot
+               maxp = std::max(maxp, fabs(a[t*lda+p]));
+               if( fabs(a[p*lda+p]) >= u*maxp ) {
+                  swap_cols(p, nelim, m, n, perm, a, lda, nleft, aleft, ldleft);
+                  d[2*nelim] = 1 / a[nelim*lda+nelim];
+                  d[2*nelim+1] = 0.0;
+                  apply_1x1(nelim, m, a, lda, ldk, ldld, d);
+                  host_gemm(OP_N, OP_T, m-nelim-1, blkend-nelim-1, 1, -1.0,
+                        &a[nelim*lda+nelim+1], lda, &ldk[nelim+1], ldld,
+                        1.0, &a[(nelim+1)*lda+nelim+1], lda); // update panel
+                  nelim += 1;
+                  found = true;
+                  break;
+               }
+            }
+            if(found || blkend==n) break;
+            // Widen panel so search can continue into trailing matrix
+            update_trailing(m, n, blkend, kb, nelim, a, lda, ld, ldld);
+            kb = nelim;
+            ldk = ld;
+            blkend = std::min(n, blkend+nb);
+         }
+         if(!found) {
+            // Pivot search failed
+
+            // Try 1x1 pivot on p=nelim as last resort (we started at p=nelim+1)
+            p = nelim;
+            double maxp = find_rc_abs_max_exclude(p, nelim, m, a, lda, -1);
+            if( fabs(a[p*lda+p]) >= u*maxp ) {
+               d[2*nelim] = 1 / a[nelim*lda+nelim];
+               d[2*nelim+1] = 0.0;
+               apply_1x1(nelim, m, a, lda, ldk, ldld, d);
+               host_gemm(OP_N, OP_T, m-nelim-1, blkend-nelim-1, 1, -1.0,
+                     &a[nelim*lda+nelim+1], lda, &ldk[nelim+1], ldld,
+                     1.0, &a[(nelim+1)*lda+nelim+1], lda); // update panel
+               nelim += 1;
+            } else {
+               // That didn't work either. No more pivots to be found
+               break;
+            }
+         }
+      }
+      // Start a new panel if this one is eliminated or ld is nearly full
+      if(nelim >= blkend || nelim-kb+2 > nb) {
+         update_trailing(m, n, blkend, kb, nelim, a, lda, ld, ldld);
+         kb = nelim;
+         blkend = std::min(n, nelim+nb);
+      }
+   }
+   // Apply any outstanding pivots, so uneliminated columns are up to date
+   update_trailing(m, n, blkend, kb, nelim, a, lda, ld, ldld);
+   return nelim;
+}
+
 void ldlt_tpp_solve_fwd(int m, int n, double const* l, int ldl, int nrhs, double* x, int ldx) {
    if(nrhs==1) {
       host_trsv(FILL_MODE_LWR, OP_N, DIAG_UNIT, n, l, ldl, x, 1);
@@ -7,9 +7,15 @@
 
 namespace spral { namespace ssids { namespace cpu {
 
+/** Panel width used by callers of ldlt_tpp_factor_blocked() */
+const int TPP_BLOCK_SIZE = 32;
+
 int ldlt_tpp_factor(int m, int n, int* perm, double* a, int lda, double* d,
       double* ld, int ldld, bool action, double u, double small,
       int nleft=0, double *aleft=nullptr, int ldleft=0);
+int ldlt_tpp_factor_blocked(int m, int n, int* perm, double* a, int lda,
+      double* d, double* ld, int ldld, int nb, bool action, double u,
+      double small, int nleft=0, double *aleft=nullptr, int ldleft=0);
 void ldlt_tpp_solve_fwd(int m, int n, double const* l, int ldl, int nrhs, double* x, int ldx);
 void ldlt_tpp_solve_diag(int n, double const* d, double* x);
 void ldlt_tpp_solve_bwd(int m, int n, double const* l, int ldl, int nrhs, double* x, int ldx);
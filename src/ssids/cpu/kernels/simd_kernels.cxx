@@ -0,0 +1,92 @@
+/** \file
+ *  \copyright 2016 The Science and Technology Facilities Council (STFC)
+ *  \licence   BSD licence, see LICENCE file for details
+ *  \author    Jonathan Hogg
+ *
+ *  \brief Kernels compiled with the default flags, and runtime selection
+ *  between these and those in simd_kernels_*.cxx.
+ */
+#include "ssids/cpu/kernels/simd_kernels.hxx"
+
+#include "config.h"
+#include "ssids/cpu/kernels/simd_kernels_impl.hxx"
+
+namespace spral { namespace ssids { namespace cpu {
+
+namespace simd_kernels_internal {
+
+#ifdef HAVE_AVX2_KERNELS
+SimdKernels<double> const& get_avx2_kernels(); // simd_kernels_avx2.cxx
+#endif /* HAVE_AVX2_KERNELS */
+#ifdef HAVE_AVX512_KERNELS
+SimdKernels<double> const& get_avx512_kernels(); // simd_kernels_avx512.cxx
+#endif /* HAVE_AVX512_KERNELS */
+
+/** Return kernels compiled with the library's default flags */
+SimdKernels<double> const& get_default_kernels() {
+   static const SimdKernels<double> kernels = make_simd_kernels<double>();
+   return kernels;
+}
+
+/** Return true if the running CPU (and OS) supports the given instruction
+ *  set. */
+bool cpu_supports(enum cpu_arch arch) {
+   if(arch == CPU_BEST_ARCH) return true; // Assume default flags are ok
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+   // NB: __builtin_cpu_supports() uses cpuid, and also checks via xgetbv
+   // that the OS saves the relevant registers on a context switch.
+   __builtin_cpu_init();
+   switch(arch) {
+      case CPU_ARCH_AVX:
+         return __builtin_cpu_supports("avx");
+      case CPU_ARCH_AVX2:
+         return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+      case CPU_ARCH_AVX512:
+         return __builtin_cpu_supports("avx512f");
+      default:
+         return false;
+   }
+#else
+   return false;
+#endif
+}
+
+/** Select the best kernels available at runtime */
+SimdKernels<double> const& select_kernels() {
+   // Instruction sets we may have additional kernels for, best first
+   const enum cpu_arch preference[] = { CPU_ARCH_AVX512, CPU_ARCH_AVX2 };
+   for(auto arch : preference) {
+      if(arch <= CPU_BEST_ARCH) break; // Default is at least as good
+      SimdKernels<double> const* kernels = get_simd_kernels(arch);
+      if(kernels) return *kernels;
+   }
+   return get_default_kernels();
+}
+
+} /* namespace simd_kernels_internal */
+
+using namespace simd_kernels_internal;
+
+SimdKernels<double> const* get_simd_kernels(enum cpu_arch arch) {
+   SimdKernels<double> const* kernels = nullptr;
+   if(arch == CPU_BEST_ARCH) kernels = &get_default_kernels();
+#ifdef HAVE_AVX2_KERNELS
+   else if(arch == CPU_ARCH_AVX2) kernels = &get_avx2_kernels();
+#endif /* HAVE_AVX2_KERNELS */
+#ifdef HAVE_AVX512_KERNELS
+   else if(arch == CPU_ARCH_AVX512) kernels = &get_avx512_kernels();
+#endif /* HAVE_AVX512_KERNELS */
+   // NB: if the default flags already imply a better instruction set, the
+   // additional kernels get compiled for that instead, so check arch.
+   if(kernels && (kernels->arch != arch || !cpu_supports(arch)))
+      return nullptr;
+   return kernels;
+}
+
+template <>
+SimdKernels<double> const& get_simd_kernels<double>() {
+   static SimdKernels<double> const& kernels = select_kernels();
+   return kernels;
+}
+
+}}} /* namespaces spral::ssids::cpu */
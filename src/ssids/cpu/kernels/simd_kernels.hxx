@@ -0,0 +1,79 @@
+/** \file
+ *  \copyright 2016 The Science and Technology Facilities Council (STFC)
+ *  \licence   BSD licence, see LICENCE file for details
+ *  \author    Jonathan Hogg
+ *
+ *  \brief Runtime selection of SIMD kernels.
+ *
+ *  The hot kernels that use SimdVec are compiled once with the flags the
+ *  library was configured with, and again for each additional instruction
+ *  set that configure found the compiler supports (AVX2+FMA, AVX-512F on
+ *  x86-64). The first call to get_simd_kernels() uses cpuid to pick the best
+ *  of these the running CPU supports, so a portable build still makes use of
+ *  wider vectors where available.
+ *
+ *  NB: All memory handed to these kernels must be aligned for the widest
+ *  instruction set that may be selected. The allocators and align_lda()
+ *  use HAVE_AVX512_KERNELS and HAVE_AVX2_KERNELS from config.h to ensure
+ *  this.
+ */
+#pragma once
+
+#include "ssids/cpu/kernels/common.hxx"
+
+namespace spral { namespace ssids { namespace cpu {
+
+/** Block size of block_ldlt() kernel in SimdKernels::block_ldlt */
+const int SIMD_KERNELS_BLOCK_SIZE = 32;
+
+/** Shortest run of consecutive indices that SimdKernels::asm_col adds as
+ *  a contiguous block (at least the widest vector length) */
+const int ASM_COL_MIN_RUN = 8;
+
+/** \brief Table of kernels compiled for a single instruction set.
+ *
+ *  See the corresponding templates for a description of each kernel:
+ *  block_ldlt() in block_ldlt.hxx, calcLD() in calc_ld.hxx,
+ *  apply_pivot() and check_threshold() in apply_pivot.hxx, and
+ *  asm_col() in asm_col.hxx.
+ */
+template <typename T>
+struct SimdKernels {
+   enum cpu_arch arch; ///< Instruction set kernels were compiled for
+   /** block_ldlt<T, SIMD_KERNELS_BLOCK_SIZE>() */
+   void (*block_ldlt)(int from, int* perm, T* a, int lda, T* d, T* ldwork,
+         bool action, T u, T small, int* lperm);
+   void (*calcLD_N)(int m, int n, T const* l, int ldl, T const* d, T* ld,
+         int ldld); ///< calcLD<OP_N>()
+   void (*calcLD_T)(int m, int n, T const* l, int ldl, T const* d, T* ld,
+         int ldld); ///< calcLD<OP_T>()
+   void (*apply_pivot_N)(int m, int n, int from, T const* diag, T const* d,
+         T small, T* aval, int lda); ///< apply_pivot<OP_N>()
+   void (*apply_pivot_T)(int m, int n, int from, T const* diag, T const* d,
+         T small, T* aval, int lda); ///< apply_pivot<OP_T>()
+   int (*check_threshold_N)(int rfrom, int rto, int cfrom, int cto, T u,
+         T* aval, int lda); ///< check_threshold<OP_N>()
+   int (*check_threshold_T)(int rfrom, int rto, int cfrom, int cto, T u,
+         T* aval, int lda); ///< check_threshold<OP_T>()
+   void (*asm_col)(int n, int const* idx, int const* run, T const* src,
+         T* dest); ///< asm_col()
+};
+
+/** \brief Return kernels for the best instruction set supported by both this
+ *  build and the CPU we are running on.
+ *
+ *  The selection is made on the first call and cached thereafter.
+ */
+template <typename T>
+SimdKernels<T> const& get_simd_kernels();
+template <>
+SimdKernels<double> const& get_simd_kernels<double>();
+
+/** \brief Return kernels for a specific instruction set, or nullptr if they
+ *  were not built or the running CPU does not support them.
+ *
+ *  Primarily intended for testing.
+ */
+SimdKernels<double> const* get_simd_kernels(enum cpu_arch arch);
+
+}}} /* namespaces spral::ssids::cpu */
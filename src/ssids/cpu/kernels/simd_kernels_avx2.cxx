@@ -0,0 +1,26 @@
+/** \file
+ *  \copyright 2016 The Science and Technology Facilities Council (STFC)
+ *  \licence   BSD licence, see LICENCE file for details
+ *  \author    Jonathan Hogg
+ *
+ *  \brief Kernels compiled for AVX2 and FMA.
+ *
+ *  This file is compiled with -mavx2 -mfma (see Makefile.am), and the result
+ *  is only used if the running CPU supports it (see simd_kernels.cxx).
+ */
+#ifndef __AVX2__
+#error "simd_kernels_avx2.cxx must be compiled with -mavx2 -mfma"
+#endif
+
+#include "ssids/cpu/kernels/simd_kernels_impl.hxx"
+
+namespace spral { namespace ssids { namespace cpu {
+namespace simd_kernels_internal {
+
+SimdKernels<double> const& get_avx2_kernels() {
+   static const SimdKernels<double> kernels = make_simd_kernels<double>();
+   return kernels;
+}
+
+} /* namespace simd_kernels_internal */
+}}} /* namespaces spral::ssids::cpu */
@@ -0,0 +1,26 @@
+/** \file
+ *  \copyright 2016 The Science and Technology Facilities Council (STFC)
+ *  \licence   BSD licence, see LICENCE file for details
+ *  \author    Jonathan Hogg
+ *
+ *  \brief Kernels compiled for AVX-512F.
+ *
+ *  This file is compiled with -mavx512f (see Makefile.am), and the result
+ *  is only used if the running CPU supports it (see simd_kernels.cxx).
+ */
+#ifndef __AVX512F__
+#error "simd_kernels_avx512.cxx must be compiled with -mavx512f"
+#endif
+
+#include "ssids/cpu/kernels/simd_kernels_impl.hxx"
+
+namespace spral { namespace ssids { namespace cpu {
+namespace simd_kernels_internal {
+
+SimdKernels<double> const& get_avx512_kernels() {
+   static const SimdKernels<double> kernels = make_simd_kernels<double>();
+   return kernels;
+}
+
+} /* namespace simd_kernels_internal */
+}}} /* namespaces spral::ssids::cpu */
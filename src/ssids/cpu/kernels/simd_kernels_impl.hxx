@@ -0,0 +1,39 @@
+/** \file
+ *  \copyright 2016 The Science and Technology Facilities Council (STFC)
+ *  \licence   BSD licence, see LICENCE file for details
+ *  \author    Jonathan Hogg
+ *
+ *  \brief Construction of a SimdKernels table for the instruction set the
+ *  including translation unit is compiled for.
+ *
+ *  Only to be included by simd_kernels*.cxx.
+ */
+#pragma once
+
+#include "ssids/cpu/kernels/simd_kernels.hxx"
+#include "ssids/cpu/kernels/apply_pivot.hxx"
+#include "ssids/cpu/kernels/asm_col.hxx"
+#include "ssids/cpu/kernels/block_ldlt.hxx"
+#include "ssids/cpu/kernels/calc_ld.hxx"
+
+namespace spral { namespace ssids { namespace cpu {
+inline namespace SPRAL_CPU_ARCH_NS {
+
+/** Return table of kernels compiled for CPU_BEST_ARCH */
+template <typename T>
+SimdKernels<T> make_simd_kernels() {
+   SimdKernels<T> kernels;
+   kernels.arch = CPU_BEST_ARCH;
+   kernels.block_ldlt = &block_ldlt<T, SIMD_KERNELS_BLOCK_SIZE>;
+   kernels.calcLD_N = &calcLD<OP_N, T>;
+   kernels.calcLD_T = &calcLD<OP_T, T>;
+   kernels.apply_pivot_N = &apply_pivot<OP_N, T>;
+   kernels.apply_pivot_T = &apply_pivot<OP_T, T>;
+   kernels.check_threshold_N = &check_threshold<OP_N, T>;
+   kernels.check_threshold_T = &check_threshold<OP_T, T>;
+   kernels.asm_col = &asm_col<T>;
+   return kernels;
+}
+
+} /* inline namespace SPRAL_CPU_ARCH_NS */
+}}} /* namespaces spral::ssids::cpu */
@@ -0,0 +1,185 @@
+/** \file
+ *  \copyright 2016 The Science and Technology Facilities Council (STFC)
+ *  \licence   BSD licence, see LICENCE file for details
+ *  \author    Jonathan Hogg
+ *
+ *  \brief Triangular solve kernels for small fronts and few right-hand sides.
+ *
+ *  For small fronts the overhead of calling BLAS trsm/gemm (or trsv/gemv)
+ *  dominates the arithmetic. These kernels instead perform the triangular and
+ *  rectangular parts of the solve in a single pass over L, vectorized down
+ *  the columns of L using SimdVec and register-tiled over blocks of
+ *  right-hand sides so each vector of L is loaded once per block.
+ */
+#pragma once
+
+#include "ssids/cpu/kernels/SimdVec.hxx"
+
+namespace spral { namespace ssids { namespace cpu {
+inline namespace SPRAL_CPU_ARCH_NS {
+
+/** \brief Returns true if small_solve_fwd() and small_solve_bwd() should be
+ *         used in preference to BLAS for a solve of the given size.
+ *
+ *  The crossover was determined with the micro-benchmark in
+ *  tests/ssids/kernels/small_solve.cxx (run "ssids_kernel_test bench"). The
+ *  small kernels win, by a factor of up to 20 for the smallest fronts, while
+ *  the work m*n*nrhs is at most 256, whatever the shape of L. Beyond this,
+ *  BLAS's blocking for cache and registers wins.
+ *
+ *  \param m Number of rows in L.
+ *  \param n Number of columns in L.
+ *  \param nrhs Number of right-hand sides.
+ */
+inline bool use_small_solve(int m, int n, int nrhs) {
+   return (static_cast<long>(m)*n*nrhs <= 256);
+}
+
+namespace small_solve_internal {
+
+/** Forward solve with a block of nb right-hand sides.
+ *  \sa small_solve_fwd() */
+template <typename T, bool unit_diag, int nb>
+void solve_fwd_block(int m, int n, T const* l, int ldl, T* x, int ldx) {
+   typedef SimdVec<T> SimdVecT;
+   int const vlen = SimdVecT::vector_length;
+
+   for(int j=0; j<n; ++j) {
+      T const* lcol = &l[j*ldl];
+      /* Solve with diagonal entry */
+      T negxj[nb];
+      SimdVecT negxjv[nb];
+      for(int k=0; k<nb; ++k) {
+         T xj = x[k*ldx+j];
+         if(!unit_diag) {
+            xj /= lcol[j];
+            x[k*ldx+j] = xj;
+         }
+         negxj[k] = -xj;
+         negxjv[k] = SimdVecT(-xj);
+      }
+      /* Update remainder of x: x(j+1:m) -= l(j+1:m, j) * x(j) */
+      int i = j+1;
+      for(; i+vlen<=m; i+=vlen) {
+         SimdVecT lv = SimdVecT::load_unaligned(&lcol[i]);
+         for(int k=0; k<nb; ++k) {
+            SimdVecT xv = SimdVecT::load_unaligned(&x[k*ldx+i]);
+            xv = fmadd(xv, lv, negxjv[k]);
+            xv.store_unaligned(&x[k*ldx+i]);
+         }
+      }
+      for(; i<m; ++i)
+         for(int k=0; k<nb; ++k)
+            x[k*ldx+i] += lcol[i] * negxj[k];
+   }
+}
+
+/** Backward solve with a block of nb right-hand sides.
+ *  \sa small_solve_bwd() */
+template <typename T, bool unit_diag, int nb>
+void solve_bwd_block(int m, int n, T const* l, int ldl, T* x, int ldx) {
+   typedef SimdVec<T> SimdVecT;
+   int const vlen = SimdVecT::vector_length;
+
+   for(int j=n-1; j>=0; --j) {
+      T const* lcol = &l[j*ldl];
+      /* Form x(j) -= l(j+1:m, j)^T x(j+1:m) */
+      SimdVecT acc[nb];
+      for(int k=0; k<nb; ++k)
+         acc[k] = SimdVecT::zero();
+      int i = j+1;
+      for(; i+vlen<=m; i+=vlen) {
+         SimdVecT lv = SimdVecT::load_unaligned(&lcol[i]);
+         for(int k=0; k<nb; ++k)
+            acc[k] = fmadd(acc[k], lv,
+                  SimdVecT::load_unaligned(&x[k*ldx+i]));
+      }
+      for(int k=0; k<nb; ++k) {
+         T accv[vlen];
+         acc[k].store_unaligned(accv);
+         T sum = 0.0;
+         for(int v=0; v<vlen; ++v)
+            sum += accv[v];
+         for(int ii=i; ii<m; ++ii)
+            sum += lcol[ii] * x[k*ldx+ii];
+         T xj = x[k*ldx+j] - sum;
+         /* Solve with diagonal entry */
+         if(!unit_diag) xj /= lcol[j];
+         x[k*ldx+j] = xj;
+      }
+   }
+}
+
+} /* namespace small_solve_internal */
+
+/** \brief Forward solve with a lower trapezoidal matrix for small fronts.
+ *
+ *  Performs \f$ x_1 = L_{11}^{-1} x_1 \f$ followed by
+ *  \f$ x_2 = x_2 - L_{21} x_1 \f$, where
+ *  \f$ L = \left(\begin{array}{c} L_{11} \\ L_{21} \end{array}\right) \f$
+ *  is m x n. Equivalent to trsm()+gemm(), but faster for small sizes
+ *  (see use_small_solve()).
+ *
+ *  \tparam unit_diag If true, L has an implicit unit diagonal.
+ *  \param m Number of rows in L.
+ *  \param n Number of columns in L.
+ *  \param l Matrix L.
+ *  \param ldl Leading dimension of l.
+ *  \param nrhs Number of right-hand sides.
+ *  \param x Right-hand sides of size m x nrhs, overwritten with solution.
+ *  \param ldx Leading dimension of x.
+ */
+template <typename T, bool unit_diag>
+void small_solve_fwd(int m, int n, T const* l, int ldl, int nrhs, T* x,
+      int ldx) {
+   using namespace small_solve_internal;
+   int const nb = 4; // rhs per block of registers
+   int r = 0;
+   for(; r+nb<=nrhs; r+=nb)
+      solve_fwd_block<T, unit_diag, nb>(m, n, l, ldl, &x[r*ldx], ldx);
+   switch(nrhs-r) {
+      case 3: solve_fwd_block<T, unit_diag, 3>(m, n, l, ldl, &x[r*ldx], ldx);
+              break;
+      case 2: solve_fwd_block<T, unit_diag, 2>(m, n, l, ldl, &x[r*ldx], ldx);
+              break;
+      case 1: solve_fwd_block<T, unit_diag, 1>(m, n, l, ldl, &x[r*ldx], ldx);
+              break;
+   }
+}
+
+/** \brief Backward solve with a lower trapezoidal matrix for small fronts.
+ *
+ *  Performs \f$ x_1 = L_{11}^{-T} (x_1 - L_{21}^T x_2) \f$, where
+ *  \f$ L = \left(\begin{array}{c} L_{11} \\ L_{21} \end{array}\right) \f$
+ *  is m x n. Equivalent to gemm()+trsm(), but faster for small sizes
+ *  (see use_small_solve()).
+ *
+ *  \tparam unit_diag If true, L has an implicit unit diagonal.
+ *  \param m Number of rows in L.
+ *  \param n Number of columns in L.
+ *  \param l Matrix L.
+ *  \param ldl Leading dimension of l.
+ *  \param nrhs Number of right-hand sides.
+ *  \param x Right-hand sides of size m x nrhs, overwritten with solution.
+ *  \param ldx Leading dimension of x.
+ */
+template <typename T, bool unit_diag>
+void small_solve_bwd(int m, int n, T const* l, int ldl, int nrhs, T* x,
+      int ldx) {
+   using namespace small_solve_internal;
+   int const nb = 4; // rhs per block of registers
+   int r = 0;
+   for(; r+nb<=nrhs; r+=nb)
+      solve_bwd_block<T, unit_diag, nb>(m, n, l, ldl, &x[r*ldx], ldx);
+   switch(nrhs-r) {
+      case 3: solve_bwd_block<T, unit_diag, 3>(m, n, l, ldl, &x[r*ldx], ldx);
+              break;
+      case 2: solve_bwd_block<T, unit_diag, 2>(m, n, l, ldl, &x[r*ldx], ldx);
+              break;
+      case 1: solve_bwd_block<T, unit_diag, 1>(m, n, l, ldl, &x[r*ldx], ldx);
+              break;
+   }
+}
+
+} /* inline namespace SPRAL_CPU_ARCH_NS */
+}}} /* namespaces spral::ssids::cpu */
@@ -15,6 +15,10 @@ extern "C" {
    void spral_c_dsyrk(char *uplo, char *trans, int *n, int *k, double *alpha, const double *a, int *lda, double *beta, double *c, int *ldc);
    void spral_c_dtrsv(char *uplo, char *trans, char *diag, int *n, const double *a, int *lda, double *x, int *incx);
    void spral_c_dgemv(char *trans, int *m, int *n, const double* alpha, const double* a, int *lda, const double* x, int* incx, const double* beta, double* y, int* incy);
+   void spral_c_sgemm(char* transa, char* transb, int* m, int* n, int* k, float* alpha, const float* a, int* lda, const float* b, int* ldb, float *beta, float* c, int* ldc);
+   void spral_c_strsm(char *side, char *uplo, char *transa, char *diag, int *m, int *n, const float *alpha, const float *a, int *lda, float *b, int *ldb);
+   void spral_c_strsv(char *uplo, char *trans, char *diag, int *n, const float *a, int *lda, float *x, int *incx);
+   void spral_c_sgemv(char *trans, int *m, int *n, const float* alpha, const float* a, int *lda, const float* x, int* incx, const float* beta, float* y, int* incy);
 }
 
 namespace spral { namespace ssids { namespace cpu {
@@ -26,6 +30,12 @@ void host_gemm<double>(enum spral::ssids::cpu::operation transa, enum spral::ssi
    char ftransb = (transb==spral::ssids::cpu::OP_N) ? 'N' : 'T';
    spral_c_dgemm(&ftransa, &ftransb, &m, &n, &k, &alpha, a, &lda, b, &ldb, &beta, c, &ldc);
 }
+template <>
+void host_gemm<float>(enum spral::ssids::cpu::operation transa, enum spral::ssids::cpu::operation transb, int m, int n, int k, float alpha, const float* a, int lda, const float* b, int ldb, float beta, float* c, int ldc) {
+   char ftransa = (transa==spral::ssids::cpu::OP_N) ? 'N' : 'T';
+   char ftransb = (transb==spral::ssids::cpu::OP_N) ? 'N' : 'T';
+   spral_c_sgemm(&ftransa, &ftransb, &m, &n, &k, &alpha, a, &lda, b, &ldb, &beta, c, &ldc);
+}
 
 /* _GEMV */
 template <>
@@ -33,6 +43,11 @@ void gemv<double>(enum spral::ssids::cpu::operation trans, int m, int n, double
    char ftrans = (trans==spral::ssids::cpu::OP_N) ? 'N' : 'T';
    spral_c_dgemv(&ftrans, &m, &n, &alpha, a, &lda, x, &incx, &beta, y, &incy);
 }
+template <>
+void gemv<float>(enum spral::ssids::cpu::operation trans, int m, int n, float alpha, const float* a, int lda, const float* x, int incx, float beta, float* y, int incy) {
+   char ftrans = (trans==spral::ssids::cpu::OP_N) ? 'N' : 'T';
+   spral_c_sgemv(&ftrans, &m, &n, &alpha, a, &lda, x, &incx, &beta, y, &incy);
+}
 
 /* _POTRF */
 template<>
@@ -78,6 +93,13 @@ void host_trsv<double>(enum spral::ssids::cpu::fillmode uplo, enum spral::ssids:
    char fdiag = (diag==spral::ssids::cpu::DIAG_UNIT) ? 'U' : 'N';
    spral_c_dtrsv(&fuplo, &ftrans, &fdiag, &n, a, &lda, x, &incx);
 }
+template <>
+void host_trsv<float>(enum spral::ssids::cpu::fillmode uplo, enum spral::ssids::cpu::operation trans, enum spral::ssids::cpu::diagonal diag, int n, const float* a, int lda, float* x, int incx) {
+   char fuplo = (uplo==spral::ssids::cpu::FILL_MODE_LWR) ? 'L' : 'U';
+   char ftrans = (trans==spral::ssids::cpu::OP_N) ? 'N' : 'T';
+   char fdiag = (diag==spral::ssids::cpu::DIAG_UNIT) ? 'U' : 'N';
+   spral_c_strsv(&fuplo, &ftrans, &fdiag, &n, a, &lda, x, &incx);
+}
 
 /* _TRSM */
 template <>
@@ -88,5 +110,13 @@ void host_trsm<double>(enum spral::ssids::cpu::side side, enum spral::ssids::cpu
    char fdiag = (diag==spral::ssids::cpu::DIAG_UNIT) ? 'U' : 'N';
    spral_c_dtrsm(&fside, &fuplo, &ftransa, &fdiag, &m, &n, &alpha, a, &lda, b, &ldb);
 }
+template <>
+void host_trsm<float>(enum spral::ssids::cpu::side side, enum spral::ssids::cpu::fillmode uplo, enum spral::ssids::cpu::operation transa, enum spral::ssids::cpu::diagonal diag, int m, int n, float alpha, const float* a, int lda, float* b, int ldb) {
+   char fside = (side==spral::ssids::cpu::SIDE_LEFT) ? 'L' : 'R';
+   char fuplo = (uplo==spral::ssids::cpu::FILL_MODE_LWR) ? 'L' : 'U';
+   char ftransa = (transa==spral::ssids::cpu::OP_N) ? 'N' : 'T';
+   char fdiag = (diag==spral::ssids::cpu::DIAG_UNIT) ? 'U' : 'N';
+   spral_c_strsm(&fside, &fuplo, &ftransa, &fdiag, &m, &n, &alpha, a, &lda, b, &ldb);
+}
 
 }}} /* namespaces spral::ssids::cpu */
@@ -14,10 +14,15 @@ module spral_ssids_cpu_subtree
   private
   public :: cpu_symbolic_subtree, construct_cpu_symbolic_subtree
   public :: cpu_numeric_subtree, cpu_free_contrib
+  public :: cpu_create_memory_budget, cpu_destroy_memory_budget
+  public :: cpu_memory_budget_reset, cpu_memory_budget_peak
 
   type, extends(symbolic_subtree_base) :: cpu_symbolic_subtree
      integer :: n
      type(C_PTR) :: csubtree
+     integer(long) :: relidx_mem = 0 ! bytes used by relative indices
+     integer(long) :: factor_mem = 0 ! predicted bytes for (indefinite) factors
+     integer(long) :: work_mem = 0 ! predicted bytes of workspace per thread
    contains
      procedure :: factor
      procedure :: cleanup => symbolic_cleanup
@@ -36,6 +41,7 @@ module spral_ssids_cpu_subtree
      procedure :: enquire_posdef
      procedure :: enquire_indef
      procedure :: alter
+     procedure :: refactor
      procedure :: cleanup => numeric_cleanup
   end type cpu_numeric_subtree
 
@@ -67,9 +73,32 @@ module spral_ssids_cpu_subtree
        type(C_PTR), value :: subtree
      end subroutine c_destroy_symbolic_subtree
 
+     integer(C_INT64_T) function c_symbolic_subtree_relidx_mem(subtree) &
+          bind(C, name="spral_ssids_cpu_symbolic_subtree_relidx_mem")
+       use, intrinsic :: iso_c_binding
+       implicit none
+       type(C_PTR), value :: subtree
+     end function c_symbolic_subtree_relidx_mem
+
+     integer(C_INT64_T) function c_symbolic_subtree_factor_mem(subtree, &
+          posdef) bind(C, name="spral_ssids_cpu_symbolic_subtree_factor_mem")
+       use, intrinsic :: iso_c_binding
+       implicit none
+       type(C_PTR), value :: subtree
+       logical(C_BOOL), value :: posdef
+     end function c_symbolic_subtree_factor_mem
+
+     integer(C_INT64_T) function c_symbolic_subtree_work_mem(subtree, &
+          posdef) bind(C, name="spral_ssids_cpu_symbolic_subtree_work_mem")
+       use, intrinsic :: iso_c_binding
+       implicit none
+       type(C_PTR), value :: subtree
+       logical(C_BOOL), value :: posdef
+     end function c_symbolic_subtree_work_mem
+
      type(C_PTR) function c_create_numeric_subtree(posdef, symbolic_subtree, &
-          aval, scaling, child_contrib, options, stats) &
-          bind(C, name="spral_ssids_cpu_create_num_subtree_dbl")
+          aval, scaling, child_contrib, options, budget, numa_region, &
+          stats) bind(C, name="spral_ssids_cpu_create_num_subtree_dbl")
        use, intrinsic :: iso_c_binding
        import :: cpu_factor_options, cpu_factor_stats
        implicit none
@@ -79,9 +108,55 @@ module spral_ssids_cpu_subtree
        type(C_PTR), value :: scaling
        type(C_PTR), dimension(*), intent(inout) :: child_contrib
        type(cpu_factor_options), intent(in) :: options
+       type(C_PTR), value :: budget
+       integer(C_INT), value :: numa_region
        type(cpu_factor_stats), intent(out) :: stats
      end function c_create_numeric_subtree
 
+     subroutine c_refactor_numeric_subtree(posdef, subtree, aval, scaling, &
+          child_contrib, options, budget, stats) &
+          bind(C, name="spral_ssids_cpu_refactor_num_subtree_dbl")
+       use, intrinsic :: iso_c_binding
+       import :: cpu_factor_options, cpu_factor_stats
+       implicit none
+       logical(C_BOOL), value :: posdef
+       type(C_PTR), value :: subtree
+       real(C_DOUBLE), dimension(*), intent(in) :: aval
+       type(C_PTR), value :: scaling
+       type(C_PTR), dimension(*), intent(inout) :: child_contrib
+       type(cpu_factor_options), intent(in) :: options
+       type(C_PTR), value :: budget
+       type(cpu_factor_stats), intent(out) :: stats
+     end subroutine c_refactor_numeric_subtree
+
+     type(C_PTR) function cpu_create_memory_budget() &
+          bind(C, name="spral_ssids_cpu_create_memory_budget")
+       use, intrinsic :: iso_c_binding
+       implicit none
+     end function cpu_create_memory_budget
+
+     subroutine cpu_destroy_memory_budget(budget) &
+          bind(C, name="spral_ssids_cpu_destroy_memory_budget")
+       use, intrinsic :: iso_c_binding
+       implicit none
+       type(C_PTR), value :: budget
+     end subroutine cpu_destroy_memory_budget
+
+     subroutine cpu_memory_budget_reset(budget, limit) &
+          bind(C, name="spral_ssids_cpu_memory_budget_reset")
+       use, intrinsic :: iso_c_binding
+       implicit none
+       type(C_PTR), value :: budget
+       integer(C_INT64_T), value :: limit
+     end subroutine cpu_memory_budget_reset
+
+     integer(C_INT64_T) function cpu_memory_budget_peak(budget) &
+          bind(C, name="spral_ssids_cpu_memory_budget_peak")
+       use, intrinsic :: iso_c_binding
+       implicit none
+       type(C_PTR), value :: budget
+     end function cpu_memory_budget_peak
+
      subroutine c_destroy_numeric_subtree(posdef, subtree) &
           bind(C, name="spral_ssids_cpu_destroy_num_subtree_dbl")
        use, intrinsic :: iso_c_binding
@@ -218,6 +293,10 @@ contains
     this%csubtree = &
          c_create_symbolic_subtree(n, sa, en, sptr, sparent, rptr, rlist, nptr, &
          nlist, size(contrib_idx), contrib_idx, coptions)
+    this%relidx_mem = c_symbolic_subtree_relidx_mem(this%csubtree)
+    this%factor_mem = &
+         c_symbolic_subtree_factor_mem(this%csubtree, .false._C_BOOL)
+    this%work_mem = c_symbolic_subtree_work_mem(this%csubtree, .false._C_BOOL)
   end function construct_cpu_symbolic_subtree
 
   subroutine symbolic_cleanup(this)
@@ -227,7 +306,8 @@ contains
     call c_destroy_symbolic_subtree(this%csubtree)
   end subroutine symbolic_cleanup
 
-  function factor(this, posdef, aval, child_contrib, options, inform, scaling)
+  function factor(this, posdef, aval, child_contrib, options, inform, &
+       budget, numa_region, scaling)
     implicit none
     class(numeric_subtree_base), pointer :: factor
     class(cpu_symbolic_subtree), target, intent(inout) :: this
@@ -236,6 +316,8 @@ contains
     type(contrib_type), dimension(:), target, intent(inout) :: child_contrib
     type(ssids_options), intent(in) :: options
     type(ssids_inform), intent(inout) :: inform
+    type(C_PTR), intent(in) :: budget
+    integer, intent(in) :: numa_region
     real(wp), dimension(*), target, optional, intent(in) :: scaling
 
     type(cpu_numeric_subtree), pointer :: cpu_factor
@@ -268,7 +350,8 @@ contains
     call cpu_copy_options_in(options, coptions)
     cpu_factor%csubtree = &
          c_create_numeric_subtree(cpu_factor%posdef, this%csubtree, &
-         aval, cscaling, contrib_ptr, coptions, cstats)
+         aval, cscaling, contrib_ptr, coptions, budget, &
+         int(numa_region, C_INT), cstats)
     if (cstats%flag .lt. 0) then
        call c_destroy_numeric_subtree(cpu_factor%posdef, cpu_factor%csubtree)
        deallocate(cpu_factor, stat=st)
@@ -291,6 +374,61 @@ contains
     return
   end function factor
 
+  logical function refactor(this, symbolic, aval, child_contrib, options, &
+       inform, budget, scaling)
+    implicit none
+    class(cpu_numeric_subtree), target, intent(inout) :: this
+    class(symbolic_subtree_base), target, intent(inout) :: symbolic
+    real(wp), dimension(*), target, intent(in) :: aval
+    type(contrib_type), dimension(:), target, intent(inout) :: child_contrib
+    type(ssids_options), intent(in) :: options
+    type(ssids_inform), intent(inout) :: inform
+    type(C_PTR), intent(in) :: budget
+    real(wp), dimension(*), target, optional, intent(in) :: scaling
+
+    type(cpu_factor_options) :: coptions
+    type(cpu_factor_stats) :: cstats
+    type(C_PTR) :: cscaling
+    integer :: i
+    type(C_PTR), dimension(:), allocatable :: contrib_ptr
+    integer :: st
+
+    ! Only possible if this was factorized from the same symbolic subtree
+    refactor = .false.
+    select type(symbolic)
+    type is (cpu_symbolic_subtree)
+       if (.not. associated(this%symbolic, symbolic)) return
+    class default
+       return
+    end select
+    refactor = .true.
+
+    ! Convert child_contrib to contrib_ptr
+    allocate(contrib_ptr(size(child_contrib)), stat=st)
+    if (st .ne. 0) then
+       inform%flag = SSIDS_ERROR_ALLOCATION
+       inform%stat = st
+       return
+    end if
+    do i = 1, size(child_contrib)
+       contrib_ptr(i) = C_LOC(child_contrib(i))
+    end do
+
+    ! Call C++ refactor routine
+    cscaling = C_NULL_PTR
+    if (present(scaling)) cscaling = C_LOC(scaling)
+    call cpu_copy_options_in(options, coptions)
+    call c_refactor_numeric_subtree(this%posdef, this%csubtree, aval, &
+         cscaling, contrib_ptr, coptions, budget, cstats)
+    if (cstats%flag .lt. 0) then
+       inform%flag = cstats%flag
+       return
+    end if
+
+    ! Extract to Fortran data structures
+    call cpu_copy_stats_out(cstats, inform)
+  end function refactor
+
   subroutine numeric_cleanup(this)
     implicit none
     class(cpu_numeric_subtree), intent(inout) :: this
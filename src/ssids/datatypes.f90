@@ -74,6 +74,15 @@ module spral_ssids_datatypes
   integer, parameter, public :: FAILED_PIVOT_METHOD_TPP    = 1
   integer, parameter, public :: FAILED_PIVOT_METHOD_PASS   = 2
 
+  ! Supernode amalgamation strategies (options%amalg_method)
+  integer, parameter, public :: AMALG_METHOD_NEMIN         = 1
+  integer, parameter, public :: AMALG_METHOD_COST          = 2
+
+  ! NB: the below must match enum HugePages in cpu/cpu_iface.hxx
+  integer, parameter, public :: HUGE_PAGES_NONE            = 0
+  integer, parameter, public :: HUGE_PAGES_TRANSPARENT     = 1
+  integer, parameter, public :: HUGE_PAGES_HUGETLBFS       = 2
+
   !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 
   ! Note: below smalloc etc. types can't be in spral_ssids_alloc module as
@@ -212,6 +221,10 @@ module spral_ssids_datatypes
        ! 2 Matching with METIS on compressed matrix.
      integer :: nemin = nemin_default ! Min. number of eliminations at a tree
        ! node for amalgamation not to be considered.
+     integer :: amalg_method = AMALG_METHOD_NEMIN ! controls amalgamation
+       ! 1 Merge a node with its parent if both have fewer than nemin columns.
+       ! 2 Merge if a model of the factorization time predicts the merged
+       !   node is cheaper than the separate nodes. nemin is ignored.
 
      !
      ! High level subtree splitting parameters
@@ -236,6 +249,13 @@ module spral_ssids_datatypes
        !    2: Matching-based scaling by Auction Algorithm
        !    3: Scaling generated during analyse phase for matching-based order
        !  >=4: Norm equilibriation algorithm (MC77-like)
+     logical :: refactor = .false. ! If true and fkeep holds a factorization
+       ! of the same type for the same akeep, try its pivot sequence first.
+       ! (Its storage is reused regardless.)
+     logical :: compress_factors = .false. ! If true, factors computed in
+       ! double precision on CPU are converted to single precision for the
+       ! solve phase, and ssids_solve() recovers double precision accuracy
+       ! by iterative refinement. Peak factorize memory is not reduced
 
      !
      ! CPU-specific
@@ -243,7 +263,24 @@ module spral_ssids_datatypes
      integer(long) :: small_subtree_threshold = 4*10**6 ! Flops below
        ! which we treat a subtree as small and use the single core kernel
      integer :: cpu_block_size = 256 ! block size to use for task
-       ! generation on larger nodes
+       ! generation on larger nodes. If not positive, chosen for each node
+       ! from its size and the cache size
+     integer :: cpu_lookahead = 1 ! number of block columns after the one
+       ! being eliminated whose updates are prioritized, along with the
+       ! critical path, when scheduling tasks on larger nodes. If negative,
+       ! all tasks have the same priority
+     logical :: store_relidx = .true. ! If true, analyse stores the position
+       ! in its parent of each row of a node's contribution block, so
+       ! factorization need not build a map to assemble it
+     integer(long) :: memory_budget = 0_long ! If positive, limit (bytes)
+       ! on memory held by the contribution block pools on CPU (see
+       ! inform%contrib_peak). Tasks are held back while they might exceed
+       ! it, unless nothing else is running
+     integer :: huge_pages = HUGE_PAGES_NONE ! Back large areas of factor,
+       ! pool and workspace memory on CPU with huge pages:
+       ! 0 - No
+       ! 1 - Transparent huge pages (madvise)
+       ! 2 - Huge page pool (hugetlbfs), falling back to transparent ones
 
      !
      ! Options used by ssids_factor() with posdef=.false.
@@ -316,6 +353,7 @@ contains
     write (mp,'(a,i15)') ' options%unit_error        =  ',this%unit_error
     write (mp,'(a,i15)') ' options%unit_warning      =  ',this%unit_warning
     write (mp,'(a,i15)') ' options%nemin             =  ',this%nemin
+    write (mp,'(a,i15)') ' options%amalg_method      =  ',this%amalg_method
     write (mp,'(a,i15)') ' options%ordering          =  ',this%ordering
   end subroutine print_summary_analyse
 
@@ -369,6 +407,9 @@ contains
             ' multiplier          Multiplier for increasing array sizes  = ', &
             this%multiplier
     end if
+    write (this%unit_diagnostics,'(a,l12)') &
+         ' refactor            Reuse previous factorization if possible = ', &
+         this%refactor
   end subroutine print_summary_factor
 
 end module spral_ssids_datatypes
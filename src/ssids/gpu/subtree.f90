@@ -301,7 +301,8 @@ contains
    end if
  end subroutine symbolic_cleanup
 
- function factor(this, posdef, aval, child_contrib, options, inform, scaling)
+ function factor(this, posdef, aval, child_contrib, options, inform, &
+      budget, numa_region, scaling)
    implicit none
    class(numeric_subtree_base), pointer :: factor
    class(gpu_symbolic_subtree), target, intent(inout) :: this
@@ -310,6 +311,8 @@ contains
    type(contrib_type), dimension(:), target, intent(inout) :: child_contrib
    type(ssids_options), intent(in) :: options
    type(ssids_inform), intent(inout) :: inform
+   type(C_PTR), intent(in) :: budget ! not used on GPU
+   integer, intent(in) :: numa_region ! not used on GPU
    real(wp), dimension(*), target, optional, intent(in) :: scaling
 
    type(gpu_numeric_subtree), pointer :: gpu_factor
@@ -69,7 +69,8 @@ contains
     this%dummy = 0
   end subroutine symbolic_cleanup
 
-  function factor(this, posdef, aval, child_contrib, options, inform, scaling)
+  function factor(this, posdef, aval, child_contrib, options, inform, &
+       budget, numa_region, scaling)
     implicit none
     class(numeric_subtree_base), pointer :: factor
     class(gpu_symbolic_subtree), target, intent(inout) :: this
@@ -78,6 +79,8 @@ contains
     type(contrib_type), dimension(:), target, intent(inout) :: child_contrib
     type(ssids_options), intent(in) :: options
     type(ssids_inform), intent(inout) :: inform
+    type(C_PTR), intent(in) :: budget ! not used on GPU
+    integer, intent(in) :: numa_region ! not used on GPU
     real(wp), dimension(*), target, optional, intent(in) :: scaling
 
     type(gpu_numeric_subtree), pointer :: subtree
@@ -89,6 +92,8 @@ contains
          subtree%dummy = real(this%dummy,wp)+aval(1)+child_contrib(1)%val(1)+&
          options%gpu_perf_coeff
     if (present(scaling)) subtree%dummy = subtree%dummy * scaling(1)
+    if (c_associated(budget)) subtree%dummy = subtree%dummy + 1
+    if (numa_region .ge. 0) subtree%dummy = subtree%dummy + numa_region
     inform%flag = SSIDS_ERROR_UNKNOWN
   end function factor
 
@@ -36,6 +36,33 @@ module spral_ssids_inform
      type(auction_inform) :: auction
      integer :: cuda_error = 0
      integer :: cublas_error = 0
+     integer :: cpu_isa = 0 ! SIMD instruction set used by CPU kernels:
+        ! 0 generic, 1 AVX, 2 AVX2, 3 AVX-512, 4 NEON
+     real(wp) :: factor_time = 0.0_wp ! Wall clock time (s) of factorization
+     real(wp) :: factor_time_predicted = 0.0_wp ! Factorization time (s)
+        ! predicted by the amalgamation cost model during analyse
+     integer :: not_refactored = 0 ! Number of nodes at which
+        ! options%refactor could not reuse the previous pivot sequence
+     integer(long) :: relidx_mem = 0_long ! Memory (bytes) used by relative
+        ! indices stored by analyse (see options%store_relidx)
+     integer(long) :: contrib_peak_predicted = 0_long ! Peak contribution
+        ! block memory (bytes) of a factorization that processes the tree
+        ! one node at a time in order, predicted by analyse
+     integer(long) :: contrib_peak = 0_long ! Peak memory (bytes) held by
+        ! the pools contribution blocks, backups and other small workspace
+        ! are allocated from during factorization on CPU, including freed
+        ! blocks kept for reuse
+     integer(long) :: factor_mem_predicted = 0_long ! Memory (bytes) for
+        ! factors on CPU of an indefinite matrix without delays, predicted by
+        ! analyse
+     integer(long) :: work_mem_predicted = 0_long ! Workspace (bytes) per
+        ! thread for factorization on CPU, predicted by analyse
+     integer :: num_huge_pages = 0 ! Peak number of huge pages held by
+        ! factor, pool and workspace memory on CPU (see options%huge_pages)
+     integer(long) :: backup_peak = 0_long ! Largest memory (bytes) held by
+        ! any node on CPU for backups of blocks in case pivots fail
+     integer :: num_refine = 0 ! Number of steps of iterative refinement
+        ! performed by solve (see options%compress_factors)
 
      ! Undocumented FIXME: should we document them?
      integer :: not_first_pass = 0
@@ -207,6 +234,21 @@ contains
     ! FIXME: %auction ???
     if (other%cuda_error .ne. 0) this%cuda_error = other%cuda_error
     if (other%cublas_error .ne. 0) this%cublas_error = other%cublas_error
+    this%cpu_isa = max(this%cpu_isa, other%cpu_isa)
+    this%factor_time = max(this%factor_time, other%factor_time)
+    this%factor_time_predicted = &
+         max(this%factor_time_predicted, other%factor_time_predicted)
+    this%not_refactored = this%not_refactored + other%not_refactored
+    this%relidx_mem = this%relidx_mem + other%relidx_mem
+    this%contrib_peak_predicted = &
+         max(this%contrib_peak_predicted, other%contrib_peak_predicted)
+    this%contrib_peak = max(this%contrib_peak, other%contrib_peak)
+    this%factor_mem_predicted = &
+         this%factor_mem_predicted + other%factor_mem_predicted
+    this%work_mem_predicted = &
+         max(this%work_mem_predicted, other%work_mem_predicted)
+    this%num_huge_pages = this%num_huge_pages + other%num_huge_pages
+    this%backup_peak = max(this%backup_peak, other%backup_peak)
     this%not_first_pass = this%not_first_pass + other%not_first_pass
     this%not_second_pass = this%not_second_pass + other%not_second_pass
     this%nparts = this%nparts + other%nparts
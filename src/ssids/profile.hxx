@@ -14,6 +14,7 @@
 #error "Cannot enable profiling without GTG library"
 #endif
 
+#include <cstddef>
 #include <cstdio>
 
 #ifdef HAVE_GTG
@@ -126,6 +127,41 @@ public:
 #endif
    };
 
+   /**
+    * \brief Add an event recording the block size chosen for a node.
+    * \param m Number of rows in node.
+    * \param n Number of columns in node.
+    * \param block_size Block size chosen.
+    * \param thread Optional thread number, otherwise use best guess.
+    */
+   static
+   void addBlockSizeEvent(int m, int n, int block_size,
+         int thread=Profile::guess_core()) {
+#if defined(PROFILE) && defined(HAVE_GTG)
+      char val[100];
+      snprintf(val, 100, "%dx%d: %d", m, n, block_size);
+      addEvent("EV_BLOCK_SIZE", val, thread);
+#endif
+   }
+
+   /**
+    * \brief Add an event recording the backup memory used by a node.
+    * \param m Number of rows in node.
+    * \param n Number of columns in node.
+    * \param method Name of backup method chosen.
+    * \param bytes Peak memory in bytes held for backups.
+    * \param thread Optional thread number, otherwise use best guess.
+    */
+   static
+   void addBackupEvent(int m, int n, char const* method, size_t bytes,
+         int thread=Profile::guess_core()) {
+#if defined(PROFILE) && defined(HAVE_GTG)
+      char val[100];
+      snprintf(val, 100, "%dx%d: %s %zu", m, n, method, bytes);
+      addEvent("EV_BACKUP", val, thread);
+#endif
+   }
+
    /**
     * \brief Open trace file, initialise topoology and define states and events.
     *
@@ -193,6 +229,8 @@ public:
       // Define events
       addEventType("EV_AGG_FAIL", "CT_THREAD", "Aggressive pivot fail");
       addEventType("EV_ALL_REGIONS", "CT_THREAD", "All regions subtree");
+      addEventType("EV_BLOCK_SIZE", "CT_THREAD", "Node block size");
+      addEventType("EV_BACKUP", "CT_THREAD", "Node backup memory");
       // Initialise start time
       clock_gettime(CLOCK_REALTIME, &tstart);
 #endif
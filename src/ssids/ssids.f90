@@ -797,6 +797,8 @@ contains
     ! comments)
     integer :: matrix_type
     real(wp), dimension(:), allocatable :: scaling
+    integer(long) :: clock_start, clock_stop, clock_rate
+    logical :: refactor
 
     ! Types related to scaling routines
     type(hungarian_options) :: hsoptions
@@ -851,7 +853,18 @@ contains
        goto 100
     end if
 
+    ! Refactorize in place, reusing the storage (and, if options%refactor is
+    ! set, the pivot sequence) of fkeep, if it holds a successful
+    ! factorization of the same type for this akeep
+    refactor = .false.
+    if (allocated(fkeep%subtree) .and. (fkeep%inform%flag .ge. 0)) then
+       refactor = (fkeep%akeep_id .eq. akeep%id) .and. &
+            (fkeep%pos_def .eqv. posdef) .and. &
+            (size(fkeep%subtree) .eq. akeep%nparts)
+    end if
+
     fkeep%pos_def = posdef
+    fkeep%akeep_id = akeep%id
     if (posdef) then
        matrix_type = SPRAL_MATRIX_REAL_SYM_PSDEF
     else
@@ -1032,7 +1045,7 @@ contains
     !      maxval(fkeep%scaling)
 
     ! Setup data storage
-    if (allocated(fkeep%subtree)) then
+    if (allocated(fkeep%subtree) .and. (.not. refactor)) then
        do i = 1, size(fkeep%subtree)
           if (associated(fkeep%subtree(i)%ptr)) then
              call fkeep%subtree(i)%ptr%cleanup()
@@ -1043,16 +1056,32 @@ contains
     end if
 
     ! Call main factorization routine
+    call system_clock(clock_start, clock_rate)
     if (akeep%check) then
-       call fkeep%inner_factor(akeep, val2, options, inform)
+       call fkeep%inner_factor(akeep, val2, options, inform, refactor)
     else
-       call fkeep%inner_factor(akeep, val, options, inform)
+       call fkeep%inner_factor(akeep, val, options, inform, refactor)
     end if
+    call system_clock(clock_stop)
+    inform%factor_time = real(clock_stop-clock_start, wp) / clock_rate
+    inform%factor_time_predicted = akeep%inform%factor_time_predicted
     if (inform%flag .lt. 0) then
        fkeep%inform = inform
        goto 100
     end if
 
+    ! Keep copy of A for iterative refinement by solve
+    if (options%compress_factors) then
+       if (akeep%check) then
+          call fkeep%keep_matrix(n, akeep%ptr, akeep%row, val2, st)
+       else
+          call fkeep%keep_matrix(n, ptr, row, val, st)
+       end if
+       if (st .ne. 0) goto 10
+    else
+       deallocate(fkeep%ir_ptr, fkeep%ir_row, fkeep%ir_val, stat=st)
+    end if
+
     if (akeep%n .ne. inform%matrix_rank) then
        ! Rank deficient
        ! Note: If we reach this point then must be options%action=.true.
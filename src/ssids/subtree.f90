@@ -3,6 +3,7 @@
 !> \licence   BSD licence, see LICENCE file for details
 !> \author    Jonathan Hogg
 module spral_ssids_subtree
+   use, intrinsic :: iso_c_binding, only : C_PTR, c_associated
    use spral_ssids_contrib, only : contrib_type
    use spral_ssids_datatypes, only : long, wp, ssids_options
    use spral_ssids_inform, only : ssids_inform
@@ -56,6 +57,9 @@ module spral_ssids_subtree
       procedure(solve_proc_iface), deferred :: solve_bwd
       !> @brief Free associated memory/resources
       procedure(numeric_cleanup_iface), deferred :: cleanup
+      !> @brief Refactorize in place with new values. The default
+      !>        implementation does nothing and returns .false..
+      procedure :: refactor
    end type numeric_subtree_base
 
    abstract interface
@@ -67,10 +71,14 @@ module spral_ssids_subtree
       !> @param child_contrib Array of contribution blocks from children.
       !> @param options User-supplied options.
       !> @param inform Information/statistics to be returned to user.
+      !> @param budget Limit on contribution block memory shared by all
+      !>        subtrees (C pointer to a MemoryBudget, may be C_NULL_PTR).
+      !> @param numa_region NUMA region (counted from 0) whose memory is to
+      !>        hold the factors, or -1 for no preference.
       !> @param scaling Scaling to be applied (if present).
       function factor_iface(this, posdef, aval, child_contrib, options, &
-            inform, scaling)
-         import symbolic_subtree_base, numeric_subtree_base, wp
+            inform, budget, numa_region, scaling)
+         import symbolic_subtree_base, numeric_subtree_base, wp, C_PTR
          import ssids_inform, ssids_options
          import contrib_type
          implicit none
@@ -81,6 +89,8 @@ module spral_ssids_subtree
          type(contrib_type), dimension(:), target, intent(inout) :: child_contrib
          type(ssids_options), intent(in) :: options
          type(ssids_inform), intent(inout) :: inform
+         type(C_PTR), intent(in) :: budget
+         integer, intent(in) :: numa_region
          real(wp), dimension(*), target, optional, intent(in) :: scaling
       end function factor_iface
       !> @brief Free associated memory/resources
@@ -125,4 +135,47 @@ module spral_ssids_subtree
          class(numeric_subtree_base), intent(inout) :: this
       end subroutine numeric_cleanup_iface
    end interface
+
+contains
+
+   !> @brief Refactorize in place with new values, reusing the storage and,
+   !>        where the subclass supports it, the pivot sequence of the current
+   !>        factorization.
+   !>
+   !> Subclasses that do not support refactorization inherit this version,
+   !> which does nothing. The caller should then clean up this subtree and
+   !> obtain a new one from symbolic%factor().
+   !>
+   !> @param this Instance pointer.
+   !> @param symbolic Symbolic subtree this was factorized from. Must be
+   !>        unchanged since that factorization.
+   !> @param aval Value component of CSC datatype for original matrix A.
+   !> @param child_contrib Array of contribution blocks from children.
+   !> @param options User-supplied options.
+   !> @param inform Information/statistics to be returned to user.
+   !> @param budget Limit on contribution block memory shared by all
+   !>        subtrees (C pointer to a MemoryBudget, may be C_NULL_PTR).
+   !> @param scaling Scaling to be applied (if present).
+   !> @returns .true. if refactorization was attempted (inform%flag then
+   !>        indicates success or failure), .false. if not supported.
+   logical function refactor(this, symbolic, aval, child_contrib, options, &
+         inform, budget, scaling)
+      implicit none
+      class(numeric_subtree_base), target, intent(inout) :: this
+      class(symbolic_subtree_base), target, intent(inout) :: symbolic
+      real(wp), dimension(*), target, intent(in) :: aval
+      type(contrib_type), dimension(:), target, intent(inout) :: child_contrib
+      type(ssids_options), intent(in) :: options
+      type(ssids_inform), intent(inout) :: inform
+      type(C_PTR), intent(in) :: budget
+      real(wp), dimension(*), target, optional, intent(in) :: scaling
+
+      refactor = .false.
+
+      ! Dummy operations to prevent warnings (never executed, as a numeric
+      ! subtree is never of the same type as a symbolic one)
+      if (same_type_as(this, symbolic) .and. c_associated(budget)) &
+         inform%flag = size(child_contrib) + options%print_level + &
+            int(aval(1)) + merge(1, 0, present(scaling))
+   end function refactor
 end module spral_ssids_subtree
@@ -10,6 +10,7 @@
  */
 
 #include <cstdio>
+#include <cstring>
 
 #include <fenv.h>
 
@@ -19,11 +20,25 @@
 #include "kernels/cholesky.hxx"
 #include "kernels/ldlt_app.hxx"
 #include "kernels/ldlt_nopiv.hxx"
+#include "kernels/ldlt_refactor.hxx"
 #include "kernels/ldlt_tpp.hxx"
+#include "kernels/simd_kernels.hxx"
+#include "kernels/small_solve.hxx"
+#include "kernels/thread_cache_alloc.hxx"
 
-int main(void) {
+int main(int argc, char** argv) {
    int nerr = 0;
 
+   // Run micro-benchmarks instead of tests if requested
+   if(argc > 1 && strcmp(argv[1], "bench") == 0) {
+      run_cholesky_bench();
+      run_ldlt_app_bench();
+      run_small_solve_bench();
+      run_simd_kernels_bench();
+      run_thread_cache_alloc_bench();
+      return 0;
+   }
+
    // Enable trapping of bad numerics (NB: can give false positives
    // eg in upper triangle if it's deliberately allowed to contain rubbish)
 #if 0
@@ -35,8 +50,12 @@ int main(void) {
    nerr += run_cholesky_tests();
    nerr += run_ldlt_nopiv_tests();
    nerr += run_ldlt_tpp_tests();
+   nerr += run_ldlt_refactor_tests();
    nerr += run_block_ldlt_tests();
    nerr += run_ldlt_app_tests();
+   nerr += run_small_solve_tests();
+   nerr += run_simd_kernels_tests();
+   nerr += run_thread_cache_alloc_tests();
 
    if(nerr==0) {
       printf(ANSI_COLOR_BLUE "\n====================================\n"
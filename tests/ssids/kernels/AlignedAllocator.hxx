@@ -12,15 +12,17 @@
 #endif
 #include <new>
 
+#include "config.h" // for HAVE_AVX*_KERNELS
+
 namespace spral { namespace test {
 
 template <class T>
 class AlignedAllocator {
 public:
   // Number of bytes boundary we align to
-#if defined(__AVX512F__)
+#if defined(__AVX512F__) || defined(HAVE_AVX512_KERNELS)
   const int alignment = 64;
-#elif defined(__AVX__)
+#elif defined(__AVX__) || defined(HAVE_AVX2_KERNELS)
   const int alignment = 32;
 #else
   const int alignment = 16;
@@ -10,20 +10,32 @@
  */
 #include "cholesky.hxx"
 
+#include <chrono>
 #include <cmath>
+#include <cstdio>
 #include <cstring>
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif /* _OPENMP */
+
 #include "framework.hxx"
 #include "ssids/cpu/kernels/cholesky.hxx"
+#include "ssids/cpu/kernels/common.hxx"
 #include "ssids/cpu/kernels/wrappers.hxx"
 
 using namespace spral::ssids::cpu;
 
-int test_cholesky(int m, int n, int blksz, bool debug=false) {
+/** Factorize a random matrix and check the result.
+ *  If seed is nonzero, the matrix is generated from it rather than from
+ *  rand(), leaving the random numbers seen by later tests unchanged. */
+int test_cholesky(int m, int n, int blksz, int lookahead=1,
+      unsigned int seed=0, bool debug=false) {
    /* Generate random dense posdef matrix of size m */
    int lda = m;
    double *a = new double[m*lda];
-   gen_posdef(m, a, lda);
+   std::minstd_rand gen(seed);
+   gen_posdef(m, a, lda, (seed) ? &gen : nullptr);
    /* Take a copy */
    double *l = new double[m*lda];
    memcpy(l, a, m*lda*sizeof(double));
@@ -35,7 +47,8 @@ int test_cholesky(int m, int n, int blksz, bool debug=false) {
    {
       #pragma omp single
       {
-         cholesky_factor(m, n, l, lda, 1.0, &l[n*lda+n], lda, blksz, &info);
+         cholesky_factor(m, n, l, lda, 1.0, &l[n*lda+n], lda, blksz, &info,
+               lookahead);
       }
    } /* implicit task wait on exit from parallel region */
    if(debug) { printf("POST:\n"); print_mat(" %e", m, l, lda); }
@@ -105,5 +118,59 @@ int run_cholesky_tests() {
    TEST(test_cholesky(733, 231, 19));
    TEST(test_cholesky(1668, 204, 256));
 
+   /* Cholesky tests with task priorities (m, n, blksz, lookahead, seed) */
+   TEST(test_cholesky(733, 231, 32, -1, 1));
+   TEST(test_cholesky(733, 231, 32, 0, 2));
+   TEST(test_cholesky(733, 231, 32, 3, 3));
+   TEST(test_cholesky(1000, 1000, 64, 2, 4));
+
    return nerr;
 }
+
+/** Micro-benchmark of cholesky_factor() on a large dense front, comparing
+ *  task priorities with various lookaheads against all tasks having the
+ *  same priority (lookahead -1). */
+void run_cholesky_bench() {
+   int const m = 4000, n = 3000, blksz = 256;
+   int const lookaheads[] = { -1, 0, 1, 2, 4 };
+   typedef std::chrono::steady_clock clock;
+
+   int lda = m;
+   double *a = new double[m*lda];
+   gen_posdef(m, a, lda);
+   double *l = new double[m*lda];
+
+   int nthread = 1;
+#ifdef _OPENMP
+   nthread = omp_get_max_threads();
+#endif /* _OPENMP */
+   printf("Cholesky task priorities (m = %d, n = %d, blksz = %d, "
+         "%d threads)\n", m, n, blksz, nthread);
+#ifdef _OPENMP
+   if(omp_get_max_task_priority() < TASK_PRIORITY_MAX)
+      printf("NB: priorities ignored, set OMP_MAX_TASK_PRIORITY=%d\n",
+            TASK_PRIORITY_MAX);
+#endif /* _OPENMP */
+   printf("%9s | %10s %7s\n", "lookahead", "time (s)", "speedup");
+   double tbase = 0.0;
+   for(int lookahead : lookaheads) {
+      memcpy(l, a, m*lda*sizeof(double));
+      int info;
+      auto start = clock::now();
+      #pragma omp parallel default(shared)
+      {
+         #pragma omp single
+         {
+            cholesky_factor(m, n, l, lda, 0.0, &l[n*lda+n], lda, blksz, &info,
+                  lookahead);
+         }
+      }
+      auto stop = clock::now();
+      double t = std::chrono::duration<double>(stop-start).count();
+      if(lookahead < 0) tbase = t;
+      printf("%9d | %10.3f %7.2f\n", lookahead, t, tbase/t);
+   }
+
+   delete[] a;
+   delete[] l;
+}
@@ -11,3 +11,4 @@
 #pragma once
 
 int run_cholesky_tests();
+void run_cholesky_bench();
@@ -19,10 +19,11 @@
 
 /** Generates a random dense positive definte matrix. Off diagonal entries are
  * Unif[-1,1]. Each diagonal entry a_ii = Unif[0.1,1.1] + sum_{i!=j} |a_ij|.
- * Only lower triangle is used, rest is filled with NaNs. */
-void gen_posdef(int n, double* a, int lda) {
+ * Only lower triangle is used, rest is filled with NaNs.
+ * Random numbers are taken from gen if given, otherwise from rand(). */
+void gen_posdef(int n, double* a, int lda, std::minstd_rand* gen) {
    /* Get general sym indef matrix */
-   gen_sym_indef(n, a, lda);
+   gen_sym_indef(n, a, lda, gen);
    /* Make diagonally dominant */
    for(int i=0; i<n; ++i) a[i*lda+i] = fabs(a[i*lda+i]) + 0.1;
    for(int j=0; j<n; ++j)
@@ -33,12 +34,14 @@ void gen_posdef(int n, double* a, int lda) {
 }
 
 /** Generates a random dense positive definte matrix. Entries are Unif[-1,1].
- * Only lower triangle is used, rest is filled with NaNs. */
-void gen_sym_indef(int n, double* a, int lda) {
+ * Only lower triangle is used, rest is filled with NaNs.
+ * Random numbers are taken from gen if given, otherwise from rand(). */
+void gen_sym_indef(int n, double* a, int lda, std::minstd_rand* gen) {
    /* Fill matrix with random numbers from Unif [-1.0,1.0] */
+   std::uniform_real_distribution<double> unif(-1.0, 1.0);
    for(int j=0; j<n; ++j)
    for(int i=j; i<n; ++i)
-      a[j*lda+i] = 1.0 - (2.0*rand()) / RAND_MAX ;
+      a[j*lda+i] = (gen) ? unif(*gen) : 1.0 - (2.0*rand()) / RAND_MAX ;
    /* Fill upper triangle with NaN */
    for(int j=0; j<n; ++j)
    for(int i=0; i<j; ++i)
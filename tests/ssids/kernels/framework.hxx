@@ -13,6 +13,7 @@
 #include <cstdio>
 #include <iostream>
 #include <ios>
+#include <random>
 #include <stdexcept>
 
 #define ANSI_COLOR_RED     "\x1b[31;1m"
@@ -106,8 +107,8 @@ if((a) > (b)) { \
    << "Test failure at " __FILE__ ":" << __LINE__ << std::endl \
    << "EXPECT_EQ(" #a ", " #b ") : " << (a) << " != " << (b)  << std::endl
 
-void gen_posdef(int n, double* a, int lda);
-void gen_sym_indef(int n, double* a, int lda);
+void gen_posdef(int n, double* a, int lda, std::minstd_rand* gen=nullptr);
+void gen_sym_indef(int n, double* a, int lda, std::minstd_rand* gen=nullptr);
 void gen_rhs(int n, double const* a, int lda, double* rhs);
 void print_vec(char const* format, int n, double const* vec);
 void print_mat(char const* format, int n, double const* a, int lda, int *perm=nullptr);
@@ -10,6 +10,8 @@
  */
 #include "ldlt_app.hxx"
 
+#include <chrono>
+#include <cstdio>
 #include <cstring>
 #include <iomanip>
 #include <iostream>
@@ -272,10 +274,20 @@ void modify_test_matrix(bool singular, bool delays, bool dblk_singular, int m, i
    }
 }
 
+/// PoolBackup with a pool of npool blocks (so npool=0 allocates all lazily)
+template <typename T, int npool>
+class SmallPoolBackup : public PoolBackup<T> {
+public:
+   SmallPoolBackup(int m, int n, int block_size)
+   : PoolBackup<T>(m, n, block_size, std::allocator<T*>(), npool)
+   {}
+};
+
 template <typename T,
           int INNER_BLOCK_SIZE,
           bool aggressive, // Use Cholesky-like app pattern
-          bool debug // Switch on debugging output
+          bool debug, // Switch on debugging output
+          typename Backup=CopyBackup<T> // Type of backup to use
           >
 int ldlt_test(T u, T small, bool delays, bool singular, bool dblk_singular, int m, int n, int outer_block_size=INNER_BLOCK_SIZE, int test=0, int seed=0) {
    // Note: We generate an m x m test matrix, then factor it as an
@@ -309,6 +321,7 @@ int ldlt_test(T u, T small, bool delays, bool singular, bool dblk_singular, int
    options.print_level = 0;
    options.small_subtree_threshold = 100*100*100;
    options.cpu_block_size = 256;
+   options.cpu_lookahead = 1;
    options.pivot_method = (aggressive) ? PivotMethod::app_aggressive
                                        : PivotMethod::app_block;
 
@@ -320,14 +333,14 @@ int ldlt_test(T u, T small, bool delays, bool singular, bool dblk_singular, int
    for(int i=0; i<m; i++) perm[i] = i;
    T *d = new T[2*m];
    // First m x n matrix
-   CopyBackup<T> backup(m, n, outer_block_size);
+   Backup backup(m, n, outer_block_size);
    std::vector<Workspace> work;
    const int PAGE_SIZE = 8*1024*1024; // 8 MB
    for(int i=0; i<omp_get_num_threads(); ++i)
       work.emplace_back(PAGE_SIZE);
    int const use_tasks = true;
    int q1 = LDLT
-         <T, INNER_BLOCK_SIZE, CopyBackup<T>, use_tasks, debug>
+         <T, INNER_BLOCK_SIZE, Backup, use_tasks, debug>
          ::factor(
             m, n, perm, l, lda, d, backup, options, options.pivot_method,
             outer_block_size, 0.0, nullptr, 0, work
@@ -354,9 +367,9 @@ int ldlt_test(T u, T small, bool delays, bool singular, bool dblk_singular, int
       int *perm2 = new int[m-q1];
       for(int i=0; i<m-q1; i++)
          perm2[i] = i;
-      CopyBackup<T> backup(m-q1, m-q1, outer_block_size);
+      Backup backup(m-q1, m-q1, outer_block_size);
       q2 = LDLT
-         <T, INNER_BLOCK_SIZE, CopyBackup<T>, use_tasks, debug>
+         <T, INNER_BLOCK_SIZE, Backup, use_tasks, debug>
          ::factor(
             m-q1, m-q1, perm2, &l[q1*(lda+1)], lda, &d[2*q1], backup, options,
             options.pivot_method, outer_block_size, 0.0, nullptr, 0, work
@@ -421,7 +434,8 @@ template <typename T,
           int BLOCK_SIZE,
           bool aggressive, // Use Cholesky-like app pattern
           int ntest, // Number of tests
-          bool debug // Switch on debugging output
+          bool debug, // Switch on debugging output
+          typename Backup=CopyBackup<T> // Type of backup to use
           >
 int ldlt_torture_test(T u, T small, int m, int n) {
    for(int test=0; test<ntest; test++) {
@@ -446,7 +460,7 @@ int ldlt_torture_test(T u, T small, int m, int n) {
          std::cout << "##########################################" << std::endl;
       }
 
-      int err = ldlt_test<T, BLOCK_SIZE, aggressive, debug>(u, small, delays, singular, dblk_singular, m, n, BLOCK_SIZE, test, seed);
+      int err = ldlt_test<T, BLOCK_SIZE, aggressive, debug, Backup>(u, small, delays, singular, dblk_singular, m, n, BLOCK_SIZE, test, seed);
       if(err!=0) return err;
    }
 
@@ -599,5 +613,89 @@ int run_ldlt_app_tests() {
       ldlt_torture_test<double, 16, false, 500, false> (0.01, 1e-20, 8*16, 3*16)
       ));
 
+   /* Torture tests, backups in a pool, a small pool and allocated lazily */
+   TEST((
+      ldlt_torture_test<double, 16, false, 200, false, PoolBackup<double>> (0.01, 1e-20, 8*16, 3*16)
+      ));
+   TEST((
+      ldlt_torture_test<double, 16, false, 200, false, SmallPoolBackup<double,3>> (0.01, 1e-20, 8*16, 8*16)
+      ));
+   TEST((
+      ldlt_torture_test<double, 16, false, 200, false, SmallPoolBackup<double,0>> (0.01, 1e-20, 8*16+5, 3*16+7)
+      ));
+
    return nerr;
 }
+
+/** Micro-benchmark of LDLT::factor() on a large dense front, comparing
+ *  task priorities with various lookaheads against all tasks having the
+ *  same priority (lookahead -1). */
+void run_ldlt_app_bench() {
+   typedef double T;
+   int const m = 4000, n = 3000, block_size = 256;
+   int const lookaheads[] = { -1, 0, 1, 2, 4 };
+   typedef std::chrono::steady_clock clock;
+
+   int lda = align_lda<T>(m);
+   T* a = new T[m*lda];
+   gen_sym_indef(m, a, lda);
+   spral::test::AlignedAllocator<T> allocT;
+   T* l = allocT.allocate(m*lda);
+   int* perm = new int[m];
+   T* d = new T[2*m];
+   int ldupd = align_lda<T>(m-n);
+   T* upd = allocT.allocate((m-n)*ldupd);
+
+   struct cpu_factor_options options;
+   options.action = true;
+   options.multiplier = 2.0;
+   options.small = 1e-20;
+   options.u = 0.01;
+   options.print_level = 0;
+   options.small_subtree_threshold = 100*100*100;
+   options.cpu_block_size = block_size;
+   options.pivot_method = PivotMethod::app_block;
+
+   int nthread = omp_get_max_threads();
+   std::vector<Workspace> work;
+   for(int i=0; i<nthread; ++i)
+      work.emplace_back(8*1024*1024);
+   printf("LDLT APP task priorities (m = %d, n = %d, block_size = %d, "
+         "%d threads)\n", m, n, block_size, nthread);
+   if(omp_get_max_task_priority() < TASK_PRIORITY_MAX)
+      printf("NB: priorities ignored, set OMP_MAX_TASK_PRIORITY=%d\n",
+            TASK_PRIORITY_MAX);
+   printf("%9s | %10s %7s %7s\n", "lookahead", "time (s)", "speedup",
+         "nelim");
+   double tbase = 0.0;
+   for(int lookahead : lookaheads) {
+      options.cpu_lookahead = lookahead;
+      memcpy(l, a, m*lda*sizeof(T));
+      for(int i=0; i<m; i++) perm[i] = i;
+      int nelim;
+      auto start = clock::now();
+      #pragma omp parallel default(shared)
+      {
+         #pragma omp single
+         {
+            CopyBackup<T> backup(m, n, block_size);
+            nelim = LDLT
+               <T, INNER_BLOCK_SIZE, CopyBackup<T>, true, false>
+               ::factor(
+                  m, n, perm, l, lda, d, backup, options,
+                  options.pivot_method, block_size, 0.0, upd, ldupd, work
+                  );
+         }
+      }
+      auto stop = clock::now();
+      double t = std::chrono::duration<double>(stop-start).count();
+      if(lookahead < 0) tbase = t;
+      printf("%9d | %10.3f %7.2f %7d\n", lookahead, t, tbase/t, nelim);
+   }
+
+   delete[] a;
+   allocT.deallocate(l, m*lda);
+   allocT.deallocate(upd, (m-n)*ldupd);
+   delete[] perm;
+   delete[] d;
+}
@@ -11,3 +11,4 @@
 #pragma once
 
 int run_ldlt_app_tests();
+void run_ldlt_app_bench();
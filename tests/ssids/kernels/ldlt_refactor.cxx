@@ -0,0 +1,204 @@
+/* Copyright 2016 The Science and Technology Facilities Council (STFC)
+ *
+ * Authors: Jonathan Hogg (STFC)
+ *
+ * IMPORTANT: This file is NOT licenced under the BSD licence. If you wish to
+ * licence this code, please contact STFC via hsl@stfc.ac.uk
+ * (We are currently deciding what licence to release this code under if it
+ * proves to be useful beyond our own academic experiments)
+ *
+ */
+#include "ldlt_refactor.hxx"
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#include "framework.hxx"
+#include "ssids/cpu/Workspace.hxx"
+#include "ssids/cpu/kernels/wrappers.hxx"
+#include "ssids/cpu/kernels/ldlt_refactor.hxx"
+#include "ssids/cpu/kernels/ldlt_tpp.hxx"
+
+using namespace spral::ssids::cpu;
+
+namespace {
+
+/// Returns symmetric permutation of lower triangle of m x m matrix a
+/// such that row/col i of the result is row/col perm[i] of a
+void reorder(int m, int const* perm, double const* a, int lda, double* b,
+      int ldb) {
+   for(int j=0; j<m; j++) {
+      int c = perm[j];
+      for(int i=j; i<m; i++) {
+         int r = perm[i];
+         b[j*ldb+i] = (r<c) ? a[r*lda+c] : a[c*lda+r];
+      }
+   }
+}
+
+/// Update A22 -= A_21 D_11 A_21^T, where D_11 is stored as D^{-1}
+void do_update(int n, int k, double* a22, int lda22, double const* a21,
+      int lda21, double const* d) {
+   double* ad21 = new double[n*k];
+   for(int j=0; j<k;) {
+      if(j+1<k && std::isinf(d[2*j+2])) {
+         double di11 = d[2*j]; double di21 = d[2*j+1]; double di22 = d[2*j+3];
+         double det = di11*di22 - di21*di21;
+         double d11 = di22 / det;
+         double d21 = -di21 / det;
+         double d22 = di11 / det;
+         for(int i=0; i<n; i++) {
+            ad21[j*n+i]     = d11*a21[j*lda21+i] + d21*a21[(j+1)*lda21+i];
+            ad21[(j+1)*n+i] = d21*a21[j*lda21+i] + d22*a21[(j+1)*lda21+i];
+         }
+         j += 2;
+      } else {
+         double d11 = 1/d[2*j];
+         for(int i=0; i<n; i++)
+            ad21[j*n+i] = d11*a21[j*lda21+i];
+         j++;
+      }
+   }
+   host_gemm<double>(OP_N, OP_T, n, n, k, -1.0, ad21, n, a21, lda21, 1.0,
+         a22, lda22);
+   delete[] ad21;
+}
+
+/// Perturb every entry of lower triangle by a relative amount of at most eps
+void perturb(int m, double* a, int lda, double eps) {
+   for(int j=0; j<m; j++)
+   for(int i=j; i<m; i++)
+      a[j*lda+i] *= 1.0 + eps*(2*((double) rand())/RAND_MAX - 1);
+}
+
+/// Max abs difference between lower trapezoids of two m x n matrices,
+/// relative to the magnitude of entries of the first
+double max_diff(int m, int n, double const* a, int lda, double const* b,
+      int ldb) {
+   double best = 0.0;
+   for(int j=0; j<n; j++)
+   for(int i=j; i<m; i++)
+      best = std::max(best,
+            fabs(a[j*lda+i]-b[j*ldb+i]) / std::max(1.0, fabs(a[j*lda+i])));
+   return best;
+}
+
+/// Condition number (infinity norm) of a 2x2 pivot, given its inverse
+/// [di11 di21; di21 di22] as stored in D
+double cond_2x2(double di11, double di21, double di22) {
+   double norm = std::max(fabs(di11)+fabs(di21), fabs(di21)+fabs(di22));
+   return norm*norm / fabs(di11*di22 - di21*di21);
+}
+
+/// Factorize an m x n matrix with ldlt_tpp_factor(), then refactorize the
+/// same matrix (perturbed by eps if non-zero) using its pivot sequence and
+/// compare the results. If fail is true, an entry is scaled so that the
+/// old pivot sequence must be rejected instead.
+int ldlt_refactor_test(double u, double small, int m, int n, double eps,
+      bool fail=false, bool debug=false) {
+   bool failed = false;
+
+   // Generate test matrix
+   int lda = m;
+   double* a = new double[m*lda];
+   gen_sym_indef(m, a, lda);
+
+   // Determine pivot sequence using threshold partial pivoting
+   double* l = new double[m*lda];
+   memcpy(l, a, m*lda*sizeof(double));
+   int* perm = new int[m];
+   for(int i=0; i<m; i++) perm[i] = i;
+   double* d = new double[2*m];
+   double* ldwork = new double[2*m];
+   int nelim = ldlt_tpp_factor(m, n, perm, l, lda, d, ldwork, m, true, u,
+         small);
+   if(debug) std::cout << "TPP ELIMINATED " << nelim << " of " << n
+      << std::endl;
+
+   // Optionally perturb values, then reorder into pivot order
+   if(eps != 0.0) perturb(m, a, lda, eps);
+   double* a2 = new double[m*lda];
+   reorder(m, perm, a, lda, a2, lda);
+   if(fail) a2[m-1] *= 1e8;
+   double* d2 = new double[2*m];
+   for(int i=0; i<2*m; i++) d2[i] = 0.0;
+   for(int i=0; i+1<nelim; i++)
+      if(std::isinf(d[2*i+2])) d2[2*i+2] = std::numeric_limits<double>::infinity();
+   int ldupd = std::max(1, m-n);
+   double* upd = new double[ldupd*(m-n)];
+   Workspace work(0);
+
+   // Refactorize
+   bool ok = ldlt_refactor_factor(m, n, nelim, a2, lda, d2, u, small, upd,
+         ldupd, work);
+   if(fail) {
+      EXPECT_EQ(ok, false);
+   } else {
+      EXPECT_EQ(ok, true);
+      if(eps == 0.0) {
+         // Factors and uneliminated columns must match
+         EXPECT_LE(max_diff(m, n, l, lda, a2, lda), 1e-10);
+         for(int i=0; i<nelim; i++) {
+            if(std::isinf(d[2*i])) {
+               EXPECT_EQ(std::isinf(d2[2*i]), true);
+               continue;
+            }
+            // Rounding differences between the two factorizations are
+            // magnified in D^-1 by the condition number of a 2x2 pivot
+            double tol = 1e-12;
+            if(i+1<nelim && std::isinf(d[2*i+2]))
+               tol *= cond_2x2(d[2*i], d[2*i+1], d[2*i+3]);
+            EXPECT_LE(fabs(d[2*i]-d2[2*i]), tol*std::max(1.0, fabs(d[2*i])));
+            EXPECT_LE(fabs(d[2*i+1]-d2[2*i+1]),
+                  tol*std::max(1.0, fabs(d[2*i+1])));
+         }
+      }
+      // Contribution block must match a22 - L21 D L21^T
+      if(m > n) {
+         double* cref = new double[m*lda];
+         reorder(m, perm, a, lda, cref, lda);
+         do_update(m-n, nelim, &cref[n*(lda+1)], lda, &a2[n], lda, d2);
+         for(int j=0; j<m-n; j++)
+         for(int i=j; i<m-n; i++)
+            a2[(n+j)*lda+n+i] += upd[j*ldupd+i];
+         EXPECT_LE(max_diff(m-n, m-n, &cref[n*(lda+1)], lda, &a2[n*(lda+1)],
+                  lda), 1e-10);
+         delete[] cref;
+      }
+   }
+
+   // Cleanup memory
+   delete[] a; delete[] l; delete[] a2;
+   delete[] perm;
+   delete[] d; delete[] d2;
+   delete[] ldwork; delete[] upd;
+
+   return failed ? -1 : 0;
+}
+
+} /* anon namespace */
+
+int run_ldlt_refactor_tests() {
+   int nerr = 0;
+
+   /* Same matrix */
+   TEST(( ldlt_refactor_test(0.01, 1e-20, 1, 1, 0.0) ));
+   TEST(( ldlt_refactor_test(0.01, 1e-20, 2, 2, 0.0) ));
+   TEST(( ldlt_refactor_test(0.01, 1e-20, 5, 3, 0.0) ));
+   TEST(( ldlt_refactor_test(0.01, 1e-20, 33, 21, 0.0) ));
+   TEST(( ldlt_refactor_test(0.01, 1e-20, 100, 100, 0.0) ));
+   TEST(( ldlt_refactor_test(0.01, 1e-20, 233, 122, 0.0) ));
+
+   /* Slightly perturbed matrix */
+   TEST(( ldlt_refactor_test(0.01, 1e-20, 33, 21, 1e-8) ));
+   TEST(( ldlt_refactor_test(0.01, 1e-20, 233, 122, 1e-8) ));
+
+   /* Pivot sequence rejected */
+   TEST(( ldlt_refactor_test(0.01, 1e-20, 33, 21, 0.0, true) ));
+   TEST(( ldlt_refactor_test(0.01, 1e-20, 233, 122, 0.0, true) ));
+
+   return nerr;
+}
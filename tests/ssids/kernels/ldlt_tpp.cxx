@@ -10,6 +10,7 @@
  */
 #include "ldlt_tpp.hxx"
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <iomanip>
@@ -258,7 +259,7 @@ double find_l_abs_max(int n, double *a, int lda) {
    return best;
 }
 
-int ldlt_tpp_test(double u, double small, bool delays, bool singular, int m, int n, bool debug=false, int test=0, int seed=0) {
+int ldlt_tpp_test(double u, double small, bool delays, bool singular, int m, int n, int nb=0, bool debug=false, int test=0, int seed=0) {
    bool failed = false;
    bool action = true; // Don't abort on singular matrices
    // Note: We generate an m x m test matrix, then factor it as an
@@ -286,16 +287,18 @@ int ldlt_tpp_test(double u, double small, bool delays, bool singular, int m, int
    int *perm = new int[m];
    for(int i=0; i<m; i++) perm[i] = i;
    double *d = new double[2*m];
-   double *work = new double[2*m];
-   // First m x n matrix
-   int q1 = ldlt_tpp_factor(m, n, perm, l, lda, d, work, m, action, u, small);
+   double *work = new double[std::max(2,nb)*m];
+   // First m x n matrix (blocked if nb>0)
+   int q1 = (nb>0) ? ldlt_tpp_factor_blocked(m, n, perm, l, lda, d, work, m, nb, action, u, small)
+                   : ldlt_tpp_factor(m, n, perm, l, lda, d, work, m, action, u, small);
    if(debug) std::cout << "FIRST FACTOR CALL ELIMINATED " << q1 << " of " << n << " pivots" << std::endl;
    int q2 = 0;
    if(m > n) {
       // Apply outer product update
       do_update<double>(m-n, q1, &l[n*(lda+1)], &l[n], lda, d);
       // Second (m-n) x (m-n) matrix [but add delays if any]
-      q2 = ldlt_tpp_factor(m-q1, m-q1, &perm[q1], &l[q1*(lda+1)], lda, &d[2*q1], work, m, action, u, small, q1, &l[q1], lda);
+      q2 = (nb>0) ? ldlt_tpp_factor_blocked(m-q1, m-q1, &perm[q1], &l[q1*(lda+1)], lda, &d[2*q1], work, m, nb, action, u, small, q1, &l[q1], lda)
+                  : ldlt_tpp_factor(m-q1, m-q1, &perm[q1], &l[q1*(lda+1)], lda, &d[2*q1], work, m, action, u, small, q1, &l[q1], lda);
    }
    EXPECT_EQ(m, q1+q2) << "(test " << test << " seed " << seed << ")" << std::endl;
    EXPECT_LE(find_l_abs_max(m, l, lda), 1.0/u) << "(test " << test << " seed " << seed << ")" << std::endl;
@@ -333,6 +336,85 @@ int ldlt_tpp_test(double u, double small, bool delays, bool singular, int m, int
    return failed ? -1 : 0;
 }
 
+/// Check ldlt_tpp_factor_blocked() makes the same pivots and factors as
+/// ldlt_tpp_factor() on an m x n matrix. The matrix is nonsingular: on the
+/// dependent columns of a singular one, pivots are chosen from rounding noise.
+int ldlt_tpp_blocked_test(double u, double small, bool delays, int m, int n, int nb, int seed=0) {
+   bool failed = false;
+
+   // Generate test matrix
+   int lda = m;
+   double* a = new double[m*lda];
+   gen_sym_indef(m, a, lda);
+   modify_test_matrix(false, delays, m, n, a, lda);
+
+   // Factorize both ways
+   bool action = true;
+   double* l = new double[m*lda];
+   double* lb = new double[m*lda];
+   memcpy(l, a, m*lda*sizeof(double));
+   memcpy(lb, a, m*lda*sizeof(double));
+   int* perm = new int[m];
+   int* permb = new int[m];
+   for(int i=0; i<m; i++) perm[i] = permb[i] = i;
+   double* d = new double[2*m];
+   double* db = new double[2*m];
+   double* work = new double[std::max(2,nb)*m];
+   int q = ldlt_tpp_factor(m, n, perm, l, lda, d, work, m, action, u, small);
+   int qb = ldlt_tpp_factor_blocked(m, n, permb, lb, lda, db, work, m, nb,
+         action, u, small);
+
+   // Compare pivots exactly, values normwise to rounding. The two differ
+   // only in the order of updates to columns outside the panel, but each
+   // pivot may amplify the difference by up to 1/u, so allow for growth
+   // with m.
+   double const tol = 1e-12*m;
+   EXPECT_EQ(q, qb) << "(seed " << seed << ")" << std::endl;
+   int nperm = 0;
+   for(int i=0; i<m; i++)
+      if(perm[i] != permb[i]) nperm++;
+   EXPECT_EQ(nperm, 0) << "(seed " << seed << ")" << std::endl;
+   double dmax = 1.0, ddiff = 0.0;
+   for(int i=0; i<2*q; i++) {
+      if(std::isinf(d[i]) && d[i] == db[i]) continue; // 2x2 pivot marker
+      dmax = std::max(dmax, fabs(d[i]));
+      ddiff = std::max(ddiff, fabs(db[i] - d[i]));
+   }
+   EXPECT_LE(ddiff, tol*dmax) << "(seed " << seed << ")" << std::endl;
+   double lmax = 1.0, ldiff = 0.0; // L, and uneliminated columns
+   for(int j=0; j<n; j++)
+   for(int i=j; i<m; i++) {
+      lmax = std::max(lmax, fabs(l[j*lda+i]));
+      ldiff = std::max(ldiff, fabs(lb[j*lda+i] - l[j*lda+i]));
+   }
+   EXPECT_LE(ldiff, tol*lmax) << "(seed " << seed << ")" << std::endl;
+
+   // Cleanup memory
+   delete[] a; delete[] l; delete[] lb;
+   delete[] perm; delete[] permb;
+   delete[] d; delete[] db;
+   delete[] work;
+
+   return failed ? -1 : 0;
+}
+
+/// Run ldlt_tpp_blocked_test() on random matrices with a range of nb
+int ldlt_tpp_blocked_torture_test(double u, double small, int ntest, int m, int n) {
+   for(int test=0; test<ntest; test++) {
+      unsigned int seed = rand();
+      srand(seed);
+
+      // 70% chance of getting delays
+      bool delays = ( ((float) rand())/RAND_MAX < 0.7 );
+      int nb = 2 + test % 15;
+
+      int err = ldlt_tpp_blocked_test(u, small, delays, m, n, nb, seed);
+      if(err!=0) return err;
+   }
+
+   return 0; // Success
+}
+
 template <typename T>
 void print_mat (int n, int *perm, T *a, int lda) {
    for(int i=0; i<n; i++) {
@@ -343,7 +425,7 @@ void print_mat (int n, int *perm, T *a, int lda) {
    }
 }
 
-int ldlt_tpp_torture_test(double u, double small, int ntest, int m, int n, bool debug=false) {
+int ldlt_tpp_torture_test(double u, double small, int ntest, int m, int n, int nb=0, bool debug=false) {
    for(int test=0; test<ntest; test++) {
       // Record seed we're using
       unsigned int seed = rand();
@@ -364,7 +446,7 @@ int ldlt_tpp_torture_test(double u, double small, int ntest, int m, int n, bool
          std::cout << "##########################################" << std::endl;
       }
 
-      int err = ldlt_tpp_test(u, small, delays, singular, m, n, debug, test, seed);
+      int err = ldlt_tpp_test(u, small, delays, singular, m, n, nb, debug, test, seed);
       if(err!=0) return err;
    }
 
@@ -411,5 +493,23 @@ int run_ldlt_tpp_tests() {
    TEST(( ldlt_tpp_torture_test(0.01, 1e-20, 1000, 100, 100) ));
    TEST(( ldlt_tpp_torture_test(0.01, 1e-20, 1000, 100, 50) ));
 
+   /* Blocked */
+   TEST(( ldlt_tpp_test(0.01, 1e-20, false, false, 33, 21, 8) ));
+   TEST(( ldlt_tpp_test(0.01, 1e-20, true, false, 233, 122, 8) ));
+   TEST(( ldlt_tpp_test(0.01, 1e-20, true, false, 500, 500, 32) ));
+   TEST(( ldlt_tpp_test(0.01, 1e-20, false, true, 233, 122, 8) ));
+   TEST(( ldlt_tpp_test(0.01, 1e-20, true, true, 500, 500, 32) ));
+   TEST(( ldlt_tpp_test(0.01, 1e-20, true, true, 700, 600, 2) ));
+   TEST(( ldlt_tpp_torture_test(0.01, 1e-20, 500, 100, 100, 4) ));
+   TEST(( ldlt_tpp_torture_test(0.01, 1e-20, 500, 100, 50, 8) ));
+
+   /* Blocked against unblocked */
+   TEST(( ldlt_tpp_blocked_test(0.01, 1e-20, false, 100, 100, 8) ));
+   TEST(( ldlt_tpp_blocked_test(0.01, 1e-20, true, 233, 122, 8) ));
+   TEST(( ldlt_tpp_blocked_test(0.01, 1e-20, true, 233, 122, 4) ));
+   TEST(( ldlt_tpp_blocked_test(0.01, 1e-20, true, 500, 500, 32) ));
+   TEST(( ldlt_tpp_blocked_test(0.5, 1e-20, true, 300, 300, 2) ));
+   TEST(( ldlt_tpp_blocked_torture_test(0.01, 1e-20, 500, 100, 60) ));
+
    return nerr;
 }
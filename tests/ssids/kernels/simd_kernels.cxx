@@ -0,0 +1,333 @@
+/* Copyright 2016 The Science and Technology Facilities Council (STFC)
+ *
+ * Authors: Jonathan Hogg (STFC)
+ *
+ * IMPORTANT: This file is NOT licenced under the BSD licence. If you wish to
+ * licence this code, please contact STFC via hsl@stfc.ac.uk
+ * (We are currently deciding what licence to release this code under if it
+ * proves to be useful beyond our own academic experiments)
+ *
+ */
+#include "simd_kernels.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+#include "framework.hxx"
+#include "AlignedAllocator.hxx"
+#include "ssids/cpu/cpu_iface.hxx"
+#include "ssids/cpu/kernels/simd_kernels.hxx"
+
+using namespace spral::ssids::cpu;
+using spral::test::AlignedAllocator;
+
+namespace {
+
+/// Return a uniform random number in [-0.5, 0.5)
+double rand_val() {
+   return ((double) rand()) / RAND_MAX - 0.5;
+}
+
+/// Return largest relative difference between x and y
+double max_diff(int n, double const* x, double const* y) {
+   double maxerr = 0.0;
+   for(int i=0; i<n; ++i) {
+      if(x[i] == y[i]) continue; // handles infinities
+      maxerr = std::max(maxerr,
+            fabs(x[i] - y[i]) / std::max(1.0, fabs(y[i])));
+   }
+   return maxerr;
+}
+
+/// Generate pivots of D with a mix of 1x1, 2x2 and zero pivots
+void gen_d(int n, double* d) {
+   for(int i=0; i<n; ) {
+      if(i+1<n && i%5==3) {
+         // 2x2 pivot
+         d[2*i]   = 2.0 + rand_val();
+         d[2*i+1] = rand_val();
+         d[2*i+2] = std::numeric_limits<double>::infinity();
+         d[2*i+3] = 2.0 + rand_val();
+         i += 2;
+      } else {
+         // 1x1 pivot
+         d[2*i]   = (i%7==6) ? 0.0 : 1.0 + rand_val();
+         d[2*i+1] = 0.0;
+         i++;
+      }
+   }
+}
+
+/// Compare block_ldlt() of kernels against reference kernels
+int test_block_ldlt(SimdKernels<double> const& kernels,
+      SimdKernels<double> const& ref) {
+   bool failed = false;
+   int const n = SIMD_KERNELS_BLOCK_SIZE;
+   int const lda = align_lda<double>(n);
+   AlignedAllocator<double> alloc;
+   double* a = alloc.allocate(n*lda);
+   double* l = alloc.allocate(n*lda);
+   double* lref = alloc.allocate(n*lda);
+   double* ld = alloc.allocate(n*n);
+   double d[2*n], dref[2*n];
+   int perm[n], permref[n];
+   gen_sym_indef(n, a, lda);
+   for(int i=0; i<n; ++i) perm[i] = permref[i] = i;
+   memcpy(l, a, n*lda*sizeof(double));
+   memcpy(lref, a, n*lda*sizeof(double));
+
+   kernels.block_ldlt(0, perm, l, lda, d, ld, true, 0.01, 1e-20, nullptr);
+   ref.block_ldlt(0, permref, lref, lda, dref, ld, true, 0.01, 1e-20,
+         nullptr);
+
+   for(int i=0; i<n; ++i) {
+      EXPECT_EQ(perm[i], permref[i]);
+   }
+   double lerr = 0.0;
+   for(int j=0; j<n; ++j)
+      lerr = std::max(lerr, max_diff(n-j, &l[j*lda+j], &lref[j*lda+j]));
+   EXPECT_LE(lerr, 1e-10);
+   EXPECT_LE(max_diff(2*n, d, dref), 1e-10);
+
+   alloc.deallocate(a, n*lda);
+   alloc.deallocate(l, n*lda);
+   alloc.deallocate(lref, n*lda);
+   alloc.deallocate(ld, n*n);
+   return (failed) ? -1 : 0;
+}
+
+/// Compare calcLD() of kernels against reference kernels
+int test_calcLD(SimdKernels<double> const& kernels,
+      SimdKernels<double> const& ref, bool trans, int m, int n) {
+   bool failed = false;
+   int const ldl = align_lda<double>(std::max(m, n));
+   int const ldld = align_lda<double>(m);
+   AlignedAllocator<double> alloc;
+   double* l = alloc.allocate(ldl*std::max(m, n));
+   double* ld = alloc.allocate(n*ldld);
+   double* ldref = alloc.allocate(n*ldld);
+   double* d = new double[2*n];
+   for(int i=0; i<ldl*std::max(m, n); ++i) l[i] = rand_val();
+   gen_d(n, d);
+
+   if(trans) {
+      kernels.calcLD_T(m, n, l, ldl, d, ld, ldld);
+      ref.calcLD_T(m, n, l, ldl, d, ldref, ldld);
+   } else {
+      kernels.calcLD_N(m, n, l, ldl, d, ld, ldld);
+      ref.calcLD_N(m, n, l, ldl, d, ldref, ldld);
+   }
+   double err = 0.0;
+   for(int j=0; j<n; ++j)
+      err = std::max(err, max_diff(m, &ld[j*ldld], &ldref[j*ldld]));
+   EXPECT_LE(err, 1e-14);
+
+   alloc.deallocate(l, ldl*std::max(m, n));
+   alloc.deallocate(ld, n*ldld);
+   alloc.deallocate(ldref, n*ldld);
+   delete[] d;
+   return (failed) ? -1 : 0;
+}
+
+/// Compare apply_pivot() and check_threshold() of kernels against reference
+int test_apply_pivot(SimdKernels<double> const& kernels,
+      SimdKernels<double> const& ref, bool trans, int m, int n) {
+   bool failed = false;
+   int const nelim = trans ? m : n; // Size of diagonal block
+   int const lda = align_lda<double>(std::max(m, nelim));
+   AlignedAllocator<double> alloc;
+   double* diag = alloc.allocate(nelim*lda);
+   double* aval = alloc.allocate(n*lda);
+   double* avalref = alloc.allocate(n*lda);
+   double* d = new double[2*nelim];
+   for(int i=0; i<nelim*lda; ++i) diag[i] = rand_val();
+   for(int i=0; i<n*lda; ++i) aval[i] = avalref[i] = 4*rand_val();
+   gen_d(nelim, d);
+   double const u = 0.1;
+
+   int npass, npassref;
+   if(trans) {
+      kernels.apply_pivot_T(m, n, 0, diag, d, 1e-20, aval, lda);
+      ref.apply_pivot_T(m, n, 0, diag, d, 1e-20, avalref, lda);
+      npass = kernels.check_threshold_T(0, m, 0, n, u, aval, lda);
+      npassref = ref.check_threshold_T(0, m, 0, n, u, avalref, lda);
+   } else {
+      kernels.apply_pivot_N(m, n, 0, diag, d, 1e-20, aval, lda);
+      ref.apply_pivot_N(m, n, 0, diag, d, 1e-20, avalref, lda);
+      npass = kernels.check_threshold_N(0, m, 0, n, u, aval, lda);
+      npassref = ref.check_threshold_N(0, m, 0, n, u, avalref, lda);
+   }
+   double err = 0.0;
+   for(int j=0; j<n; ++j)
+      err = std::max(err, max_diff(m, &aval[j*lda], &avalref[j*lda]));
+   EXPECT_LE(err, 1e-12);
+   EXPECT_EQ(npass, npassref);
+
+   alloc.deallocate(diag, nelim*lda);
+   alloc.deallocate(aval, n*lda);
+   alloc.deallocate(avalref, n*lda);
+   delete[] d;
+   return (failed) ? -1 : 0;
+}
+
+/// Generate n distinct increasing row indices, with runs of consecutive
+/// rows of length around runlen separated by gaps
+void gen_asm_idx(int n, int runlen, int* idx) {
+   for(int i=0, row=0; i<n; ++i) {
+      row += (runlen>0 && (rand() % runlen)) ? 1 : 1 + rand()%3;
+      idx[i] = row;
+   }
+}
+
+/// Set run[] as required by asm_col() (a copy of find_runs())
+void calc_runs(int n, int const* idx, int* run) {
+   int len = 0;
+   for(int j=n-1; j>=0; --j) {
+      len = (j+1<n && idx[j+1] == idx[j]+1) ? len+1 : 1;
+      if(len >= ASM_COL_MIN_RUN) run[j] = len;
+      else run[j] = (j+1<n && run[j+1] < 0) ? run[j+1]-1 : -1;
+   }
+}
+
+/// Compare asm_col() of kernels against reference kernels and a simple loop
+int test_asm_col(SimdKernels<double> const& kernels,
+      SimdKernels<double> const& ref, int n, int runlen) {
+   bool failed = false;
+   int const ldest = 3*n+1;
+   int* idx = new int[n];
+   int* run = new int[n];
+   double* src = new double[n];
+   double* dest = new double[ldest];
+   double* destref = new double[ldest];
+   double* destloop = new double[ldest];
+   gen_asm_idx(n, runlen, idx);
+   calc_runs(n, idx, run);
+   for(int i=0; i<n; ++i) src[i] = rand_val();
+   for(int i=0; i<ldest; ++i)
+      dest[i] = destref[i] = destloop[i] = rand_val();
+
+   kernels.asm_col(n, idx, run, src, dest);
+   ref.asm_col(n, idx, run, src, destref);
+   for(int i=0; i<n; ++i) destloop[idx[i]] += src[i];
+   EXPECT_LE(max_diff(ldest, dest, destref), 0.0);
+   EXPECT_LE(max_diff(ldest, dest, destloop), 0.0);
+
+   delete[] idx;
+   delete[] run;
+   delete[] src;
+   delete[] dest;
+   delete[] destref;
+   delete[] destloop;
+   return (failed) ? -1 : 0;
+}
+
+/// Return average time in microseconds of extend-add of a cm x cm child
+/// contribution block into a parent of leading dimension ldp using asm
+template <typename Asm>
+double time_extend_add(int cm, int const* idx, double const* src,
+      double* dest, int ldp, Asm asm_col) {
+   typedef std::chrono::steady_clock clock;
+   // Choose number of repetitions so each measurement is ~10ms
+   int nrep = std::max(5, static_cast<int>(2e7 / ((double) cm*cm+1000)));
+   auto start = clock::now();
+   for(int rep=0; rep<nrep; ++rep)
+      for(int i=0; i<cm; ++i)
+         asm_col(i, &src[i*cm], &dest[idx[i]*ldp]);
+   auto stop = clock::now();
+   return std::chrono::duration<double, std::micro>(stop-start).count() / nrep;
+}
+
+/// Test kernels for given instruction set against default kernels
+int test_simd_kernels(enum cpu_arch arch) {
+   SimdKernels<double> const* kernels = get_simd_kernels(arch);
+   if(!kernels) return 0; // Not built or not supported by this CPU
+   SimdKernels<double> const& ref = *get_simd_kernels(CPU_BEST_ARCH);
+
+   int nerr = 0;
+   nerr += test_block_ldlt(*kernels, ref);
+   nerr += test_calcLD(*kernels, ref, false, 37, 16);
+   nerr += test_calcLD(*kernels, ref, true, 37, 16);
+   nerr += test_calcLD(*kernels, ref, false, 3, 5);
+   nerr += test_apply_pivot(*kernels, ref, false, 45, 16);
+   nerr += test_apply_pivot(*kernels, ref, true, 16, 29);
+   nerr += test_asm_col(*kernels, ref, 1, 0);
+   nerr += test_asm_col(*kernels, ref, 53, 0);
+   nerr += test_asm_col(*kernels, ref, 53, 4);
+   nerr += test_asm_col(*kernels, ref, 101, 30);
+   nerr += test_asm_col(*kernels, ref, 64, 1000); // one long run
+   return (nerr) ? -1 : 0;
+}
+
+} /* anon namespace */
+
+int run_simd_kernels_tests() {
+   int nerr = 0;
+
+   /* Test each instruction set built for and supported by this CPU */
+   printf("Runtime selected cpu_isa = %d\n",
+         static_cast<int>(get_simd_kernels<double>().arch));
+   TEST(test_simd_kernels(CPU_ARCH_AVX));
+   TEST(test_simd_kernels(CPU_ARCH_AVX2));
+   TEST(test_simd_kernels(CPU_ARCH_AVX512));
+   TEST(test_simd_kernels(CPU_ARCH_NEON));
+
+   return nerr;
+}
+
+/** Assembly micro-benchmark: extend-add of a child contribution block into
+ *  its parent using asm_col() of each instruction set, for row patterns
+ *  ranging from scattered to a single contiguous run. Includes the cost of
+ *  finding the runs, which is done once per child (block) column. */
+void run_simd_kernels_bench() {
+   int const cmvals[] = { 32, 128, 512, 1024 };
+   int const runvals[] = { 0, 4, 32, 1<<30 };
+   enum cpu_arch const archs[] = {
+      CPU_ARCH_GENERIC, CPU_ARCH_AVX, CPU_ARCH_AVX2, CPU_ARCH_AVX512,
+      CPU_ARCH_NEON
+   };
+
+   printf("Extend-add of cm x cm child (times in us, speedup vs scalar loop)\n");
+   printf("%5s %8s | %10s", "cm", "runlen", "scalar");
+   for(auto arch : archs)
+      if(get_simd_kernels(arch)) printf(" | %18s%d", "isa ", arch);
+   printf("\n");
+   for(int cm : cmvals) {
+      for(int runlen : runvals) {
+         int* idx = new int[cm];
+         int* run = new int[cm];
+         gen_asm_idx(cm, runlen, idx);
+         int ldp = idx[cm-1]+1;
+         double* src = new double[cm*cm];
+         double* dest = new double[ldp*ldp];
+         for(int i=0; i<cm*cm; ++i) src[i] = rand_val();
+         for(int i=0; i<ldp*ldp; ++i) dest[i] = 0.0;
+         double tscalar = time_extend_add(cm, idx, src, dest, ldp,
+               [&](int i, double const* col, double* dcol) {
+                  for(int j=i; j<cm; ++j) dcol[ idx[j] ] += col[j];
+               });
+         char runstr[16] = "all";
+         if(runlen < cm) snprintf(runstr, sizeof(runstr), "%d", runlen);
+         printf("%5d %8s | %10.2f", cm, runstr, tscalar);
+         for(auto arch : archs) {
+            SimdKernels<double> const* kernels = get_simd_kernels(arch);
+            if(!kernels) continue;
+            double t = time_extend_add(cm, idx, src, dest, ldp,
+                  [&](int i, double const* col, double* dcol) {
+                     if(i==0) calc_runs(cm, idx, run);
+                     kernels->asm_col(cm-i, &idx[i], &run[i], &col[i], dcol);
+                  });
+            printf(" | %10.2f %7.2fx", t, tscalar/t);
+         }
+         printf("\n");
+         delete[] idx;
+         delete[] run;
+         delete[] src;
+         delete[] dest;
+      }
+   }
+}
@@ -0,0 +1,208 @@
+/* Copyright 2016 The Science and Technology Facilities Council (STFC)
+ *
+ * Authors: Jonathan Hogg (STFC)
+ *
+ * IMPORTANT: This file is NOT licenced under the BSD licence. If you wish to
+ * licence this code, please contact STFC via hsl@stfc.ac.uk
+ * (We are currently deciding what licence to release this code under if it
+ * proves to be useful beyond our own academic experiments)
+ *
+ */
+#include "small_solve.hxx"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#include "framework.hxx"
+#include "ssids/cpu/kernels/small_solve.hxx"
+#include "ssids/cpu/kernels/wrappers.hxx"
+
+using namespace spral::ssids::cpu;
+
+namespace {
+
+/// Generate a random m x n lower trapezoidal matrix with strong diagonal
+void gen_lower(int m, int n, double* l, int ldl) {
+   for(int j=0; j<n; ++j) {
+      for(int i=0; i<m; ++i)
+         l[j*ldl+i] = ((double) rand()) / RAND_MAX - 0.5;
+      l[j*ldl+j] = 2.0 + ((double) rand()) / RAND_MAX;
+   }
+}
+
+/// Generate random right-hand sides
+void gen_x(int m, int nrhs, double* x, int ldx) {
+   for(int r=0; r<nrhs; ++r)
+   for(int i=0; i<m; ++i)
+      x[r*ldx+i] = ((double) rand()) / RAND_MAX - 0.5;
+}
+
+/// Reference forward solve using BLAS
+void blas_solve_fwd(bool unit_diag, int m, int n, double const* l, int ldl,
+      int nrhs, double* x, int ldx) {
+   enum diagonal diag = (unit_diag) ? DIAG_UNIT : DIAG_NON_UNIT;
+   if(nrhs==1) {
+      host_trsv(FILL_MODE_LWR, OP_N, diag, n, l, ldl, x, 1);
+      if(m > n)
+         gemv(OP_N, m-n, n, -1.0, &l[n], ldl, x, 1, 1.0, &x[n], 1);
+   } else {
+      host_trsm(SIDE_LEFT, FILL_MODE_LWR, OP_N, diag, n, nrhs, 1.0, l, ldl,
+            x, ldx);
+      if(m > n)
+         host_gemm(OP_N, OP_N, m-n, nrhs, n, -1.0, &l[n], ldl, x, ldx, 1.0,
+               &x[n], ldx);
+   }
+}
+
+/// Reference backward solve using BLAS
+void blas_solve_bwd(bool unit_diag, int m, int n, double const* l, int ldl,
+      int nrhs, double* x, int ldx) {
+   enum diagonal diag = (unit_diag) ? DIAG_UNIT : DIAG_NON_UNIT;
+   if(nrhs==1) {
+      if(m > n)
+         gemv(OP_T, m-n, n, -1.0, &l[n], ldl, &x[n], 1, 1.0, x, 1);
+      host_trsv(FILL_MODE_LWR, OP_T, diag, n, l, ldl, x, 1);
+   } else {
+      if(m > n)
+         host_gemm(OP_T, OP_N, n, nrhs, m-n, -1.0, &l[n], ldl, &x[n], ldx,
+               1.0, x, ldx);
+      host_trsm(SIDE_LEFT, FILL_MODE_LWR, OP_T, diag, n, nrhs, 1.0, l, ldl,
+            x, ldx);
+   }
+}
+
+/// Small kernel solve, dispatching on unit_diag at runtime
+void small_solve(bool fwd, bool unit_diag, int m, int n, double const* l,
+      int ldl, int nrhs, double* x, int ldx) {
+   if(fwd) {
+      if(unit_diag) small_solve_fwd<double, true>(m, n, l, ldl, nrhs, x, ldx);
+      else          small_solve_fwd<double, false>(m, n, l, ldl, nrhs, x, ldx);
+   } else {
+      if(unit_diag) small_solve_bwd<double, true>(m, n, l, ldl, nrhs, x, ldx);
+      else          small_solve_bwd<double, false>(m, n, l, ldl, nrhs, x, ldx);
+   }
+}
+
+/// Compare small kernel against BLAS for given problem
+int test_small_solve(bool fwd, bool unit_diag, int m, int n, int nrhs) {
+   int ldl = m + 1; // deliberately unaligned
+   int ldx = m + 3;
+   double* l = new double[n*ldl];
+   double* x = new double[nrhs*ldx];
+   double* xref = new double[nrhs*ldx];
+   gen_lower(m, n, l, ldl);
+   gen_x(m, nrhs, x, ldx);
+   memcpy(xref, x, nrhs*ldx*sizeof(double));
+
+   small_solve(fwd, unit_diag, m, n, l, ldl, nrhs, x, ldx);
+   if(fwd) blas_solve_fwd(unit_diag, m, n, l, ldl, nrhs, xref, ldx);
+   else    blas_solve_bwd(unit_diag, m, n, l, ldl, nrhs, xref, ldx);
+
+   double maxerr = 0.0;
+   for(int r=0; r<nrhs; ++r)
+   for(int i=0; i<m; ++i) {
+      double err = fabs(x[r*ldx+i] - xref[r*ldx+i]) /
+         std::max(1.0, fabs(xref[r*ldx+i]));
+      maxerr = std::max(maxerr, err);
+   }
+
+   delete[] l;
+   delete[] x;
+   delete[] xref;
+
+   ASSERT_LE(maxerr, 1e-12);
+   return 0; // Test passed
+}
+
+/// Return average time per call in microseconds of the given solve
+template <typename Solve>
+double time_solve(int m, int nrhs, double* x, double const* x0, int ldx,
+      Solve solve) {
+   typedef std::chrono::steady_clock clock;
+   // Choose number of repetitions so each measurement is ~10ms
+   int nrep = std::max(10, static_cast<int>(1e7 / (m*nrhs*8+1000)));
+   auto start = clock::now();
+   for(int rep=0; rep<nrep; ++rep) {
+      memcpy(x, x0, nrhs*ldx*sizeof(double));
+      solve(x);
+   }
+   auto stop = clock::now();
+   return std::chrono::duration<double, std::micro>(stop-start).count() / nrep;
+}
+
+} /* anon namespace */
+
+int run_small_solve_tests() {
+   int nerr = 0;
+
+   /* Tests (fwd, unit_diag, m, n, nrhs) */
+   TEST(test_small_solve(true, true, 1, 1, 1));
+   TEST(test_small_solve(true, false, 1, 1, 1));
+   TEST(test_small_solve(true, true, 7, 7, 3));
+   TEST(test_small_solve(true, false, 17, 5, 1));
+   TEST(test_small_solve(true, true, 33, 13, 2));
+   TEST(test_small_solve(true, false, 64, 32, 8));
+   TEST(test_small_solve(true, true, 101, 64, 13));
+   TEST(test_small_solve(true, false, 40, 40, 32));
+   TEST(test_small_solve(false, true, 1, 1, 1));
+   TEST(test_small_solve(false, false, 1, 1, 1));
+   TEST(test_small_solve(false, true, 7, 7, 3));
+   TEST(test_small_solve(false, false, 17, 5, 1));
+   TEST(test_small_solve(false, true, 33, 13, 2));
+   TEST(test_small_solve(false, false, 64, 32, 8));
+   TEST(test_small_solve(false, true, 101, 64, 13));
+   TEST(test_small_solve(false, false, 40, 40, 32));
+
+   return nerr;
+}
+
+/** Micro-benchmark comparing small solve kernels against BLAS, used to
+ *  determine the crossover points in use_small_solve(). */
+void run_small_solve_bench() {
+   /* Front shapes (m, n): thin, square and tall, up to where BLAS wins */
+   int const shapes[][2] = {
+      { 4, 1 }, { 16, 1 }, { 32, 1 }, { 64, 1 }, { 128, 1 },
+      { 4, 2 }, { 8, 4 }, { 16, 4 }, { 32, 4 }, { 4, 4 }, { 8, 8 },
+      { 16, 8 }, { 32, 8 }, { 16, 16 }, { 32, 16 }, { 64, 32 }, { 128, 64 }
+   };
+   int const rhsvals[] = { 1, 2, 4, 8, 16, 32 };
+
+   printf("Small solve kernels vs BLAS (times in us per call)\n");
+   printf("%5s %5s %4s | %10s %10s %7s | %10s %10s %7s | %s\n",
+         "m", "n", "nrhs", "fwd small", "fwd blas", "speedup",
+         "bwd small", "bwd blas", "speedup", "dispatch");
+   for(auto const& shape : shapes) {
+      int m = shape[0];
+      int n = shape[1];
+      int ldl = m;
+      double* l = new double[n*ldl];
+      gen_lower(m, n, l, ldl);
+      for(int nrhs : rhsvals) {
+         int ldx = m;
+         double* x0 = new double[nrhs*ldx];
+         double* x = new double[nrhs*ldx];
+         gen_x(m, nrhs, x0, ldx);
+         double tfs = time_solve(m, nrhs, x, x0, ldx, [&](double* xx) {
+               small_solve_fwd<double, true>(m, n, l, ldl, nrhs, xx, ldx);
+               });
+         double tfb = time_solve(m, nrhs, x, x0, ldx, [&](double* xx) {
+               blas_solve_fwd(true, m, n, l, ldl, nrhs, xx, ldx);
+               });
+         double tbs = time_solve(m, nrhs, x, x0, ldx, [&](double* xx) {
+               small_solve_bwd<double, true>(m, n, l, ldl, nrhs, xx, ldx);
+               });
+         double tbb = time_solve(m, nrhs, x, x0, ldx, [&](double* xx) {
+               blas_solve_bwd(true, m, n, l, ldl, nrhs, xx, ldx);
+               });
+         printf("%5d %5d %4d | %10.3f %10.3f %7.2f | %10.3f %10.3f %7.2f | %s\n",
+               m, n, nrhs, tfs, tfb, tfb/tfs, tbs, tbb, tbb/tbs,
+               use_small_solve(m, n, nrhs) ? "small" : "blas");
+         delete[] x0;
+         delete[] x;
+      }
+      delete[] l;
+   }
+}
@@ -0,0 +1,289 @@
+/* Copyright 2016 The Science and Technology Facilities Council (STFC)
+ *
+ * Authors: Jonathan Hogg (STFC)
+ *
+ * IMPORTANT: This file is NOT licenced under the BSD licence. If you wish to
+ * licence this code, please contact STFC via hsl@stfc.ac.uk
+ * (We are currently deciding what licence to release this code under if it
+ * proves to be useful beyond our own academic experiments)
+ *
+ */
+#include "thread_cache_alloc.hxx"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif /* _OPENMP */
+
+#include "framework.hxx"
+#include "ssids/cpu/BuddyAllocator.hxx"
+#include "ssids/cpu/MemoryBudget.hxx"
+#include "ssids/cpu/ThreadCacheAllocator.hxx"
+
+using namespace spral::ssids::cpu;
+
+namespace {
+
+typedef ThreadCacheAllocator<double, std::allocator<double>> TCAlloc;
+typedef BuddyAllocator<double, std::allocator<double>> BAlloc;
+
+/// Simple per-thread pseudo random number generator
+int next_rand(unsigned int& state) {
+   state = 1103515245u*state + 12345u;
+   return (state >> 8) & 0xffffff;
+}
+
+int get_thread_num() {
+#ifdef _OPENMP
+   return omp_get_thread_num();
+#else
+   return 0;
+#endif /* _OPENMP */
+}
+
+int get_num_threads() {
+#ifdef _OPENMP
+   return omp_get_num_threads();
+#else
+   return 1;
+#endif /* _OPENMP */
+}
+
+/// Sizes (in doubles) used for tests, including some beyond the largest class
+int const test_sizes[] = { 0, 1, 7, 8, 100, 1000, 32767, 131072, 200000 };
+
+int thread_cache_alloc_test_serial() {
+   bool failed = false;
+
+   TCAlloc alloc(1000);
+   std::vector<double*> ptrs;
+   // Allocate twice, so the second round must carve new blocks
+   for(int round=0; round<2; ++round) {
+      for(int sz : test_sizes) {
+         double* ptr = alloc.allocate(sz);
+         EXPECT_EQ(reinterpret_cast<uintptr_t>(ptr) % 16, 0u);
+         for(int i=0; i<sz; ++i) ptr[i] = sz + i;
+         ptrs.push_back(ptr);
+      }
+   }
+   // Check contents are intact, then free
+   int k = 0;
+   for(int round=0; round<2; ++round) {
+      for(int sz : test_sizes) {
+         double* ptr = ptrs[k++];
+         for(int i=0; i<sz; ++i)
+            if(ptr[i] != sz+i) failed = true;
+         alloc.deallocate(ptr, sz);
+      }
+   }
+   EXPECT_EQ(failed, false);
+   // Freed blocks must be reused
+   double* ptr = alloc.allocate(1000);
+   EXPECT_EQ(ptr, ptrs[5+sizeof(test_sizes)/sizeof(int)]);
+   alloc.deallocate(ptr, 1000);
+
+   // Allocator rebound to another type shares the pool
+   typedef std::allocator_traits<TCAlloc>::rebind_alloc<int> IntAlloc;
+   IntAlloc ialloc(alloc);
+   int* iptr = ialloc.allocate(10);
+   for(int i=0; i<10; ++i) iptr[i] = i;
+   ialloc.deallocate(iptr, 10);
+
+   return failed ? -1 : 0;
+}
+
+/// Memory held by the pool is charged to a budget, including cached blocks
+int thread_cache_alloc_test_budget() {
+   bool failed = false;
+
+   int64_t const limit = 1<<30;
+   MemoryBudget budget;
+   budget.reset(limit);
+   TCAlloc alloc(1000);
+   alloc.set_budget(&budget);
+
+   // Blocks are charged at their rounded size, and stay charged when cached
+   size_t const small = 100000; // rounded up to largest class
+   size_t const large = 200000; // passed to underlying allocator
+   size_t const held = TCAlloc::footprint(small);
+   EXPECT_EQ(held, size_t(1)<<20);
+   double* ptr = alloc.allocate(small);
+   EXPECT_EQ(budget.get_available(), limit - held);
+   alloc.deallocate(ptr, small);
+   EXPECT_EQ(budget.get_available(), limit - held);
+   ptr = alloc.allocate(small);
+   alloc.deallocate(ptr, small);
+   EXPECT_EQ(budget.get_peak(), static_cast<int64_t>(held));
+
+   // Large blocks are only charged while in use
+   ptr = alloc.allocate(large);
+   EXPECT_EQ(budget.get_available(), limit - held - TCAlloc::footprint(large));
+   alloc.deallocate(ptr, large);
+   EXPECT_EQ(budget.get_available(), limit - held);
+
+#ifdef __linux__
+   // Giving the pages of cached blocks back to the system uncharges them
+   alloc.release_cached();
+   EXPECT_EQ(budget.get_available(), static_cast<size_t>(limit));
+   ptr = alloc.allocate(small);
+   for(size_t i=0; i<small; ++i) ptr[i] = i;
+   EXPECT_EQ(budget.get_available(), limit - held);
+   alloc.deallocate(ptr, small);
+#endif /* __linux__ */
+
+   // Memory held is moved off the budget with the pool
+   alloc.set_budget(nullptr);
+   EXPECT_EQ(budget.get_available(), static_cast<size_t>(limit));
+
+   return failed ? -1 : 0;
+}
+
+/// Every thread allocates blocks, then each frees those of its neighbour
+int thread_cache_alloc_test_parallel(int nround, int nblk) {
+   bool failed = false;
+
+   TCAlloc alloc(1000);
+   int nthread = 1;
+#ifdef _OPENMP
+   nthread = omp_get_max_threads();
+#endif /* _OPENMP */
+   std::vector<double*> ptrs(nthread*nblk);
+   std::vector<int> sizes(nthread*nblk);
+   #pragma omp parallel default(shared)
+   {
+      int t = get_thread_num();
+      int nt = get_num_threads();
+      unsigned int state = 17*t+1;
+      for(int round=0; round<nround; ++round) {
+         for(int i=0; i<nblk; ++i) {
+            int sz = next_rand(state) % ((i%16==0) ? 150000 : 2000);
+            double* ptr = alloc.allocate(sz);
+            for(int j=0; j<sz; ++j) ptr[j] = t*nblk + i;
+            ptrs[t*nblk+i] = ptr;
+            sizes[t*nblk+i] = sz;
+         }
+         #pragma omp barrier
+         int s = (t+round+1) % nt; // free another thread's blocks
+         for(int i=0; i<nblk; ++i) {
+            double* ptr = ptrs[s*nblk+i];
+            int sz = sizes[s*nblk+i];
+            for(int j=0; j<sz; ++j)
+               if(ptr[j] != s*nblk + i) {
+                  #pragma omp atomic write
+                  failed = true;
+                  break;
+               }
+            alloc.deallocate(ptr, sz);
+         }
+         #pragma omp barrier
+      }
+   }
+   EXPECT_EQ(failed, false);
+
+   return failed ? -1 : 0;
+}
+
+/// Time nops allocation/deallocation pairs per thread of sizes typical of
+/// contribution blocks, with every eighth block freed by another thread.
+/// Returns time in seconds.
+template <typename Allocator>
+double time_alloc(Allocator& alloc, int nops) {
+   int const nheld = 64;
+   int nthread = 1;
+#ifdef _OPENMP
+   nthread = omp_get_max_threads();
+#endif /* _OPENMP */
+   std::vector<double*> held(nthread*nheld);
+   std::vector<int> held_sz(nthread*nheld);
+   auto start = std::chrono::high_resolution_clock::now();
+   #pragma omp parallel default(shared)
+   {
+      int t = get_thread_num();
+      int nt = get_num_threads();
+      unsigned int state = 31*t+7;
+      double* mine[nheld];
+      int mine_sz[nheld];
+      for(int i=0; i<nheld; ++i) {
+         mine_sz[i] = 1 + next_rand(state) % 4096;
+         mine[i] = alloc.allocate(mine_sz[i]);
+      }
+      for(int op=0; op<nops; ++op) {
+         int i = next_rand(state) % nheld;
+         alloc.deallocate(mine[i], mine_sz[i]);
+         mine_sz[i] = 1 + next_rand(state) % 4096;
+         mine[i] = alloc.allocate(mine_sz[i]);
+         mine[i][0] = op;
+         if(op % (8*nheld) == 8*nheld-1) {
+            // Hand every eighth block to the next thread to free
+            for(int j=0; j<nheld; j+=8) {
+               held[t*nheld+j] = mine[j];
+               held_sz[t*nheld+j] = mine_sz[j];
+               mine_sz[j] = 1 + next_rand(state) % 4096;
+               mine[j] = alloc.allocate(mine_sz[j]);
+            }
+            #pragma omp barrier
+            int s = (t+1) % nt;
+            for(int j=0; j<nheld; j+=8)
+               alloc.deallocate(held[s*nheld+j], held_sz[s*nheld+j]);
+            #pragma omp barrier
+         }
+      }
+      for(int i=0; i<nheld; ++i)
+         alloc.deallocate(mine[i], mine_sz[i]);
+   }
+   auto end = std::chrono::high_resolution_clock::now();
+   return 1e-9*std::chrono::duration_cast<std::chrono::nanoseconds>(
+         end-start).count();
+}
+
+} /* anon namespace */
+
+int run_thread_cache_alloc_tests() {
+   int nerr = 0;
+
+   TEST(( thread_cache_alloc_test_serial() ));
+   TEST(( thread_cache_alloc_test_budget() ));
+   TEST(( thread_cache_alloc_test_parallel(1, 10) ));
+   TEST(( thread_cache_alloc_test_parallel(20, 200) ));
+
+   return nerr;
+}
+
+/** Micro-benchmark comparing contention of ThreadCacheAllocator against
+ *  BuddyAllocator for an increasing number of threads. */
+void run_thread_cache_alloc_bench() {
+   int const nops = 200000;
+   int maxthread = 1;
+#ifdef _OPENMP
+   maxthread = omp_get_max_threads();
+#endif /* _OPENMP */
+
+   printf("Pool allocator contention (times in ns per alloc/free pair)\n");
+   printf("%8s | %10s %10s %7s\n", "threads", "buddy", "thread", "speedup");
+   for(int nt=1; ; nt=std::min(2*nt, maxthread)) {
+#ifdef _OPENMP
+      omp_set_num_threads(nt); // NB: before constructing allocators
+#endif /* _OPENMP */
+      double tb, tc;
+      {
+         BAlloc alloc(1<<20);
+         tb = time_alloc(alloc, nops);
+      }
+      {
+         TCAlloc alloc(1<<20);
+         tc = time_alloc(alloc, nops);
+      }
+      printf("%8d | %10.1f %10.1f %7.2f\n", nt, 1e9*tb/nops, 1e9*tc/nops,
+            tb/tc);
+      if(nt == maxthread) break;
+   }
+#ifdef _OPENMP
+   omp_set_num_threads(maxthread);
+#endif /* _OPENMP */
+}
@@ -1148,6 +1148,9 @@ subroutine test_special
    logical :: posdef
    integer :: st, cuda_error
    integer :: test
+   integer(long) :: backup_peak, pool_peak
+   integer :: nfail
+   type(ssids_inform) :: pinfo
    integer, dimension(:), allocatable :: order
    real(wp), dimension(:), allocatable :: scale
    real(wp), dimension(:), allocatable :: x1
@@ -1399,6 +1402,248 @@ subroutine test_special
    call chk_answer(.true., a, akeep, options, rhs, x, res, SSIDS_SUCCESS)
    call ssids_free(akeep, cuda_error)
 
+   ! Test grid matrices, whose separator nodes form chains that build
+   ! contribution blocks in place [for coverage]
+   do test = 1, 2
+      posdef = (test.eq.1)
+      if(posdef) then
+         write(*,"(a)",advance="no") &
+            " * Testing n=10000, posdef, 2D grid......"
+         call gen_grid(100, 4.5_wp, a%n, a%ptr, a%row, a%val)
+      else
+         write(*,"(a)",advance="no") &
+            " * Testing n=10000, indef, 2D grid......."
+         call gen_grid(100, 1.0_wp, a%n, a%ptr, a%row, a%val)
+      endif
+      call ssids_analyse(check, a%n, a%ptr, a%row, akeep, options, info)
+      call print_result(info%flag,SSIDS_SUCCESS)
+      call gen_rhs(a, rhs, x1, x, res, 1)
+      call chk_answer(posdef, a, akeep, options, rhs, x, res, SSIDS_SUCCESS)
+      call ssids_free(akeep, cuda_error)
+   end do
+
+   ! Test cost model amalgamation on random matrices
+   options%amalg_method = 2
+   do test = 1, 10
+      posdef = (mod(test,2).eq.0)
+      write(*,"(a,i2,a,l1,a)",advance="no") &
+         " * Testing amalg_method=2, no. ", test, ", posdef=", posdef, "..."
+      a%n = 100*test
+      if(posdef) then
+         call gen_random_posdef(a, 5_long*a%n, state)
+      else
+         call gen_random_indef(a, 5_long*a%n, state)
+      endif
+      call ssids_analyse(check, a%n, a%ptr, a%row, akeep, options, info)
+      if(info%flag >= 0 .and. info%factor_time_predicted <= zero) then
+         write(*, "(a,es12.4)") "fail: factor_time_predicted = ", &
+            info%factor_time_predicted
+         errors = errors + 1
+      else
+         call print_result(info%flag, SSIDS_SUCCESS)
+         call gen_rhs(a, rhs, x1, x, res, 1)
+         call chk_answer(posdef, a, akeep, options, rhs, x, res, SSIDS_SUCCESS)
+      endif
+      call ssids_free(akeep, cuda_error)
+   end do
+   options%amalg_method = default_options%amalg_method
+
+   ! Test that predicted factor memory covers the factor entries without
+   ! gross overestimation
+   write(*,"(a)",advance="no") " * Testing memory prediction..............."
+   call gen_grid(100, 1.0_wp, a%n, a%ptr, a%row, a%val)
+   call ssids_analyse(check, a%n, a%ptr, a%row, akeep, options, info)
+   if(info%flag < 0 .or. info%work_mem_predicted <= 0 .or. &
+         info%factor_mem_predicted < 8*info%num_factor .or. &
+         info%factor_mem_predicted > 12*info%num_factor) then
+      write(*, "(a,i4,3(a,i12))") "fail: flag = ", info%flag, &
+         " num_factor = ", info%num_factor, &
+         " factor_mem_predicted = ", info%factor_mem_predicted, &
+         " work_mem_predicted = ", info%work_mem_predicted
+      errors = errors + 1
+   else
+      call print_result(info%flag, SSIDS_SUCCESS)
+   endif
+   call ssids_free(akeep, cuda_error)
+
+   ! Test that a memory budget is respected if factorization in order fits in
+   ! it: a budget of one byte holds every task back until nothing else is
+   ! running, so the pool memory it reports is the least possible
+   write(*,"(a)",advance="no") " * Testing memory budget..................."
+   posdef = .true.
+   call gen_grid(100, 4.5_wp, a%n, a%ptr, a%row, a%val)
+   call ssids_analyse(check, a%n, a%ptr, a%row, akeep, options, info)
+   pool_peak = 0
+   if(info%flag >= 0) then
+      options%memory_budget = 1
+      call ssids_factor(posdef, a%val, akeep, fkeep, options, info)
+      pool_peak = info%contrib_peak
+      call ssids_free(fkeep, cuda_error)
+   endif
+   if(info%flag >= 0 .and. pool_peak > 0) then
+      options%memory_budget = pool_peak
+      call ssids_factor(posdef, a%val, akeep, fkeep, options, info)
+   endif
+   if(info%flag < 0 .or. pool_peak <= 0 .or. info%contrib_peak <= 0 .or. &
+         info%contrib_peak > options%memory_budget) then
+      write(*, "(a,i4,2(a,i12))") "fail: flag = ", info%flag, &
+         " contrib_peak = ", info%contrib_peak, &
+         " budget = ", options%memory_budget
+      errors = errors + 1
+   else
+      call print_result(info%flag, SSIDS_SUCCESS)
+      call gen_rhs(a, rhs, x1, x, res, 1)
+      call chk_answer(posdef, a, akeep, options, rhs, x, res, SSIDS_SUCCESS)
+   endif
+   options%memory_budget = default_options%memory_budget
+   call ssids_free(akeep, fkeep, cuda_error)
+
+   ! Test each type of huge page backing. Huge pages may not be available,
+   ! so only check that none are reported unless requested
+   posdef = .false.
+   call gen_grid(100, 1.0_wp, a%n, a%ptr, a%row, a%val)
+   do test = 0, 2
+      write(*,"(a,i1,a)",advance="no") &
+         " * Testing huge_pages=", test, "................"
+      options%huge_pages = test
+      call ssids_analyse(check, a%n, a%ptr, a%row, akeep, options, info)
+      if(info%flag >= 0) &
+         call ssids_factor(posdef, a%val, akeep, fkeep, options, info)
+      if(info%flag < 0 .or. info%num_huge_pages < 0 .or. &
+            (test.eq.0 .and. info%num_huge_pages.ne.0)) then
+         write(*, "(a,i4,a,i12)") "fail: flag = ", info%flag, &
+            " num_huge_pages = ", info%num_huge_pages
+         errors = errors + 1
+      else
+         call print_result(info%flag, SSIDS_SUCCESS)
+         call gen_rhs(a, rhs, x1, x, res, 1)
+         call chk_answer(posdef, a, akeep, options, rhs, x, res, SSIDS_SUCCESS)
+      endif
+      call ssids_free(akeep, fkeep, cuda_error)
+   end do
+   options%huge_pages = default_options%huge_pages
+
+   ! Test that backups are reported, and that backing up blocks only as
+   ! required under a tight memory budget uses no more memory
+   write(*,"(a)",advance="no") " * Testing backup memory..................."
+   posdef = .false.
+   call gen_grid(100, 1.0_wp, a%n, a%ptr, a%row, a%val)
+   call ssids_analyse(check, a%n, a%ptr, a%row, akeep, options, info)
+   if(info%flag >= 0) &
+      call ssids_factor(posdef, a%val, akeep, fkeep, options, info)
+   backup_peak = info%backup_peak
+   if(info%flag >= 0 .and. backup_peak > 0) then
+      options%memory_budget = 1
+      call ssids_factor(posdef, a%val, akeep, fkeep, options, info)
+      options%memory_budget = default_options%memory_budget
+   endif
+   if(info%flag < 0 .or. backup_peak <= 0 .or. &
+         info%backup_peak > backup_peak) then
+      write(*, "(a,i4,2(a,i12))") "fail: flag = ", info%flag, &
+         " backup_peak = ", backup_peak, &
+         " budgeted backup_peak = ", info%backup_peak
+      errors = errors + 1
+   else
+      call print_result(info%flag, SSIDS_SUCCESS)
+      call gen_rhs(a, rhs, x1, x, res, 1)
+      call chk_answer(posdef, a, akeep, options, rhs, x, res, SSIDS_SUCCESS)
+   endif
+   call ssids_free(akeep, fkeep, cuda_error)
+
+   ! Test the choice of block size per node, as well as the fixed default
+   options%cpu_block_size = 0
+   do test = 0, 1
+      posdef = (test.eq.1)
+      write(*,"(a,l1,a)",advance="no") &
+         " * Testing cpu_block_size=0, posdef=", posdef, "......."
+      call gen_grid(100, merge(4.5_wp, 1.0_wp, posdef), a%n, a%ptr, a%row, &
+         a%val)
+      call ssids_analyse(check, a%n, a%ptr, a%row, akeep, options, info)
+      if(info%flag >= 0) &
+         call ssids_factor(posdef, a%val, akeep, fkeep, options, info)
+      call print_result(info%flag, SSIDS_SUCCESS)
+      if(info%flag >= 0) then
+         call gen_rhs(a, rhs, x1, x, res, 1)
+         call chk_answer(posdef, a, akeep, options, rhs, x, res, SSIDS_SUCCESS)
+      endif
+      call ssids_free(akeep, fkeep, cuda_error)
+   end do
+   options%cpu_block_size = default_options%cpu_block_size
+
+   ! Test single precision factors recover double precision accuracy by
+   ! iterative refinement
+   options%compress_factors = .true.
+   do test = 0, 1
+      posdef = (test.eq.1)
+      write(*,"(a,l1,a)",advance="no") &
+         " * Testing compress_factors, posdef=", posdef, "......."
+      call gen_grid(100, merge(4.5_wp, 1.0_wp, posdef), a%n, a%ptr, a%row, &
+         a%val)
+      call gen_rhs(a, rhs, x1, x, res, 2)
+      call ssids_analyse(check, a%n, a%ptr, a%row, akeep, options, info)
+      ! Factorize twice, so that the factors are demoted and then
+      ! refactorized in place
+      if(info%flag >= 0) &
+         call ssids_factor(posdef, a%val, akeep, fkeep, options, info)
+      if(info%flag >= 0) &
+         call ssids_factor(posdef, a%val, akeep, fkeep, options, info)
+      if(info%flag >= 0) &
+         call ssids_solve(2, x, a%n, akeep, fkeep, options, info)
+      if(info%flag < 0) then
+         call print_result(info%flag, SSIDS_SUCCESS)
+      else
+         call compute_resid(2, a, x, a%n, rhs, a%n, res, a%n)
+         if(info%num_refine <= 0 .or. &
+               maxval(abs(res(1:a%n,1:2))) >= err_tol) then
+            write(*, "(a,i4,a,es12.4)") "fail: num_refine = ", &
+               info%num_refine, " residual = ", maxval(abs(res(1:a%n,1:2)))
+            errors = errors + 1
+         else
+            call print_result(info%flag, SSIDS_SUCCESS)
+         endif
+      endif
+      call ssids_free(akeep, fkeep, cuda_error)
+   end do
+   options%compress_factors = default_options%compress_factors
+
+   ! Test concurrent solves with the same fkeep, which must not share
+   ! workspace
+   do test = 0, 1
+      posdef = (test.eq.1)
+      write(*,"(a,l1,a)",advance="no") &
+         " * Testing concurrent solves, posdef=", posdef, "......"
+      call gen_grid(100, merge(4.5_wp, 1.0_wp, posdef), a%n, a%ptr, a%row, &
+         a%val)
+      call gen_rhs(a, rhs, x1, x, res, 8)
+      call ssids_analyse(check, a%n, a%ptr, a%row, akeep, options, info)
+      if(info%flag >= 0) &
+         call ssids_factor(posdef, a%val, akeep, fkeep, options, info)
+      if(info%flag < 0) then
+         call print_result(info%flag, SSIDS_SUCCESS)
+      else
+         x(:,:) = rhs(:,:)
+         nfail = 0
+         !$omp parallel do default(shared) private(i, pinfo) schedule(static,1)
+         do i = 1, 8
+            call ssids_solve(x(:,i), akeep, fkeep, options, pinfo)
+            if(pinfo%flag < 0) then
+               !$omp atomic update
+               nfail = nfail + 1
+            endif
+         end do
+         !$omp end parallel do
+         call compute_resid(8, a, x, a%n, rhs, a%n, res, a%n)
+         if(nfail > 0 .or. maxval(abs(res(1:a%n,1:8))) >= err_tol) then
+            write(*, "(a,i4,a,es12.4)") "fail: failed solves = ", nfail, &
+               " residual = ", maxval(abs(res(1:a%n,1:8)))
+            errors = errors + 1
+         else
+            call print_result(info%flag, SSIDS_SUCCESS)
+         endif
+      endif
+      call ssids_free(akeep, fkeep, cuda_error)
+   end do
+
 end subroutine test_special
 
 !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
@@ -1472,6 +1717,52 @@ end subroutine gen_bordered_block_diag
 
 !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 
+! Generates the 5-point finite difference matrix on a k x k grid with
+! diagonal entries diag and off-diagonal entries -1 (lower triangle only).
+! It is positive definite if diag > 4 and indefinite if diag < 4.
+subroutine gen_grid(k, diag, n, ptr, row, val)
+   integer, intent(in) :: k
+   real(wp), intent(in) :: diag
+   integer, intent(out) :: n
+   integer, dimension(:), allocatable :: ptr
+   integer, dimension(:), allocatable :: row
+   real(wp), dimension(:), allocatable :: val
+
+   integer :: i, j, p, c
+   integer :: st
+
+   ! Clear any previous allocs
+   deallocate(ptr, stat=st)
+   deallocate(row, stat=st)
+   deallocate(val, stat=st)
+
+   n = k*k
+   allocate(ptr(n+1), row(3*n), val(3*n))
+   p = 1
+   do j = 1, k
+      do i = 1, k
+         c = (j-1)*k + i
+         ptr(c) = p
+         row(p) = c
+         val(p) = diag
+         p = p + 1
+         if(i.lt.k) then
+            row(p) = c + 1
+            val(p) = -1.0
+            p = p + 1
+         endif
+         if(j.lt.k) then
+            row(p) = c + k
+            val(p) = -1.0
+            p = p + 1
+         endif
+      end do
+   end do
+   ptr(n+1) = p
+end subroutine gen_grid
+
+!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
+
 subroutine simple_mat_lower(a,extra)
    ! simple pos def test matrix (lower triangular part only)
    type(matrix_type), intent(inout) :: a
@@ -2014,6 +2305,13 @@ subroutine test_random
          errors = errors + 1
          cycle
       endif
+      if(info%num_flops.gt.0 .and. info%factor_time_predicted.le.zero) then
+         write(*, "(a,es12.4)") "bad factor_time_predicted", &
+            info%factor_time_predicted
+         call ssids_free(akeep, cuda_error)
+         errors = errors + 1
+         cycle
+      endif
 
       nrhs = random_integer(state,  maxnrhs)
 
@@ -2050,6 +2348,14 @@ subroutine test_random
          errors = errors + 1
          cycle
       endif
+      if(info%factor_time.lt.zero .or. &
+            (num_flops.gt.0 .and. info%factor_time_predicted.le.zero)) then
+         write(*, "(a,2es12.4)") "bad factor_time", info%factor_time, &
+            info%factor_time_predicted
+         call ssids_free(akeep, fkeep, cuda_error)
+         errors = errors + 1
+         cycle
+      endif
       write(*,'(a,f6.1,1x)',advance="no") ' num_flops:',num_flops*1e-6
 
       ! Perform solve
@@ -2294,7 +2600,7 @@ end subroutine test_random
 !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
 
 subroutine test_big
-   type(ssids_akeep) :: akeep
+   type(ssids_akeep) :: akeep, akeep1
    type(ssids_fkeep) :: fkeep
    type(ssids_options) :: options
    type(ssids_inform) :: info
@@ -2304,9 +2610,10 @@ subroutine test_big
    real(wp), allocatable, dimension(:, :) :: rhs,x
    real(wp), allocatable, dimension(:, :) :: res
 
-   logical :: posdef
-   integer :: i, j, k, nrhs, cuda_error
-   real(wp) :: num_flops
+   logical :: posdef, same
+   integer :: i, j, k, nrhs, cuda_error, test
+   integer :: max_threads
+   real(wp) :: num_flops, eps
 
    write(*, "(a)")
    write(*, "(a)") "=================="
@@ -2341,6 +2648,35 @@ subroutine test_big
       return
    endif
    num_flops = info%num_flops
+   if(info%relidx_mem .le. 0) then
+      write(*, "(a,i10)") "fail, bad relidx_mem", info%relidx_mem
+      call ssids_free(akeep, cuda_error)
+      errors = errors + 1
+      return
+   endif
+
+   ! Check that analyse on a single thread gives identical results
+   max_threads = 1
+!$ max_threads = omp_get_max_threads()
+   if (max_threads .gt. 1) then
+!$    call omp_set_num_threads(1)
+      call ssids_analyse(.false., a%n, a%ptr, a%row, akeep1, options, info)
+!$    call omp_set_num_threads(max_threads)
+      if ((size(akeep1%rlist) .ne. size(akeep%rlist)) .or. &
+            (size(akeep1%nlist) .ne. size(akeep%nlist))) then
+         same = .false.
+      else
+         same = all(akeep1%rlist .eq. akeep%rlist) .and. &
+            all(akeep1%nlist .eq. akeep%nlist)
+      endif
+      call ssids_free(akeep1, cuda_error)
+      if(.not. same) then
+         write(*, "(a)") "fail, analyse differs on single thread"
+         call ssids_free(akeep, cuda_error)
+         errors = errors + 1
+         return
+      endif
+   endif
 
    ! Generate rhs assuming x(k) = k/maxn. remember we have only
    ! half matrix held.
@@ -2395,6 +2731,113 @@ subroutine test_big
       return
    endif
 
+   !
+   ! Refactorize with slightly and then substantially changed values,
+   ! reusing the previous factor storage and pivot sequence, then with
+   ! changed values reusing only the storage
+   !
+   do test = 1, 3
+      options%refactor = (test.le.2)
+      if(test.eq.1) then
+         eps = 1e-6_wp
+      else
+         eps = 0.5_wp
+      endif
+      do j = 1, a%ptr(a%n+1)-1
+         a%val(j) = a%val(j) * (one + eps*random_real(state, .false.))
+      end do
+      rhs(1:a%n, 1:nrhs) = zero
+      do k = 1, a%n
+         do j = a%ptr(k), a%ptr(k+1)-1
+            i = a%row(j)
+            rhs(i, 1:nrhs) = rhs(i, 1:nrhs) + a%val(j)*real(k)/real(a%n)
+            if(i.eq.k) cycle
+            rhs(k, 1:nrhs) = rhs(k, 1:nrhs) + a%val(j)*real(i)/real(a%n)
+         end do
+      end do
+      x(1:a%n,1:nrhs) = rhs(1:a%n,1:nrhs)
+      call ssids_factor(posdef, a%val, akeep, fkeep, options, info, &
+            ptr=a%ptr, row=a%row)
+      if(info%flag .lt. SSIDS_SUCCESS) then
+         write(*, "(a,i3)") "fail on refactor", info%flag
+         call ssids_free(akeep, fkeep, cuda_error)
+         errors = errors + 1
+         return
+      endif
+      if(info%not_refactored.lt.0 .or. &
+            (test.eq.3 .and. info%not_refactored.ne.0)) then
+         write(*, "(a,i8)") "bad not_refactored", info%not_refactored
+         call ssids_free(akeep, fkeep, cuda_error)
+         errors = errors + 1
+         return
+      endif
+      call ssids_solve(nrhs, x, a%n, akeep, fkeep, options, info)
+      if(info%flag .lt. SSIDS_SUCCESS) then
+         write(*, "(a,i4)") " fail on solve after refactor", info%flag
+         call ssids_free(akeep, fkeep, cuda_error)
+         errors = errors + 1
+         return
+      endif
+      call compute_resid(nrhs,a,x,a%n,rhs,a%n,res,a%n)
+      if(maxval(abs(res(1:a%n,1:nrhs))) < err_tol) then
+         write(*, "(a)", advance="no") "ok..."
+      else
+         write(*, "(a)") " refactor fail residual 2d = "
+         do i = 1, nrhs
+            write(*, "(es12.4)", advance="no") maxval(abs(res(1:a%n,i)))
+         end do
+         write(*, "()")
+         errors = errors + 1
+         call ssids_free(akeep, fkeep, cuda_error)
+         return
+      endif
+   end do
+   options%refactor = .false.
+
+   !
+   ! Analyse and factor again without relative indices, so assembly must
+   ! use the global-to-local map everywhere
+   !
+   call ssids_free(akeep, fkeep, cuda_error)
+   options%store_relidx = .false.
+   call ssids_analyse(.false., a%n, a%ptr, a%row, akeep, options, info)
+   if(info%flag .ne. SSIDS_SUCCESS .or. info%relidx_mem .ne. 0) then
+      write(*, "(a,i3,i10)") "fail on analyse without relidx", info%flag, &
+         info%relidx_mem
+      call ssids_free(akeep, cuda_error)
+      errors = errors + 1
+      return
+   endif
+   x(1:a%n,1:nrhs) = rhs(1:a%n,1:nrhs)
+   call ssids_factor(posdef, a%val, akeep, fkeep, options, info, &
+         ptr=a%ptr, row=a%row)
+   if(info%flag .lt. SSIDS_SUCCESS) then
+      write(*, "(a,i3)") "fail on factor without relidx", info%flag
+      call ssids_free(akeep, fkeep, cuda_error)
+      errors = errors + 1
+      return
+   endif
+   call ssids_solve(nrhs, x, a%n, akeep, fkeep, options, info)
+   if(info%flag .lt. SSIDS_SUCCESS) then
+      write(*, "(a,i4)") " fail on solve without relidx", info%flag
+      call ssids_free(akeep, fkeep, cuda_error)
+      errors = errors + 1
+      return
+   endif
+   call compute_resid(nrhs,a,x,a%n,rhs,a%n,res,a%n)
+   if(maxval(abs(res(1:a%n,1:nrhs))) < err_tol) then
+      write(*, "(a)", advance="no") "ok..."
+   else
+      write(*, "(a)") " no relidx fail residual 2d = "
+      do i = 1, nrhs
+         write(*, "(es12.4)", advance="no") maxval(abs(res(1:a%n,i)))
+      end do
+      write(*, "()")
+      errors = errors + 1
+      call ssids_free(akeep, fkeep, cuda_error)
+      return
+   endif
+
    !
    ! Cleanup ready for next iteration
    !